@@ -0,0 +1,252 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <complex>
+
+#include "compressed_row_matrix.hpp"
+#include "dense_vector.hpp"
+#include "products.hpp"
+#include "sparse_lu.hpp"
+#include "sparsity_pattern.hpp"
+#include "fill_reducing.hpp"
+#include "details/amg_kernels.hpp"
+#include "details/blas1_kernels.hpp"
+#include "details/sparse_matrix_product.hpp"
+
+namespace fe { namespace la {
+  enum class amg_smoother {
+    JACOBI,       // damped by 4 / 3 over a bound of the spectral radius of D^-1 A
+    GAUSS_SEIDEL  // forward before and backward after the coarse correction
+  };
+
+  /**
+   * Parameters of the multigrid hierarchy. Systems with several unknowns per mesh
+   * node (elasticity) should number the components of a node consecutively and set
+   * block_size to their count, so that nodes are aggregated as a whole.
+   */
+  struct amg_control {
+    size_t block_size;
+    // Relative size of the connections used for aggregation, larger values coarsen slower
+    double strength_threshold;
+    amg_smoother smoother;
+    // Smoothing sweeps before and after the coarse correction on every level
+    size_t sweeps;
+    // Coarsening stops at this number of unknowns or of levels, the last level is solved by sparse_lu
+    size_t coarse_size;
+    size_t max_levels;
+
+    explicit amg_control(size_t block_size = 1, double strength_threshold = 0.08,
+        amg_smoother smoother = amg_smoother::GAUSS_SEIDEL, size_t sweeps = 1,
+        size_t coarse_size = 500, size_t max_levels = 10)
+        : block_size(block_size), strength_threshold(strength_threshold), smoother(smoother),
+          sweeps(sweeps), coarse_size(coarse_size), max_levels(max_levels) {
+    }
+  };
+
+  /**
+   * Smoothed aggregation algebraic multigrid, applied as one V-cycle per apply:
+   *
+   *   amg_preconditioner_real amg{a};
+   *   cg.solve(a, b, x, amg);
+   *
+   * Needs only the matrix. Every level aggregates strongly connected unknowns,
+   * smooths the piecewise constant prolongator P by one Jacobi step and takes the
+   * Galerkin operator P^H A P (P^T A P for real matrices) as the next level, so the
+   * iteration count of the preconditioned solver stays nearly the same as the mesh is refined.
+   * With the Gauss-Seidel smoother the V-cycle is symmetric and can precondition cg_solver.
+   * compute builds a new hierarchy, apply does not allocate memory.
+   */
+  template<class Scalar, class Storage>
+  class amg_preconditioner {
+    public:
+      typedef Scalar scalar_t;
+      typedef Storage storage_t;
+
+      explicit amg_preconditioner(amg_control const & control = amg_control())
+          : control_(control) {
+        assert(control.block_size > 0 && control.max_levels > 0);
+      }
+
+      explicit amg_preconditioner(compressed_row_matrix<Scalar, Storage> const & A,
+          amg_control const & control = amg_control())
+          : amg_preconditioner(control) {
+        compute(A);
+      }
+
+      amg_control const & control() const {
+        return control_;
+      }
+
+      void compute(compressed_row_matrix<Scalar, Storage> const & A) {
+        assert(A.dim1() == A.dim2());
+        assert(A.dim1() % control_.block_size == 0);
+
+        size_t bs = control_.block_size;
+        levels_.clear();
+        levels_.emplace_back(A);
+
+        std::vector<size_t> n_ia, n_ja, s_ia, s_ja, agg;
+        std::vector<double> norms;
+        std::vector<size_t> p_ia, p_ja, r_ia, r_ja, ap_ia, ap_ja, c_ia, c_ja;
+        Storage p_a, r_a, ap_a, c_a;
+
+        for (;;) {
+          size_t l = levels_.size() - 1;
+          prepare_smoother(levels_[l]);
+
+          auto const & a = levels_[l].a;
+          size_t n = a.dim1();
+          if (n <= control_.coarse_size || levels_.size() == control_.max_levels) {
+            break;
+          }
+
+          auto const & ia = a.row_offsets();
+          auto const & ja = a.column_indices();
+          details::block_norms(n, bs, ia, ja, a.data().data(), n_ia, n_ja, norms);
+          details::strong_connections(n / bs, n_ia, n_ja, norms, control_.strength_threshold, s_ia, s_ja);
+          size_t count = details::aggregate(n / bs, s_ia, s_ja, agg);
+          size_t coarse_n = count * bs;
+          if (count == 0 || coarse_n >= n) {
+            break;
+          }
+
+          details::smoothed_prolongator(n, bs, ia, ja, a.data().data(), levels_[l].inv_diag, levels_[l].omega,
+              agg, count, p_ia, p_ja, p_a);
+          // R = P^H keeps the coarse operator of a Hermitian matrix Hermitian
+          details::csr_transpose(n, coarse_n, p_ia, p_ja, p_a.data(), r_ia, r_ja, r_a);
+          for (auto & value : r_a) {
+            value = details::conj_if_complex(value);
+          }
+          details::csr_multiply(n, coarse_n, ia, ja, a.data().data(), p_ia, p_ja, p_a.data(), ap_ia, ap_ja, ap_a);
+          details::csr_multiply(coarse_n, coarse_n, r_ia, r_ja, r_a.data(), ap_ia, ap_ja, ap_a.data(),
+              c_ia, c_ja, c_a);
+
+          levels_[l].p = details::crmatrix_from_arrays<Scalar, Storage>(n, coarse_n,
+              std::move(p_ia), std::move(p_ja), std::move(p_a));
+          levels_[l].r = details::crmatrix_from_arrays<Scalar, Storage>(coarse_n, n,
+              std::move(r_ia), std::move(r_ja), std::move(r_a));
+          levels_.emplace_back(details::crmatrix_from_arrays<Scalar, Storage>(coarse_n, coarse_n,
+              std::move(c_ia), std::move(c_ja), std::move(c_a)));
+        }
+
+        auto const & coarse = levels_.back().a;
+        coarse_lu_.analyze(coarse, approximate_minimum_degree(sparsity_pattern(coarse)));
+        coarse_lu_.factorize(coarse);
+      }
+
+      // z = one V-cycle for A z = r from z = 0
+      void apply(dense_vector<Scalar, Storage> const & r, dense_vector<Scalar, Storage> & z) const {
+        assert(!levels_.empty());
+        assert(r.dim() == levels_[0].a.dim1() && z.dim() == r.dim());
+
+        cycle(0, r, z);
+      }
+
+      size_t levels() const {
+        return levels_.size();
+      }
+
+      // Operator of level l, level 0 is the original matrix
+      compressed_row_matrix<Scalar, Storage> const & level_matrix(size_t l) const {
+        return levels_[l].a;
+      }
+
+      // Elements stored in the operators of all levels relative to the original matrix
+      double operator_complexity() const {
+        size_t total = 0;
+        for (auto const & level : levels_) {
+          total += level.a.data().size();
+        }
+        return double(total) / double(levels_[0].a.data().size());
+      }
+    private:
+      struct level {
+        explicit level(compressed_row_matrix<Scalar, Storage> a)
+            : a(std::move(a)), p(empty()), r(empty()), omega(1), x(0), b(0), t(0) {
+        }
+
+        static compressed_row_matrix<Scalar, Storage> empty() {
+          return details::crmatrix_from_arrays<Scalar, Storage>(0, 0, std::vector<size_t>(1, 0),
+              std::vector<size_t>(), Storage());
+        }
+
+        compressed_row_matrix<Scalar, Storage> a;
+        // Prolongator from the next level and its transpose, the restriction
+        compressed_row_matrix<Scalar, Storage> p;
+        compressed_row_matrix<Scalar, Storage> r;
+
+        std::vector<size_t> diag;
+        std::vector<Scalar> inv_diag;
+        // Jacobi damping
+        double omega;
+
+        // Solution and right-hand side of the level (below the finest) and a residual buffer
+        mutable dense_vector<Scalar, Storage> x;
+        mutable dense_vector<Scalar, Storage> b;
+        mutable dense_vector<Scalar, Storage> t;
+      };
+
+      void prepare_smoother(level & lv) {
+        size_t n = lv.a.dim1();
+        auto const & ia = lv.a.row_offsets();
+        Scalar const * a = lv.a.data().data();
+
+        details::inverse_diagonal(n, ia, lv.a.column_indices(), a, lv.diag, lv.inv_diag);
+        lv.omega = 4. / 3. / details::jacobi_spectral_bound(n, ia, a, lv.inv_diag);
+        lv.x = dense_vector<Scalar, Storage>(n);
+        lv.b = dense_vector<Scalar, Storage>(n);
+        lv.t = dense_vector<Scalar, Storage>(n);
+      }
+
+      void smooth(level const & lv, dense_vector<Scalar, Storage> const & b, dense_vector<Scalar, Storage> & x,
+          bool forward) const {
+        size_t n = lv.a.dim1();
+        auto const & ia = lv.a.row_offsets();
+        auto const & ja = lv.a.column_indices();
+        Scalar const * a = lv.a.data().data();
+
+        for (size_t s = 0; s < control_.sweeps; ++s) {
+          if (control_.smoother == amg_smoother::JACOBI) {
+            details::jacobi_sweep(n, ia, ja, a, lv.inv_diag, lv.omega, b.data().data(), x.data().data(),
+                lv.t.data().data());
+          } else {
+            details::gauss_seidel_sweep(n, ia, ja, a, lv.diag, lv.inv_diag, b.data().data(), x.data().data(),
+                forward);
+          }
+        }
+      }
+
+      void cycle(size_t l, dense_vector<Scalar, Storage> const & b, dense_vector<Scalar, Storage> & x) const {
+        level const & lv = levels_[l];
+        if (l + 1 == levels_.size()) {
+          x = b;
+          coarse_lu_.solve(x);
+          return;
+        }
+
+        std::fill(x.data().begin(), x.data().end(), Scalar());
+        smooth(lv, b, x, true);
+
+        // Restricted residual of the next level, corrected by its solution
+        level const & next = levels_[l + 1];
+        lv.t = b;
+        mvprod_into(lv.a, x, lv.t, Scalar(-1), Scalar(1));
+        mvprod_into(lv.r, lv.t, next.b);
+        cycle(l + 1, next.b, next.x);
+        mvprod_into(lv.p, next.x, x, Scalar(1), Scalar(1));
+
+        smooth(lv, b, x, false);
+      }
+    private:
+      amg_control control_;
+      std::vector<level> levels_;
+      sparse_lu<Scalar, Storage> coarse_lu_;
+  };
+
+  typedef amg_preconditioner<double, std::vector<double>> amg_preconditioner_real;
+  typedef amg_preconditioner<std::complex<double>, std::vector<std::complex<double>>>
+      amg_preconditioner_complex;
+} } // namespace fe::la
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <complex>
+
+#include "band_matrix.hpp"
+#include "dense_vector.hpp"
+#include "details/band_lu_kernels.hpp"
+
+namespace fe { namespace la {
+  /**
+   * LU decomposition of a band matrix with partial pivoting, for matrices whose
+   * diagonal does not dominate (lu_decomposition of band_matrix does not pivot).
+   * Row interchanges widen the upper band to bands_left + bands_right, so the
+   * factors are kept in a separate storage of n * (2 * bands_left + bands_right + 1)
+   * elements, which is reused by later factorize calls of the same shape.
+   */
+  template<class Scalar, class Storage>
+  class band_lu {
+    public:
+      typedef Scalar scalar_t;
+      typedef Storage storage_t;
+
+      band_lu()
+          : n_(0), ml_(0), mr_(0) {
+      }
+
+      explicit band_lu(band_matrix<Scalar, Storage> const & matrix)
+          : band_lu() {
+        factorize(matrix);
+      }
+
+      void factorize(band_matrix<Scalar, Storage> const & matrix) {
+        assert(matrix.dim1() == matrix.dim2());
+
+        n_ = matrix.dim1();
+        ml_ = matrix.bands_left();
+        mr_ = matrix.bands_right();
+
+        size_t w = matrix.band_width();
+        size_t lu_w = factor_width();
+        lu_.resize(n_ * lu_w);
+        pivots_.resize(n_);
+
+        // Row i of the matrix goes to the same position of the factor row,
+        //   the extra ml_ upper bands start as zeros
+        Scalar const * a = matrix.data().data();
+        for (size_t i = 0; i < n_; ++i) {
+          std::copy(a + i * w, a + (i + 1) * w, lu_.begin() + i * lu_w);
+          std::fill(lu_.begin() + i * lu_w + w, lu_.begin() + (i + 1) * lu_w, Scalar());
+        }
+
+        details::band_lu_pivoting(n_, ml_, mr_, lu_.data(), pivots_.data());
+      }
+
+      // Solves A x = b in place
+      void solve(dense_vector<Scalar, Storage> & b) const {
+        assert(b.dim() == n_);
+
+        details::band_lu_pivoting_solve(n_, ml_, mr_, lu_.data(), pivots_.data(), b.data().data());
+      }
+
+      size_t dim() const {
+        return n_;
+      }
+
+      // Row interchanged with row k at step k of the elimination
+      size_t pivot(size_t k) const {
+        assert(k < n_);
+
+        return pivots_[k];
+      }
+    private:
+      size_t factor_width() const {
+        return 2 * ml_ + mr_ + 1;
+      }
+    private:
+      size_t n_;
+      size_t ml_;
+      size_t mr_;
+
+      Storage lu_;
+      std::vector<size_t> pivots_;
+  };
+
+  typedef band_lu<double, std::vector<double>> band_lu_real;
+  typedef band_lu<std::complex<double>, std::vector<std::complex<double>>> band_lu_complex;
+} } // namespace fe::la
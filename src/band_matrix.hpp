@@ -10,6 +10,7 @@
 #include "dense_matrix.hpp"
 #include "dense_vector.hpp"
 #include "products.hpp"
+#include "row_profile.hpp"
 #include "details/sparse_element_proxy.hpp"
 #include "details/sparse_matrix_vector_product.hpp"
 
@@ -136,6 +137,12 @@ namespace fe { namespace la {
             storage_(dim1, band_width()) {
       }
 
+      // Makes a zero matrix with bands wide enough to store the given profile
+      explicit band_matrix(row_profile const & profile)
+          : band_matrix(profile.dim1(), profile.dim2(),
+              profile.bands_left(), profile.bands_right()) {
+      }
+
       band_matrix(band_matrix const &) = default;
       band_matrix(band_matrix &&) = default;
       ~band_matrix() = default;
@@ -152,6 +159,16 @@ namespace fe { namespace la {
         return mr_ + ml_ + 1;
       }
 
+      // Number of bands below the diagonal
+      size_t bands_left() const {
+        return ml_;
+      }
+
+      // Number of bands above the diagonal
+      size_t bands_right() const {
+        return mr_;
+      }
+
       reference_t operator () (size_t i, size_t j) {
         assert(i < dim1());
         assert(j < dim2());
@@ -317,17 +334,23 @@ namespace fe { namespace la {
   namespace details {
     template<class Scalar, class Storage>
     struct mat_colvec_prod_impl_f<band_matrix, Scalar, Storage> {
-      dense_vector<Scalar, Storage> operator()(band_matrix<Scalar, Storage> lhs
-          ,dense_vector<Scalar, Storage> rhs) const {
-        return mv_sparse_prod(lhs, rhs);
+      void operator()(band_matrix<Scalar, Storage> const & lhs
+          ,dense_vector<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        mv_sparse_prod_into(lhs, rhs, res, alpha, beta);
       }
     };
 
     template<class Scalar, class Storage>
     struct mat_rowvec_prod_impl_f<band_matrix, Scalar, Storage> {
-      dense_vector<Scalar, Storage> operator()(dense_vector<Scalar, Storage> lhs
-          ,band_matrix<Scalar, Storage> rhs) const {
-        return mv_sparse_prod(lhs, rhs);
+      void operator()(dense_vector<Scalar, Storage> const & lhs
+          ,band_matrix<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        mv_sparse_prod_into(lhs, rhs, res, alpha, beta);
       }
     };
   } // namespace details
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <complex>
+
+#include "dense_vector.hpp"
+#include "blas1.hpp"
+#include "iterative.hpp"
+
+namespace fe { namespace la {
+  /**
+   * Preconditioned BiCGStab for general nonsingular systems, used like cg_solver.
+   * Needs two operator and two preconditioner applications per iteration and a fixed
+   * amount of memory (eight vectors), unlike gmres_solver whose basis grows with the restart.
+   * The preconditioner is applied on the right by default, see preconditioning_side.
+   */
+  template<class Scalar, class Storage>
+  class bicgstab_solver {
+    public:
+      typedef Scalar scalar_t;
+      typedef Storage storage_t;
+
+      explicit bicgstab_solver(iterative_control const & control = iterative_control(),
+          preconditioning_side side = preconditioning_side::RIGHT)
+          : control_(control), side_(side), r_(0), r0_(0), p_(0), v_(0), s_(0), t_(0), p_hat_(0), s_hat_(0) {
+      }
+
+      iterative_control & control() {
+        return control_;
+      }
+
+      iterative_control const & control() const {
+        return control_;
+      }
+
+      // Called with the residual norm of the initial guess and of every iteration
+      void set_residual_callback(residual_callback_t callback) {
+        callback_ = std::move(callback);
+      }
+
+      template<class Operator>
+      iterative_result solve(Operator const & A, dense_vector<Scalar, Storage> const & b,
+          dense_vector<Scalar, Storage> & x) {
+        return solve(A, b, x, identity_preconditioner());
+      }
+
+      template<class Operator, class Preconditioner>
+      iterative_result solve(Operator const & A, dense_vector<Scalar, Storage> const & b,
+          dense_vector<Scalar, Storage> & x, Preconditioner const & M) {
+        assert(b.dim() == x.dim());
+
+        size_t n = b.dim();
+        for (auto v : {&r_, &r0_, &p_, &v_, &s_, &t_, &p_hat_, &s_hat_}) {
+          details::resize_workspace(*v, n);
+        }
+
+        bool left = side_ == preconditioning_side::LEFT;
+        // The solution moves along M^-1 p and M^-1 s, or along p and s with left preconditioning
+        auto const & p_step = left ? p_ : p_hat_;
+        auto const & s_step = left ? s_ : s_hat_;
+
+        // r = b - A x (M^-1 (b - A x) with left preconditioning), r0 is the fixed shadow residual
+        details::apply_operator(A, x, r_);
+        scal(Scalar(-1), r_);
+        axpy(Scalar(1), b, r_);
+        double b_norm = nrm2(b);
+        if (left) {
+          M.apply(r_, t_);
+          r_ = t_;
+          M.apply(b, t_);
+          b_norm = nrm2(t_);
+        }
+        r0_ = r_;
+
+        double stop_norm = details::stopping_norm(control_, b_norm);
+        iterative_result res{0, nrm2(r_), false};
+        report(res);
+        if (res.residual_norm <= stop_norm) {
+          res.converged = true;
+          return res;
+        }
+
+        Scalar rho(1), alpha(1), omega(1);
+        std::fill(p_.data().begin(), p_.data().end(), Scalar());
+        std::fill(v_.data().begin(), v_.data().end(), Scalar());
+
+        while (res.iterations < control_.max_iterations) {
+          Scalar rho_next = dotc(r0_, r_);
+          if (rho_next == Scalar() || omega == Scalar()) {
+            break;
+          }
+
+          // p = r + beta * (p - omega * v)
+          Scalar beta = (rho_next / rho) * (alpha / omega);
+          axpy(-omega, v_, p_);
+          scal(beta, p_);
+          axpy(Scalar(1), r_, p_);
+          rho = rho_next;
+
+          // v = A M^-1 p, or M^-1 A p with left preconditioning
+          if (left) {
+            details::apply_operator(A, p_, t_);
+            M.apply(t_, v_);
+          } else {
+            M.apply(p_, p_hat_);
+            details::apply_operator(A, p_hat_, v_);
+          }
+          Scalar r0v = dotc(r0_, v_);
+          if (r0v == Scalar()) {
+            break;
+          }
+          alpha = rho / r0v;
+
+          // s = r - alpha * v
+          s_ = r_;
+          axpy(-alpha, v_, s_);
+
+          ++res.iterations;
+          double s_norm = nrm2(s_);
+          if (s_norm <= stop_norm) {
+            axpy(alpha, p_step, x);
+            res.residual_norm = s_norm;
+            res.converged = true;
+            report(res);
+            break;
+          }
+
+          // t = A M^-1 s, or M^-1 A s with left preconditioning, r is free until it is updated
+          if (left) {
+            details::apply_operator(A, s_, r_);
+            M.apply(r_, t_);
+          } else {
+            M.apply(s_, s_hat_);
+            details::apply_operator(A, s_hat_, t_);
+          }
+          double tt = nrm2(t_);
+          omega = tt == 0 ? Scalar() : dotc(t_, s_) / Scalar(tt * tt);
+
+          axpy(alpha, p_step, x);
+          axpy(omega, s_step, x);
+
+          // r = s - omega * t
+          r_ = s_;
+          axpy(-omega, t_, r_);
+
+          res.residual_norm = nrm2(r_);
+          report(res);
+          if (res.residual_norm <= stop_norm) {
+            res.converged = true;
+            break;
+          }
+        }
+
+        return res;
+      }
+    private:
+      void report(iterative_result const & res) const {
+        if (callback_) {
+          callback_(res.iterations, res.residual_norm);
+        }
+      }
+    private:
+      iterative_control control_;
+      preconditioning_side side_;
+      residual_callback_t callback_;
+
+      dense_vector<Scalar, Storage> r_;
+      dense_vector<Scalar, Storage> r0_;
+      dense_vector<Scalar, Storage> p_;
+      dense_vector<Scalar, Storage> v_;
+      dense_vector<Scalar, Storage> s_;
+      dense_vector<Scalar, Storage> t_;
+      // Preconditioned p and s, not used with left preconditioning
+      dense_vector<Scalar, Storage> p_hat_;
+      dense_vector<Scalar, Storage> s_hat_;
+  };
+
+  typedef bicgstab_solver<double, std::vector<double>> bicgstab_solver_real;
+  typedef bicgstab_solver<std::complex<double>, std::vector<std::complex<double>>> bicgstab_solver_complex;
+} } // namespace fe::la
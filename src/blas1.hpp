@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "dense_matrix.hpp"
+#include "details/blas1_kernels.hpp"
+
+// Level 1 BLAS operations on dense vectors and matrices.
+// Matrices are treated as vectors of all their elements, so these functions
+//   work for both dense_vector and dense_matrix.
+// Kernels for double and std::complex<double> use AVX2 or AVX-512 when the
+//   cpu supports it, other scalar types use portable loops.
+
+namespace fe { namespace la {
+  // y += alpha * x
+  template<class Scalar, class Storage>
+  void axpy(typename dense_matrix<Scalar, Storage>::scalar_t alpha,
+      dense_matrix<Scalar, Storage> const & x, dense_matrix<Scalar, Storage> & y) {
+    assert(x.dim1() == y.dim1() && x.dim2() == y.dim2());
+
+    details::axpy_kernel(y.data().size(), alpha, x.data().data(), y.data().data());
+  }
+
+  // x *= alpha
+  template<class Scalar, class Storage>
+  void scal(typename dense_matrix<Scalar, Storage>::scalar_t alpha,
+      dense_matrix<Scalar, Storage> & x) {
+    details::scal_kernel(x.data().size(), alpha, x.data().data());
+  }
+
+  // Sum of x(i) * y(i), complex values are not conjugated
+  template<class Scalar, class Storage>
+  Scalar dot(dense_matrix<Scalar, Storage> const & x, dense_matrix<Scalar, Storage> const & y) {
+    assert(x.data().size() == y.data().size());
+
+    return details::dot_kernel(x.data().size(), x.data().data(), y.data().data());
+  }
+
+  // Sum of conj(x(i)) * y(i), the same as dot for real values
+  template<class Scalar, class Storage>
+  Scalar dotc(dense_matrix<Scalar, Storage> const & x, dense_matrix<Scalar, Storage> const & y) {
+    assert(x.data().size() == y.data().size());
+
+    return details::dotc_kernel(x.data().size(), x.data().data(), y.data().data());
+  }
+
+  // Euclidean norm of x. The squares are summed directly by the fast kernel; if that sum
+  //   overflows or falls below the normal range (elements beyond about 1e+-154 for double),
+  //   x is scaled by its largest element and summed again, as reference BLAS dnrm2 does
+  template<class Scalar, class Storage>
+  typename details::real_type<Scalar>::type nrm2(dense_matrix<Scalar, Storage> const & x) {
+    typedef typename details::real_type<Scalar>::type real_t;
+
+    real_t sumsq = details::sumsq_kernel(x.data().size(), x.data().data());
+    if (std::isnan(sumsq)) {
+      return sumsq;
+    }
+    if (std::isfinite(sumsq) && sumsq >= std::numeric_limits<real_t>::min()) {
+      return std::sqrt(sumsq);
+    }
+    return details::nrm2_scaled(x.data().size(), x.data().data());
+  }
+} } // namespace fe::la
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <complex>
+
+#include "block_compressed_row_matrix.hpp"
+
+namespace fe { namespace la {
+  namespace details {
+    // Turns (block row, block column, B x B values) triplets into block compressed row
+    //   arrays the way compress_triplets does for elements: block columns of every block
+    //   row are sorted and duplicate blocks are summed.
+    template<class Scalar, size_t B, class Storage>
+    void compress_block_triplets(size_t block_rows,
+        std::vector<size_t> & rows, std::vector<size_t> & cols, Storage & values,
+        std::vector<size_t> & ia, std::vector<size_t> & ja, Storage & a) {
+      assert(rows.size() == cols.size() && rows.size() * B * B == values.size());
+
+      size_t count = rows.size();
+
+      ia.assign(block_rows + 1, 0);
+      for (size_t k = 0; k < count; ++k) {
+        assert(rows[k] < block_rows);
+        ++ia[rows[k] + 1];
+      }
+      for (size_t i = 0; i < block_rows; ++i) {
+        ia[i + 1] += ia[i];
+      }
+
+      // Triplets of every block row, sorted by block column and then by insertion order
+      std::vector<std::pair<size_t, size_t>> order(count);
+      {
+        std::vector<size_t> next(ia.begin(), ia.end() - 1);
+        for (size_t k = 0; k < count; ++k) {
+          order[next[rows[k]]++] = std::make_pair(cols[k], k);
+        }
+      }
+      std::vector<size_t>().swap(rows);
+      std::vector<size_t>().swap(cols);
+
+      ja.clear();
+      a.clear();
+      ja.reserve(count);
+      a.reserve(count * B * B);
+      for (size_t i = 0; i < block_rows; ++i) {
+        size_t first = ia[i];
+        size_t last = ia[i + 1];
+        ia[i] = ja.size();
+
+        std::sort(order.begin() + first, order.begin() + last);
+        for (size_t k = first; k < last; ++k) {
+          Scalar const * block = &values[order[k].second * B * B];
+          if (ja.size() > ia[i] && ja.back() == order[k].first) {
+            Scalar * sum = &a[a.size() - B * B];
+            for (size_t e = 0; e < B * B; ++e) {
+              sum[e] += block[e];
+            }
+          } else {
+            ja.push_back(order[k].first);
+            a.insert(a.end(), block, block + B * B);
+          }
+        }
+      }
+      ia[block_rows] = ja.size();
+      Storage().swap(values);
+
+      ja.shrink_to_fit();
+      a.shrink_to_fit();
+    }
+  } // namespace details
+
+  /**
+   * Builds a block_compressed_row_matrix from B x B blocks at (block row, block column)
+   * positions, summing duplicates, like compressed_row_builder does for elements.
+   * Element matrices of finite elements are added by add_block with the node numbers
+   * of the element, every node having B consecutive unknowns.
+   */
+  template<class Scalar, class Storage, size_t B>
+  class block_compressed_row_builder {
+    public:
+      block_compressed_row_builder(size_t block_rows, size_t block_cols, size_t max_buffered = 0)
+          : block_rows_(block_rows), block_cols_(block_cols), max_buffered_(max_buffered),
+            compact_threshold_(max_buffered) {
+      }
+
+      size_t block_rows() const {
+        return block_rows_;
+      }
+
+      size_t block_cols() const {
+        return block_cols_;
+      }
+
+      // Number of blocks currently stored
+      size_t size() const {
+        return rows_.size();
+      }
+
+      void reserve(size_t count) {
+        rows_.reserve(count);
+        cols_.reserve(count);
+        values_.reserve(count * B * B);
+      }
+
+      // Adds the row-major B x B block to block (bi, bj)
+      void add(size_t bi, size_t bj, Scalar const * block) {
+        assert(bi < block_rows());
+        assert(bj < block_cols());
+
+        rows_.push_back(bi);
+        cols_.push_back(bj);
+        values_.insert(values_.end(), block, block + B * B);
+
+        if (compact_threshold_ != 0 && size() >= compact_threshold_) {
+          compact();
+        }
+      }
+
+      // Adds a dense element matrix with B rows (columns) for every node in the node ranges
+      template<class RowNodeIter, class ColNodeIter, class Matrix>
+      void add_block(RowNodeIter rows_first, RowNodeIter rows_last,
+          ColNodeIter cols_first, ColNodeIter cols_last, Matrix const & element) {
+        Scalar block[B * B];
+        size_t i = 0;
+        for (auto row = rows_first; row != rows_last; ++row, ++i) {
+          size_t j = 0;
+          for (auto col = cols_first; col != cols_last; ++col, ++j) {
+            for (size_t r = 0; r < B; ++r) {
+              for (size_t c = 0; c < B; ++c) {
+                block[r * B + c] = element(i * B + r, j * B + c);
+              }
+            }
+            add(*row, *col, block);
+          }
+        }
+      }
+
+      // Sorts the stored blocks and merges duplicates
+      void compact() {
+        std::vector<size_t> ia;
+        std::vector<size_t> ja;
+        Storage a;
+        details::compress_block_triplets<Scalar, B>(block_rows_, rows_, cols_, values_, ia, ja, a);
+
+        rows_.resize(ja.size());
+        for (size_t i = 0; i < block_rows_; ++i) {
+          std::fill(rows_.begin() + ia[i], rows_.begin() + ia[i + 1], i);
+        }
+        cols_ = std::move(ja);
+        values_ = std::move(a);
+
+        if (max_buffered_ != 0) {
+          compact_threshold_ = std::max(max_buffered_, 2 * size());
+        }
+      }
+
+      // Makes the matrix from all added blocks, the builder is empty afterwards
+      block_compressed_row_matrix<Scalar, Storage, B> build() {
+        std::vector<size_t> ia;
+        std::vector<size_t> ja;
+        Storage a;
+        details::compress_block_triplets<Scalar, B>(block_rows_, rows_, cols_, values_, ia, ja, a);
+        compact_threshold_ = max_buffered_;
+
+        return details::bcrmatrix_from_arrays<Scalar, Storage, B>(block_rows_, block_cols_,
+            std::move(ia), std::move(ja), std::move(a));
+      }
+    private:
+      size_t block_rows_;
+      size_t block_cols_;
+      size_t max_buffered_;
+      size_t compact_threshold_;
+
+      std::vector<size_t> rows_;
+      std::vector<size_t> cols_;
+      // B * B values of every block
+      Storage values_;
+  };
+
+  template<size_t B>
+  using block_compressed_row_builder_real = block_compressed_row_builder<double, std::vector<double>, B>;
+  template<size_t B>
+  using block_compressed_row_builder_complex =
+      block_compressed_row_builder<std::complex<double>, std::vector<std::complex<double>>, B>;
+} } // namespace fe::la
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <complex>
+
+#include "compressed_row_matrix.hpp"
+#include "dense_vector.hpp"
+#include "threads.hpp"
+#include "details/sparse_element_proxy.hpp"
+#include "details/sparse_matrix_vector_product.hpp"
+#include "details/block_kernels.hpp"
+
+namespace fe { namespace la {
+  // Forward declarations
+  template<class Scalar, class Storage, size_t B>
+  class block_compressed_row_matrix;
+
+  namespace details {
+    template<class Scalar, class Storage, size_t B>
+    block_compressed_row_matrix<Scalar, Storage, B> bcrmatrix_from_arrays(size_t block_rows, size_t block_cols,
+        std::vector<size_t> && ia, std::vector<size_t> && ja, Storage && a);
+  } // namespace details
+
+  /**
+   * Compressed row matrix of dense B x B blocks (BSR), for finite element systems
+   * with B unknowns per node numbered node by node. One column index is kept per
+   * block instead of per element, and products work on whole blocks with loops of
+   * compile-time length.
+   *
+   * Block row I has blocks data()[(row_offsets()[I] + k) * B * B ...] for k below
+   * row_offsets()[I + 1] - row_offsets()[I], in block columns column_indices()[...],
+   * every block is stored row-major. Dimensions count elements, not blocks.
+   * It is assembled by block_compressed_row_builder or converted from a
+   * compressed_row_matrix by make_block_compressed_row_matrix<B>(a).
+   */
+  template<class Scalar, class Storage, size_t B>
+  class block_compressed_row_matrix {
+    private:
+      typedef details::sparse_element_proxy<Scalar> proxy_t;
+    public:
+      typedef std::vector<size_t> index_storage_t;
+      typedef Scalar scalar_t;
+      typedef Storage storage_t;
+      typedef proxy_t reference_t;
+      typedef Scalar const_reference_t;
+
+      block_compressed_row_matrix() = delete;
+      block_compressed_row_matrix(block_compressed_row_matrix const &) = default;
+      block_compressed_row_matrix(block_compressed_row_matrix &&) = default;
+      ~block_compressed_row_matrix() = default;
+
+      block_compressed_row_matrix & operator = (block_compressed_row_matrix const &) = default;
+      block_compressed_row_matrix & operator = (block_compressed_row_matrix &&) = default;
+
+      size_t dim1() const {
+        return block_rows_ * B;
+      }
+
+      size_t dim2() const {
+        return block_cols_ * B;
+      }
+
+      size_t block_rows() const {
+        return block_rows_;
+      }
+
+      size_t block_cols() const {
+        return block_cols_;
+      }
+
+      static size_t block_size() {
+        return B;
+      }
+
+      storage_t & data() {
+        return a_;
+      }
+
+      storage_t const & data() const {
+        return a_;
+      }
+
+      // Blocks of block row I are row_offsets()[I] ... row_offsets()[I + 1] - 1
+      index_storage_t const & row_offsets() const {
+        return ia_;
+      }
+
+      // Block column of every block, sorted inside every block row
+      index_storage_t const & column_indices() const {
+        return ja_;
+      }
+
+      // Block row bounds of the parts of about equal block counts that products split between threads
+      index_storage_t const & row_partition() const {
+        return partition_;
+      }
+
+      reference_t operator () (size_t i, size_t j) {
+        assert(i < dim1());
+        assert(j < dim2());
+
+        auto b = ja_.cbegin() + ia_[i / B];
+        auto e = ja_.cbegin() + ia_[i / B + 1];
+        auto pos = std::lower_bound(b, e, j / B);
+
+        if (pos == e || *pos != j / B) {
+          return proxy_t();
+        } else {
+          return proxy_t(&a_[(pos - ja_.cbegin()) * B * B + (i % B) * B + j % B]);
+        }
+      }
+
+      const_reference_t operator () (size_t i, size_t j) const {
+        return (*const_cast<block_compressed_row_matrix*>(this))(i, j);
+      }
+    private:
+      block_compressed_row_matrix(size_t block_rows, size_t block_cols)
+          : block_rows_(block_rows), block_cols_(block_cols) {
+      }
+    private:
+      size_t block_rows_;
+      size_t block_cols_;
+
+      index_storage_t ia_;
+      index_storage_t ja_;
+      index_storage_t partition_;
+
+      storage_t a_;
+    private:
+      friend block_compressed_row_matrix
+          details::bcrmatrix_from_arrays<scalar_t, storage_t, B>(size_t, size_t,
+              index_storage_t &&, index_storage_t &&, storage_t &&);
+  };
+
+  template<size_t B>
+  using block_compressed_row_matrix_real = block_compressed_row_matrix<double, std::vector<double>, B>;
+  template<size_t B>
+  using block_compressed_row_matrix_complex =
+      block_compressed_row_matrix<std::complex<double>, std::vector<std::complex<double>>, B>;
+
+  namespace details {
+    // Takes over block compressed row arrays, block columns of each block row must be
+    //   sorted and unique and a must hold B * B values for every block
+    template<class Scalar, class Storage, size_t B>
+    block_compressed_row_matrix<Scalar, Storage, B> bcrmatrix_from_arrays(size_t block_rows, size_t block_cols,
+        std::vector<size_t> && ia, std::vector<size_t> && ja, Storage && a) {
+      assert(ia.size() == block_rows + 1);
+      assert(ja.size() == ia[block_rows] && a.size() == ia[block_rows] * B * B);
+
+      block_compressed_row_matrix<Scalar, Storage, B> res{block_rows, block_cols};
+
+      res.ia_ = std::move(ia);
+      res.ja_ = std::move(ja);
+      res.a_ = std::move(a);
+      csr_row_partition(block_rows, res.ia_, res.partition_);
+
+      return res;
+    }
+
+    // y = alpha * A x + beta * y for block rows first ... last - 1
+    template<size_t B, class Scalar>
+    void bsr_mv_prod_rows(size_t first, size_t last, size_t const * ia, size_t const * ja, Scalar const * a,
+        Scalar const * x, Scalar * y, Scalar alpha, Scalar beta) {
+      bool overwrite = beta == Scalar();
+      for (size_t i = first; i < last; ++i) {
+        Scalar acc[B] = {};
+        for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+          block_mv_add<B>(a + p * B * B, x + ja[p] * B, acc);
+        }
+        Scalar * y_i = y + i * B;
+        for (size_t r = 0; r < B; ++r) {
+          y_i[r] = overwrite ? alpha * acc[r] : alpha * acc[r] + beta * y_i[r];
+        }
+      }
+    }
+  } // namespace details
+
+  // res = alpha * lhs * rhs + beta * res, res is not read if beta is zero
+  template<class Scalar, class Storage, size_t B>
+  void mvprod_into(block_compressed_row_matrix<Scalar, Storage, B> const & lhs
+      ,dense_vector<Scalar, Storage> const & rhs
+      ,dense_vector<Scalar, Storage> & res
+      ,typename dense_vector<Scalar, Storage>::scalar_t alpha = 1
+      ,typename dense_vector<Scalar, Storage>::scalar_t beta = 0) {
+    assert(&rhs != &res);
+    assert(lhs.dim2() == rhs.dim());
+    assert(lhs.dim1() == res.dim());
+
+    auto const & partition = lhs.row_partition();
+    auto const & ia = lhs.row_offsets();
+    auto const & ja = lhs.column_indices();
+    Scalar const * a = lhs.data().data();
+    Scalar const * x = rhs.data().data();
+    Scalar * y = res.data().data();
+
+    details::parallel_chunks(partition.size() - 1, details::SPMV_MIN_PARTS, 1, [&](size_t first, size_t last) {
+      details::bsr_mv_prod_rows<B>(partition[first], partition[last], ia.data(), ja.data(), a, x, y, alpha, beta);
+    });
+  }
+
+  template<class Scalar, class Storage, size_t B>
+  dense_vector<Scalar, Storage> mvprod(block_compressed_row_matrix<Scalar, Storage, B> const & lhs
+      , dense_vector<Scalar, Storage> const & rhs) {
+    dense_vector<Scalar, Storage> res{lhs.dim1()};
+    mvprod_into(lhs, rhs, res);
+    return res;
+  }
+
+  // Block form of a, whose dimensions must be multiples of B; blocks with any stored element are kept
+  template<size_t B, class Scalar, class Storage>
+  block_compressed_row_matrix<Scalar, Storage, B> make_block_compressed_row_matrix(
+      compressed_row_matrix<Scalar, Storage> const & a) {
+    assert(a.dim1() % B == 0 && a.dim2() % B == 0);
+
+    size_t block_rows = a.dim1() / B;
+    size_t block_cols = a.dim2() / B;
+    auto const & ia = a.row_offsets();
+    auto const & ja = a.column_indices();
+
+    std::vector<size_t> b_ia(1, 0);
+    std::vector<size_t> b_ja;
+    // Block of a block column in the current block row
+    std::vector<size_t> pos(block_cols, size_t(-1));
+    for (size_t bi = 0; bi < block_rows; ++bi) {
+      size_t row_begin = b_ja.size();
+      for (size_t i = bi * B; i < (bi + 1) * B; ++i) {
+        for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+          size_t bj = ja[p] / B;
+          if (pos[bj] == size_t(-1) || pos[bj] < row_begin) {
+            pos[bj] = b_ja.size();
+            b_ja.push_back(bj);
+          }
+        }
+      }
+      std::sort(b_ja.begin() + row_begin, b_ja.end());
+      b_ia.push_back(b_ja.size());
+    }
+
+    Storage b_a(b_ja.size() * B * B, Scalar());
+    for (size_t i = 0; i < a.dim1(); ++i) {
+      size_t bi = i / B;
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        size_t q = std::lower_bound(b_ja.begin() + b_ia[bi], b_ja.begin() + b_ia[bi + 1], ja[p] / B) - b_ja.begin();
+        b_a[q * B * B + (i % B) * B + ja[p] % B] = a.data()[p];
+      }
+    }
+
+    return details::bcrmatrix_from_arrays<Scalar, Storage, B>(block_rows, block_cols,
+        std::move(b_ia), std::move(b_ja), std::move(b_a));
+  }
+
+  // Element form of a with all elements of the stored blocks
+  template<class Scalar, class Storage, size_t B>
+  compressed_row_matrix<Scalar, Storage> make_compressed_row_matrix(
+      block_compressed_row_matrix<Scalar, Storage, B> const & a) {
+    auto const & b_ia = a.row_offsets();
+    auto const & b_ja = a.column_indices();
+
+    std::vector<size_t> ia(1, 0);
+    std::vector<size_t> ja;
+    Storage values;
+    ja.reserve(a.data().size());
+    values.reserve(a.data().size());
+    for (size_t i = 0; i < a.dim1(); ++i) {
+      size_t bi = i / B;
+      for (size_t q = b_ia[bi]; q < b_ia[bi + 1]; ++q) {
+        for (size_t c = 0; c < B; ++c) {
+          ja.push_back(b_ja[q] * B + c);
+          values.push_back(a.data()[q * B * B + (i % B) * B + c]);
+        }
+      }
+      ia.push_back(ja.size());
+    }
+
+    return details::crmatrix_from_arrays<Scalar, Storage>(a.dim1(), a.dim2(),
+        std::move(ia), std::move(ja), std::move(values));
+  }
+} } // namespace fe::la
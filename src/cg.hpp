@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <utility>
+#include <complex>
+
+#include "dense_vector.hpp"
+#include "blas1.hpp"
+#include "iterative.hpp"
+
+namespace fe { namespace la {
+  /**
+   * Preconditioned conjugate gradient method for symmetric (Hermitian) positive
+   * definite systems:
+   *
+   *   cg_solver_real cg{iterative_control(500, 1e-10)};
+   *   iterative_result res = cg.solve(a, b, x);  // x holds the initial guess
+   *
+   * Only four vectors are kept besides x and b. They are allocated by the first
+   * solve of a given dimension, later solves do not allocate memory.
+   */
+  template<class Scalar, class Storage>
+  class cg_solver {
+    public:
+      typedef Scalar scalar_t;
+      typedef Storage storage_t;
+
+      explicit cg_solver(iterative_control const & control = iterative_control())
+          : control_(control), r_(0), z_(0), p_(0), q_(0) {
+      }
+
+      iterative_control & control() {
+        return control_;
+      }
+
+      iterative_control const & control() const {
+        return control_;
+      }
+
+      // Called with the residual norm of the initial guess and of every iteration
+      void set_residual_callback(residual_callback_t callback) {
+        callback_ = std::move(callback);
+      }
+
+      template<class Operator>
+      iterative_result solve(Operator const & A, dense_vector<Scalar, Storage> const & b,
+          dense_vector<Scalar, Storage> & x) {
+        return solve(A, b, x, identity_preconditioner());
+      }
+
+      template<class Operator, class Preconditioner>
+      iterative_result solve(Operator const & A, dense_vector<Scalar, Storage> const & b,
+          dense_vector<Scalar, Storage> & x, Preconditioner const & M) {
+        assert(b.dim() == x.dim());
+
+        size_t n = b.dim();
+        details::resize_workspace(r_, n);
+        details::resize_workspace(z_, n);
+        details::resize_workspace(p_, n);
+        details::resize_workspace(q_, n);
+
+        // r = b - A x
+        details::apply_operator(A, x, r_);
+        scal(Scalar(-1), r_);
+        axpy(Scalar(1), b, r_);
+
+        double stop_norm = details::stopping_norm(control_, nrm2(b));
+        iterative_result res{0, nrm2(r_), false};
+        report(res);
+        if (res.residual_norm <= stop_norm) {
+          res.converged = true;
+          return res;
+        }
+
+        M.apply(r_, z_);
+        p_ = z_;
+        Scalar rz = dotc(r_, z_);
+
+        while (res.iterations < control_.max_iterations) {
+          details::apply_operator(A, p_, q_);
+          Scalar pq = dotc(p_, q_);
+          if (pq == Scalar()) {
+            break;
+          }
+
+          Scalar alpha = rz / pq;
+          axpy(alpha, p_, x);
+          axpy(-alpha, q_, r_);
+
+          ++res.iterations;
+          res.residual_norm = nrm2(r_);
+          report(res);
+          if (res.residual_norm <= stop_norm) {
+            res.converged = true;
+            break;
+          }
+
+          M.apply(r_, z_);
+          Scalar rz_next = dotc(r_, z_);
+
+          // p = z + beta * p
+          scal(rz_next / rz, p_);
+          axpy(Scalar(1), z_, p_);
+          rz = rz_next;
+        }
+
+        return res;
+      }
+    private:
+      void report(iterative_result const & res) const {
+        if (callback_) {
+          callback_(res.iterations, res.residual_norm);
+        }
+      }
+    private:
+      iterative_control control_;
+      residual_callback_t callback_;
+
+      // Residual, preconditioned residual, search direction and A times it
+      dense_vector<Scalar, Storage> r_;
+      dense_vector<Scalar, Storage> z_;
+      dense_vector<Scalar, Storage> p_;
+      dense_vector<Scalar, Storage> q_;
+  };
+
+  typedef cg_solver<double, std::vector<double>> cg_solver_real;
+  typedef cg_solver<std::complex<double>, std::vector<std::complex<double>>> cg_solver_complex;
+} } // namespace fe::la
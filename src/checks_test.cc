@@ -0,0 +1,1201 @@
+#include <iostream>
+#include <cstdlib>
+#include <cassert>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <complex>
+#include "dense_matrix.hpp"
+#include "dense_vector.hpp"
+#include "products.hpp"
+#include "blas1.hpp"
+#include "threads.hpp"
+#include "compressed_row_matrix.hpp"
+#include "band_matrix.hpp"
+#include "rowprof_matrix.hpp"
+#include "conversions.hpp"
+#include "compressed_row_builder.hpp"
+#include "row_profile.hpp"
+#include "decomposition.hpp"
+#include "solve.hpp"
+#include "permutation.hpp"
+#include "sparsity_pattern.hpp"
+#include "reordering.hpp"
+#include "fill_reducing.hpp"
+#include "sparse_lu.hpp"
+#include "band_lu.hpp"
+#include "skyline_matrix.hpp"
+#include "symmetric_compressed_row_matrix.hpp"
+#include "sparse_cholesky.hpp"
+#include "iterative.hpp"
+#include "cg.hpp"
+#include "gmres.hpp"
+#include "bicgstab.hpp"
+#include "preconditioners.hpp"
+#include "amg.hpp"
+#include "sliced_ell_matrix.hpp"
+#include "block_compressed_row_builder.hpp"
+#include "block_compressed_row_matrix.hpp"
+
+// Checks kernels, factorizations and solvers against reference computations
+//   and residuals and fails if an error is above its tolerance.
+
+using namespace fe::la;
+
+namespace {
+  int failures = 0;
+
+  void check_value(std::string const & name, double error, double tolerance) {
+    bool ok = error <= tolerance;
+    std::cout << name << ": error " << error << (ok ? "" : "  FAILED") << "\n";
+    if (!ok) {
+      ++failures;
+    }
+  }
+
+  // Largest difference of elements of matrices of the same size relative to the largest element of b
+  template<class Scalar, class Storage>
+  double relative_difference(dense_matrix<Scalar, Storage> const & a, dense_matrix<Scalar, Storage> const & b) {
+    assert(a.data().size() == b.data().size());
+
+    double diff = 0.;
+    double norm = 0.;
+    for (size_t k = 0; k < a.data().size(); ++k) {
+      diff = std::max(diff, double(std::abs(a.data()[k] - b.data()[k])));
+      norm = std::max(norm, double(std::abs(b.data()[k])));
+    }
+    return norm == 0. ? diff : diff / norm;
+  }
+
+  dense_matrix_real make_dense(size_t dim1, size_t dim2, double seed) {
+    dense_matrix_real res(dim1, dim2);
+    for (size_t i = 0; i < dim1; ++i) {
+      for (size_t j = 0; j < dim2; ++j) {
+        res(i, j) = std::sin(seed + 0.7 * i + 0.3 * j);
+      }
+    }
+    return res;
+  }
+
+  dense_vector_real make_rhs(size_t n) {
+    dense_vector_real b(n);
+    for (size_t i = 0; i < n; ++i) {
+      b(i) = 1. + std::sin(0.1 * i);
+    }
+    return b;
+  }
+
+  // Blocked products against the i-j-k loop, sizes cover tiny products and
+  //   partial register tiles and cache blocks
+  void check_gemm() {
+    size_t const SIZES[][3] = {{1, 1, 1}, {5, 7, 3}, {33, 65, 17}, {150, 130, 300}};
+    for (auto const & size : SIZES) {
+      size_t m = size[0], n = size[1], k = size[2];
+      dense_matrix_real a = make_dense(m, k, 1.);
+      dense_matrix_real b = make_dense(k, n, 2.);
+
+      dense_matrix_real expected(m, n);
+      for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+          for (size_t l = 0; l < k; ++l) {
+            expected(i, j) += a(i, l) * b(l, j);
+          }
+        }
+      }
+      check_value("mprod " + std::to_string(m) + "x" + std::to_string(k) + " by " +
+          std::to_string(k) + "x" + std::to_string(n), relative_difference(mprod(a, b), expected), 1e-13);
+    }
+
+    dense_matrix_real a = make_dense(70, 90, 3.);
+    dense_vector_real x = make_rhs(90);
+    dense_vector_real expected(70);
+    for (size_t i = 0; i < 70; ++i) {
+      for (size_t j = 0; j < 90; ++j) {
+        expected(i) += a(i, j) * x(j);
+      }
+    }
+    check_value("mvprod of dense_matrix", relative_difference(mvprod(a, x), expected), 1e-13);
+
+    dense_vector_real y(70, vector_type::ROW_VECTOR);
+    for (size_t i = 0; i < 70; ++i) {
+      y(i) = x(i);
+    }
+    dense_vector_real expected_row(90, vector_type::ROW_VECTOR);
+    for (size_t j = 0; j < 90; ++j) {
+      for (size_t i = 0; i < 70; ++i) {
+        expected_row(j) += y(i) * a(i, j);
+      }
+    }
+    check_value("mvprod by dense_matrix", relative_difference(mvprod(y, a), expected_row), 1e-13);
+  }
+
+  // SIMD kernels against plain loops, the odd length leaves a tail after the vector loop
+  void check_blas1() {
+    size_t const n = 1003;
+    dense_vector_real x = make_rhs(n);
+    dense_vector_real y(n);
+    dense_vector_complex u(n);
+    dense_vector_complex v(n);
+    for (size_t i = 0; i < n; ++i) {
+      y(i) = std::cos(0.3 * i);
+      u(i) = std::complex<double>(x(i), y(i));
+      v(i) = std::complex<double>(-y(i), 2. * x(i));
+    }
+
+    double dot_expected = 0.;
+    double nrm2_expected = 0.;
+    std::complex<double> dotc_expected;
+    dense_vector_real axpy_expected(n);
+    dense_vector_complex caxpy_expected(n);
+    for (size_t i = 0; i < n; ++i) {
+      dot_expected += x(i) * y(i);
+      nrm2_expected += x(i) * x(i);
+      dotc_expected += std::conj(u(i)) * v(i);
+      axpy_expected(i) = y(i) + 0.5 * x(i);
+      caxpy_expected(i) = v(i) + std::complex<double>(0.5, -1.) * u(i);
+    }
+    nrm2_expected = std::sqrt(nrm2_expected);
+
+    check_value("dot", std::abs(dot(x, y) - dot_expected) / std::abs(dot_expected), 1e-13);
+    check_value("dotc", std::abs(dotc(u, v) - dotc_expected) / std::abs(dotc_expected), 1e-13);
+    check_value("nrm2", std::abs(nrm2(x) - nrm2_expected) / nrm2_expected, 1e-13);
+
+    axpy(0.5, x, y);
+    check_value("axpy", relative_difference(y, axpy_expected), 1e-15);
+    axpy(std::complex<double>(0.5, -1.), u, v);
+    check_value("axpy of complex vectors", relative_difference(v, caxpy_expected), 1e-15);
+    scal(-2., y);
+    scal(-0.5, y);
+    check_value("scal", relative_difference(y, axpy_expected), 1e-15);
+  }
+
+  // Squares of these elements underflow or overflow, the norm itself does not
+  void check_nrm2_range() {
+    dense_vector_real x(4);
+    for (double scale : {1e-200, 1e200}) {
+      for (size_t i = 0; i < 4; ++i) {
+        x(i) = scale;
+      }
+      check_value(scale < 1 ? "nrm2 of tiny elements" : "nrm2 of huge elements",
+          std::abs(nrm2(x) / (2 * scale) - 1), 1e-15);
+    }
+  }
+
+  // Parallel products must give exactly the serial results
+  void check_parallel_products() {
+    dense_matrix_real a = make_dense(300, 250, 1.);
+    dense_matrix_real b = make_dense(250, 270, 2.);
+    // Large enough for matrix by vector products to be split
+    dense_matrix_real m = make_dense(1200, 1000, 3.);
+    dense_vector_real x = make_rhs(1000);
+    dense_vector_real y(1200, vector_type::ROW_VECTOR);
+    for (size_t i = 0; i < 1200; ++i) {
+      y(i) = std::cos(0.2 * i);
+    }
+
+    size_t threads = num_threads();
+    set_num_threads(1);
+    dense_matrix_real c1 = mprod(a, b);
+    dense_vector_real ax1 = mvprod(m, x);
+    dense_vector_real ya1 = mvprod(y, m);
+    set_num_threads(4);
+    dense_matrix_real c4 = mprod(a, b);
+    dense_vector_real ax4 = mvprod(m, x);
+    dense_vector_real ya4 = mvprod(y, m);
+    set_num_threads(threads);
+
+    check_value("mprod with 4 threads", relative_difference(c4, c1), 0.);
+    check_value("mvprod of dense_matrix with 4 threads", relative_difference(ax4, ax1), 0.);
+    check_value("mvprod by dense_matrix with 4 threads", relative_difference(ya4, ya1), 0.);
+  }
+
+  // r = alpha * A x + beta * r and r = alpha * x A + beta * r for a matrix of any format
+  //   against the same with the dense matrix
+  template<template<class Sc, class St> class Matrix>
+  void check_mvprod_into(std::string const & name, dense_matrix_real const & dense) {
+    Matrix<double, std::vector<double>> const a = convert_matrix<Matrix>(dense);
+    dense_vector_real x = make_rhs(dense.dim2());
+    dense_vector_real y(dense.dim1(), vector_type::ROW_VECTOR);
+    dense_vector_real r(dense.dim1());
+    dense_vector_real s(dense.dim2(), vector_type::ROW_VECTOR);
+    for (size_t i = 0; i < dense.dim1(); ++i) {
+      y(i) = std::cos(0.2 * i);
+      r(i) = std::sin(0.5 * i);
+    }
+    for (size_t j = 0; j < dense.dim2(); ++j) {
+      s(j) = std::sin(0.4 * j);
+    }
+
+    dense_vector_real ax = mvprod(dense, x);
+    dense_vector_real ya = mvprod(y, dense);
+    dense_vector_real expected_col(dense.dim1());
+    dense_vector_real expected_row(dense.dim2(), vector_type::ROW_VECTOR);
+    for (size_t i = 0; i < dense.dim1(); ++i) {
+      expected_col(i) = 2. * ax(i) - 0.5 * r(i);
+    }
+    for (size_t j = 0; j < dense.dim2(); ++j) {
+      expected_row(j) = 2. * ya(j) - 0.5 * s(j);
+    }
+
+    mvprod_into(a, x, r, 2., -0.5);
+    mvprod_into(y, a, s, 2., -0.5);
+    check_value("mvprod_into of " + name, relative_difference(r, expected_col), 1e-14);
+    check_value("mvprod_into by " + name, relative_difference(s, expected_row), 1e-14);
+  }
+
+  // A matrix with half bandwidth 3 and some zeros inside the band
+  dense_matrix_real make_banded(size_t n) {
+    dense_matrix_real res(n, n);
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = i < 3 ? 0 : i - 3; j < std::min(n, i + 4); ++j) {
+        if ((i + 2 * j) % 5 != 1 || i == j) {
+          res(i, j) = (i == j ? 10. : 0.) + std::sin(0.7 * i + 0.3 * j);
+        }
+      }
+    }
+    return res;
+  }
+
+  // Element-wise expressions against plain loops, including one assigned to its own operand
+  void check_expressions() {
+    size_t const n = 101;
+    dense_vector_real x = make_rhs(n);
+    dense_vector_real y(n);
+    dense_vector_real z(n);
+    for (size_t i = 0; i < n; ++i) {
+      y(i) = std::cos(0.3 * i);
+      z(i) = std::sin(0.7 * i);
+    }
+
+    dense_vector_real expected(n);
+    for (size_t i = 0; i < n; ++i) {
+      expected(i) = 2. * x(i) - 0.5 * y(i) - z(i);
+    }
+    dense_vector_real w = 2. * x - 0.5 * y - z;
+    check_value("vector expression", relative_difference(w, expected), 1e-15);
+    y = 2. * x + (-0.5) * y - z;
+    check_value("vector expression assigned to its operand", relative_difference(y, expected), 1e-15);
+
+    dense_matrix_real a = make_dense(7, 9, 1.);
+    dense_matrix_real b = make_dense(7, 9, 2.);
+    dense_matrix_real c = make_dense(7, 9, 3.);
+    dense_matrix_real expected_mat(7, 9);
+    for (size_t i = 0; i < 7; ++i) {
+      for (size_t j = 0; j < 9; ++j) {
+        expected_mat(i, j) = a(i, j) + b(i, j) - 3. * c(i, j) + (a(i, j) - b(i, j));
+      }
+    }
+    dense_matrix_real m = a + b - 3. * c;
+    m += a - b;
+    check_value("matrix expression", relative_difference(m, expected_mat), 1e-15);
+  }
+
+  // Assembly of 1D elements on a ring in scrambled order, every node gets
+  //   duplicate entries from its two elements
+  void check_builder() {
+    size_t const n = 40;
+    dense_matrix_real expected(n, n);
+    for (size_t max_buffered : {0, 16}) {
+      compressed_row_builder_real builder(n, n, max_buffered);
+      for (size_t k = 0; k < n; ++k) {
+        size_t e = (k * 17) % n;
+        size_t nodes[2] = {e, (e + 1) % n};
+        double w = 1. + 0.1 * e;
+        dense_matrix_real block(2, 2);
+        block(0, 0) = block(1, 1) = w;
+        block(0, 1) = block(1, 0) = -w;
+        builder.add_block(nodes, nodes + 2, nodes, nodes + 2, block);
+        if (max_buffered == 0) {
+          for (size_t i = 0; i < 2; ++i) {
+            for (size_t j = 0; j < 2; ++j) {
+              expected(nodes[i], nodes[j]) += block(i, j);
+            }
+          }
+        }
+      }
+      compressed_row_matrix_real a = builder.build();
+      check_value(max_buffered == 0 ? "compressed_row_builder" : "compressed_row_builder with compaction",
+          relative_difference(convert_matrix<dense_matrix>(a), expected), 0.);
+    }
+  }
+
+  // Band and row-profile matrices made from a compressed_row_matrix and from triplets
+  //   summed into a row_profile shaped matrix
+  void check_profile_conversions(dense_matrix_real const & dense) {
+    auto csr = convert_matrix<compressed_row_matrix>(dense);
+    check_value("band_matrix from compressed_row_matrix",
+        relative_difference(convert_matrix<dense_matrix>(convert_matrix<band_matrix>(csr)), dense), 0.);
+    check_value("rowprof_matrix from compressed_row_matrix",
+        relative_difference(convert_matrix<dense_matrix>(convert_matrix<rowprof_matrix>(csr)), dense), 0.);
+
+    row_profile profile(csr);
+    rowprof_matrix_real summed(profile);
+    for (size_t i = 0; i < dense.dim1(); ++i) {
+      for (size_t j = 0; j < dense.dim2(); ++j) {
+        if (dense(i, j) != 0.) {
+          summed(i, j) += 0.25 * dense(i, j);
+          summed(i, j) += 0.75 * dense(i, j);
+        }
+      }
+    }
+    check_value("rowprof_matrix summed from triplets",
+        relative_difference(convert_matrix<dense_matrix>(summed), dense), 1e-16);
+  }
+
+  // Prints ||b - A x|| / ||b|| and counts it as a failure if it is above tolerance
+  template<class Matrix>
+  void check(std::string const & name, Matrix const & A, dense_vector_real const & x,
+      dense_vector_real const & b, double tolerance) {
+    dense_vector_real r{b};
+    mvprod_into(A, x, r, -1., 1.);
+    double residual = nrm2(r) / nrm2(b);
+
+    bool ok = residual <= tolerance;
+    std::cout << name << ": relative residual " << residual << (ok ? "" : "  FAILED") << "\n";
+    if (!ok) {
+      ++failures;
+    }
+  }
+
+  // 5-point finite differences of -div(grad u) + velocity * du/dx on an n x n grid,
+  //   symmetric positive definite for zero velocity
+  compressed_row_matrix_real make_convection_diffusion(size_t n, double velocity) {
+    compressed_row_builder_real builder(n * n, n * n);
+    for (size_t y = 0; y < n; ++y) {
+      for (size_t x = 0; x < n; ++x) {
+        size_t i = y * n + x;
+        builder.add(i, i, 4.);
+        if (x > 0) {
+          builder.add(i, i - 1, -1. - velocity);
+        }
+        if (x + 1 < n) {
+          builder.add(i, i + 1, -1. + velocity);
+        }
+        if (y > 0) {
+          builder.add(i, i - n, -1.);
+        }
+        if (y + 1 < n) {
+          builder.add(i, i + n, -1.);
+        }
+      }
+    }
+    return builder.build();
+  }
+
+  // Fill-in of the factors must be kept, the matrix has none of it
+  void check_crmatrix_lu(compressed_row_matrix_real const & convection) {
+    dense_vector_real b = make_rhs(convection.dim1());
+    auto lu = convection;
+    lu_decomposition(lu);
+    dense_vector_real x{b};
+    solve_lu_inplace(lu, x);
+    check("lu_decomposition of compressed_row_matrix", convection, x, b, 1e-10);
+  }
+
+  void check_at_most(std::string const & name, size_t value, size_t bound) {
+    bool ok = value <= bound;
+    std::cout << name << ": " << value << ", at most " << bound << (ok ? "" : "  FAILED") << "\n";
+    if (!ok) {
+      ++failures;
+    }
+  }
+
+  // P A P^T as a compressed_row_matrix
+  compressed_row_matrix_real reorder(compressed_row_matrix_real const & a, permutation const & perm) {
+    auto const & ia = a.row_offsets();
+    auto const & ja = a.column_indices();
+    compressed_row_builder_real builder(a.dim1(), a.dim2());
+    for (size_t i = 0; i < a.dim1(); ++i) {
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        builder.add(perm.new_index(i), perm.new_index(ja[p]), a.data()[p]);
+      }
+    }
+    return builder.build();
+  }
+
+  // The grid numbered in a scrambled order must get back a band and a profile no larger
+  //   than in the row by row numbering, and the reordered matrices must be P A P^T
+  void check_reordering(compressed_row_matrix_real const & poisson) {
+    size_t n = poisson.dim1();
+    std::vector<size_t> scramble(n);
+    for (size_t i = 0; i < n; ++i) {
+      scramble[i] = (i * 7 + 3) % n;
+    }
+    auto scrambled = reorder(poisson, permutation(scramble));
+
+    permutation rcm = reverse_cuthill_mckee(sparsity_pattern(scrambled));
+    auto band = convert_matrix<band_matrix>(scrambled, rcm);
+    check_at_most("band width after reverse Cuthill-McKee", band.band_width(),
+        convert_matrix<band_matrix>(poisson).band_width());
+
+    permutation sloan_perm = sloan(sparsity_pattern(scrambled));
+    auto profile = convert_matrix<rowprof_matrix>(scrambled, sloan_perm);
+    check_at_most("profile after Sloan", profile.data().size(),
+        convert_matrix<rowprof_matrix>(poisson).data().size());
+
+    auto expected_band = convert_matrix<dense_matrix>(reorder(scrambled, rcm));
+    auto expected_profile = convert_matrix<dense_matrix>(reorder(scrambled, sloan_perm));
+    check_value("band_matrix of P A P^T", relative_difference(convert_matrix<dense_matrix>(band), expected_band), 0.);
+    check_value("rowprof_matrix of P A P^T",
+        relative_difference(convert_matrix<dense_matrix>(profile), expected_profile), 0.);
+  }
+
+  // Factors of the reordered matrix must have less fill than in the natural order
+  //   and solve the original system
+  void check_fill_reducing(compressed_row_matrix_real const & convection) {
+    dense_vector_real b = make_rhs(convection.dim1());
+    auto natural = convection;
+    lu_decomposition(natural);
+
+    permutation const orderings[] = {
+      approximate_minimum_degree(sparsity_pattern(convection)),
+      nested_dissection(sparsity_pattern(convection))
+    };
+    std::string const names[] = {"minimum degree", "nested dissection"};
+    for (size_t k = 0; k < 2; ++k) {
+      auto lu = convert_matrix<compressed_row_matrix>(convection, orderings[k]);
+      lu_decomposition(lu);
+      check_at_most("LU non-null elements with " + names[k], lu.data().size(), natural.data().size());
+
+      dense_vector_real x{b};
+      solve_lu_inplace(lu, orderings[k], x);
+      check("lu_decomposition with " + names[k], convection, x, b, 1e-10);
+    }
+  }
+
+  // One analysis serves factorizations of matrices with the same pattern
+  void check_sparse_lu(compressed_row_matrix_real const & convection) {
+    dense_vector_real b = make_rhs(convection.dim1());
+    sparse_lu_real lu;
+    lu.analyze(convection, approximate_minimum_degree(sparsity_pattern(convection)));
+    lu.factorize(convection);
+    dense_vector_real x{b};
+    lu.solve(x);
+    check("sparse_lu", convection, x, b, 1e-10);
+
+    auto shifted = convection;
+    auto const & ia = shifted.row_offsets();
+    auto const & ja = shifted.column_indices();
+    for (size_t i = 0; i < shifted.dim1(); ++i) {
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        shifted.data()[p] *= ja[p] == i ? 1.5 : 0.5 + 0.001 * i;
+      }
+    }
+    lu.factorize(shifted);
+    x = b;
+    lu.solve(x);
+    check("sparse_lu refactorized", shifted, x, b, 1e-10);
+  }
+
+  void check_band_lu(compressed_row_matrix_real const & convection) {
+    dense_vector_real b = make_rhs(convection.dim1());
+    {
+      permutation perm = reverse_cuthill_mckee(sparsity_pattern(convection));
+      band_lu_real lu(convert_matrix<band_matrix>(convection, perm));
+      dense_vector_real x = permute(perm, b);
+      lu.solve(x);
+      x = unpermute(perm, x);
+      check("band_lu", convection, x, b, 1e-10);
+    }
+    {
+      // Bands are wide enough for the blocked factorization
+      auto wide = make_convection_diffusion(60, 0.4);
+      auto lu = convert_matrix<band_matrix>(wide);
+      lu_decomposition(lu);
+      dense_vector_real wide_b = make_rhs(wide.dim1());
+      dense_vector_real x{wide_b};
+      solve_lu_inplace(lu, x);
+      check("lu_decomposition of band_matrix", wide, x, wide_b, 1e-10);
+    }
+    {
+      // Zeros on the diagonal need row interchanges
+      dense_matrix_real dense = make_banded(50);
+      for (size_t i = 0; i < 50; i += 2) {
+        dense(i, i) = 0.;
+      }
+      auto a = convert_matrix<band_matrix>(dense);
+      band_lu_real lu(a);
+      dense_vector_real small_b = make_rhs(50);
+      dense_vector_real x{small_b};
+      lu.solve(x);
+      check("band_lu with pivoting", a, x, small_b, 1e-12);
+    }
+  }
+
+  void check_skyline(compressed_row_matrix_real const & poisson) {
+    dense_vector_real b = make_rhs(poisson.dim1());
+    {
+      auto skyline = convert_matrix<skyline_matrix>(poisson);
+      ldlt_decomposition(skyline);
+      dense_vector_real x{b};
+      solve_ldlt_inplace(skyline, x);
+      check("skyline ldlt", poisson, x, b, 1e-10);
+    }
+    {
+      auto skyline = convert_matrix<skyline_matrix>(poisson);
+      cholesky_decomposition(skyline);
+      dense_vector_real x{b};
+      solve_cholesky_inplace(skyline, x);
+      check("skyline cholesky", poisson, x, b, 1e-10);
+    }
+
+    // An arrow pointing down keeps all its fill in the last row
+    size_t const n = 1000;
+    compressed_row_builder_real builder(n, n);
+    for (size_t i = 0; i + 1 < n; ++i) {
+      builder.add(i, i, 2.);
+      builder.add(i, n - 1, 1. / n);
+      builder.add(n - 1, i, 1. / n);
+    }
+    builder.add(n - 1, n - 1, 2.);
+    auto arrow = builder.build();
+    auto skyline = convert_matrix<skyline_matrix>(arrow);
+    check_at_most("skyline elements of an arrow matrix", skyline.data().size(), 2 * n - 1);
+
+    ldlt_decomposition(skyline);
+    dense_vector_real arrow_b = make_rhs(n);
+    dense_vector_real x{arrow_b};
+    solve_ldlt_inplace(skyline, x);
+    check("skyline ldlt of an arrow matrix", arrow, x, arrow_b, 1e-12);
+  }
+
+  void check_sparse_cholesky(compressed_row_matrix_real const & poisson) {
+    dense_vector_real b = make_rhs(poisson.dim1());
+    auto symmetric = convert_matrix<symmetric_compressed_row_matrix>(poisson);
+    check_value("symmetric_compressed_row_matrix product",
+        relative_difference(mvprod(symmetric, b), mvprod(poisson, b)), 1e-15);
+
+    permutation perm = approximate_minimum_degree(sparsity_pattern(poisson));
+    for (auto type : {factorization_type::LLT, factorization_type::LDLT}) {
+      sparse_cholesky_real chol(type);
+      chol.analyze(symmetric, perm);
+      chol.factorize(symmetric);
+      dense_vector_real x{b};
+      chol.solve(x);
+      check(type == factorization_type::LLT ? "sparse_cholesky (LLT)" : "sparse_cholesky (LDLT)",
+          poisson, x, b, 1e-10);
+    }
+
+    // LDL^T does not need a positive definite matrix
+    auto indefinite = poisson;
+    auto const & ia = indefinite.row_offsets();
+    auto const & ja = indefinite.column_indices();
+    for (size_t i = 0; i < indefinite.dim1(); ++i) {
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        if (ja[p] == i) {
+          indefinite.data()[p] = 2.1;
+        }
+      }
+    }
+    auto symmetric_indefinite = convert_matrix<symmetric_compressed_row_matrix>(indefinite);
+    sparse_cholesky_real ldlt(factorization_type::LDLT);
+    ldlt.analyze(symmetric_indefinite, perm);
+    ldlt.factorize(symmetric_indefinite);
+    dense_vector_real x{b};
+    ldlt.solve(x);
+    check("sparse_cholesky (LDLT) of an indefinite matrix", indefinite, x, b, 1e-10);
+  }
+
+  // Substitution with the same factors in every storage: full triangles of a dense matrix,
+  //   non-null row iterators of a row profile and the arrays of a compressed row matrix
+  void check_lu_solve() {
+    dense_matrix_real banded = make_banded(50);
+    dense_vector_real b = make_rhs(50);
+    auto lu = banded;
+    lu_decomposition(lu);
+
+    dense_vector_real x{b};
+    solve_lu_inplace(lu, x);
+    check("solve_lu_inplace with dense_matrix factors", banded, x, b, 1e-12);
+
+    x = b;
+    solve_lu_inplace(convert_matrix<rowprof_matrix>(lu), x);
+    check("solve_lu_inplace with rowprof_matrix factors", banded, x, b, 1e-12);
+
+    x = b;
+    solve_lu_inplace(convert_matrix<compressed_row_matrix>(lu), x);
+    check("solve_lu_inplace with compressed_row_matrix factors", banded, x, b, 1e-12);
+  }
+
+  // Level-scheduled substitution must give exactly the serial solution, the grid is
+  //   large enough for the first levels of the minimum degree ordering to be split
+  void check_sparse_lu_levels() {
+    auto a = make_convection_diffusion(60, 0.4);
+    dense_vector_real b = make_rhs(a.dim1());
+    sparse_lu_real lu;
+    lu.analyze(a, approximate_minimum_degree(sparsity_pattern(a)));
+    lu.factorize(a);
+
+    size_t threads = num_threads();
+    set_num_threads(1);
+    dense_vector_real serial{b};
+    lu.solve(serial);
+    set_num_threads(4);
+    dense_vector_real parallel{b};
+    lu.solve(parallel);
+    set_num_threads(threads);
+
+    check("sparse_lu with 4 threads", a, parallel, b, 1e-10);
+    check_value("sparse_lu with 4 threads against 1 thread", relative_difference(parallel, serial), 0.);
+  }
+
+  // Columns of b as dense_vector
+  std::vector<dense_vector_real> split_columns(dense_matrix_real const & b) {
+    std::vector<dense_vector_real> res(b.dim2(), dense_vector_real(b.dim1()));
+    for (size_t j = 0; j < b.dim2(); ++j) {
+      for (size_t i = 0; i < b.dim1(); ++i) {
+        res[j](i) = b(i, j);
+      }
+    }
+    return res;
+  }
+
+  dense_matrix_real join_columns(std::vector<dense_vector_real> const & columns) {
+    dense_matrix_real res(columns[0].dim(), columns.size());
+    for (size_t j = 0; j < res.dim2(); ++j) {
+      for (size_t i = 0; i < res.dim1(); ++i) {
+        res(i, j) = columns[j](i);
+      }
+    }
+    return res;
+  }
+
+  // Blocks of right-hand sides against one by one solves, serial and split between threads.
+  //   Threads get other block widths, so SIMD kernels may round the last columns differently
+  void check_block_solve(compressed_row_matrix_real const & convection) {
+    size_t const n = convection.dim1();
+    size_t const k = 200;
+    dense_matrix_real b(n, k);
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < k; ++j) {
+        b(i, j) = std::sin(0.1 * i + 0.37 * j);
+      }
+    }
+
+    sparse_lu_real lu;
+    lu.analyze(convection, approximate_minimum_degree(sparsity_pattern(convection)));
+    lu.factorize(convection);
+    std::vector<dense_vector_real> columns = split_columns(b);
+    for (auto & column : columns) {
+      lu.solve(column);
+    }
+    dense_matrix_real expected = join_columns(columns);
+
+    auto factors = convection;
+    lu_decomposition(factors);
+
+    // Solutions by sparse_lu, by compressed row factors and by them for a vector of columns
+    auto solve_all = [&]() -> std::vector<dense_matrix_real> {
+      std::vector<dense_matrix_real> res(3, b);
+      lu.solve(res[0]);
+      solve_lu_inplace(factors, res[1]);
+      std::vector<dense_vector_real> xs = split_columns(b);
+      solve_lu_inplace(factors, xs);
+      res[2] = join_columns(xs);
+      return res;
+    };
+    std::string const names[] = {"sparse_lu block solve", "solve_lu_inplace of a block",
+        "solve_lu_inplace of vectors"};
+
+    size_t threads = num_threads();
+    set_num_threads(1);
+    std::vector<dense_matrix_real> serial = solve_all();
+    set_num_threads(4);
+    std::vector<dense_matrix_real> parallel = solve_all();
+    set_num_threads(threads);
+
+    for (size_t s = 0; s < 3; ++s) {
+      check_value(names[s], relative_difference(serial[s], expected), 1e-12);
+      check_value(names[s] + " with 4 threads", relative_difference(parallel[s], expected), 1e-12);
+    }
+  }
+
+  // Finite differences of -div(k grad u) on an n x n grid, zero on the boundary.
+  //   k changes by orders of magnitude, so diagonal scaling changes the spectrum
+  compressed_row_matrix_real make_variable_diffusion(size_t n) {
+    std::vector<double> k(n * n);
+    for (size_t y = 0; y < n; ++y) {
+      for (size_t x = 0; x < n; ++x) {
+        k[y * n + x] = std::pow(10., 2. * std::sin(0.3 * x) * std::cos(0.2 * y));
+      }
+    }
+
+    compressed_row_builder_real builder(n * n, n * n);
+    for (size_t y = 0; y < n; ++y) {
+      for (size_t x = 0; x < n; ++x) {
+        size_t i = y * n + x;
+        // Edges leaving the grid go to the boundary
+        size_t const neighbours[4] = {x > 0 ? i - 1 : i, x + 1 < n ? i + 1 : i, y > 0 ? i - n : i,
+            y + 1 < n ? i + n : i};
+        for (size_t j : neighbours) {
+          double edge = j == i ? k[i] : 0.5 * (k[i] + k[j]);
+          builder.add(i, i, edge);
+          if (j != i) {
+            builder.add(i, j, -edge);
+          }
+        }
+      }
+    }
+    return builder.build();
+  }
+
+  // z = r / diag(A), a preconditioner given by the caller
+  struct diagonal_scaling {
+    dense_vector_real inverse_diagonal;
+
+    explicit diagonal_scaling(compressed_row_matrix_real const & a)
+        : inverse_diagonal(a.dim1()) {
+      for (size_t i = 0; i < a.dim1(); ++i) {
+        inverse_diagonal(i) = 1. / a(i, i);
+      }
+    }
+
+    void apply(dense_vector_real const & r, dense_vector_real & z) const {
+      for (size_t i = 0; i < r.dim(); ++i) {
+        z(i) = inverse_diagonal(i) * r(i);
+      }
+    }
+  };
+
+  void check_iterations(std::string const & name, iterative_result const & result, size_t max_iterations) {
+    check_at_most(name + " iterations", result.iterations, max_iterations);
+    if (!result.converged) {
+      std::cout << name << ": not converged  FAILED\n";
+      ++failures;
+    }
+  }
+
+  void check_cg(compressed_row_matrix_real const & poisson) {
+    size_t n = poisson.dim1();
+    dense_vector_real b = make_rhs(n);
+    double const TOLERANCE = 1e-7;
+
+    cg_solver_real cg{iterative_control(2000, 1e-9)};
+    {
+      size_t last_iteration = 0;
+      cg.set_residual_callback([&](size_t iteration, double) { last_iteration = iteration; });
+      dense_vector_real x(n);
+      iterative_result result = cg.solve(poisson, b, x);
+      cg.set_residual_callback(residual_callback_t());
+      check("cg", poisson, x, b, TOLERANCE);
+      check_at_most("cg iterations reported to the callback", result.iterations, last_iteration);
+    }
+    {
+      dense_vector_real x(n);
+      cg.solve([&](dense_vector_real const & v, dense_vector_real & w) { mvprod_into(poisson, v, w); }, b, x);
+      check("cg with a callable", poisson, x, b, TOLERANCE);
+    }
+
+    // Diagonal scaling must pay off for strongly varying coefficients
+    auto variable = make_variable_diffusion(30);
+    dense_vector_real x(n);
+    iterative_result plain = cg.solve(variable, b, x);
+    check("cg with variable coefficients", variable, x, b, TOLERANCE);
+    x = dense_vector_real(n);
+    iterative_result scaled = cg.solve(variable, b, x, diagonal_scaling(variable));
+    check("cg + diagonal scaling with variable coefficients", variable, x, b, TOLERANCE);
+    check_iterations("cg + diagonal scaling with variable coefficients", scaled, plain.iterations / 2);
+  }
+
+  void check_nonsymmetric_solvers(compressed_row_matrix_real const & convection) {
+    size_t n = convection.dim1();
+    dense_vector_real b = make_rhs(n);
+    double const TOLERANCE = 1e-7;
+
+    gmres_solver_real gmres{iterative_control(2000, 1e-9)};
+    bicgstab_solver_real bicgstab{iterative_control(2000, 1e-9)};
+    {
+      dense_vector_real x(n);
+      gmres.solve(convection, b, x);
+      check("gmres", convection, x, b, TOLERANCE);
+    }
+    {
+      dense_vector_real x(n);
+      bicgstab.solve(convection, b, x);
+      check("bicgstab", convection, x, b, TOLERANCE);
+    }
+
+    // Preconditioners applied on either side must cut the iterations for strongly varying coefficients
+    auto variable = make_variable_diffusion(30);
+    dense_vector_real x(n);
+    size_t plain = gmres.solve(variable, b, x).iterations;
+    x = dense_vector_real(n);
+    iterative_result right = gmres.solve(variable, b, x, diagonal_scaling(variable));
+    check("gmres + diagonal scaling", variable, x, b, TOLERANCE);
+    check_iterations("gmres + diagonal scaling", right, plain / 2);
+
+    // The tolerance applies to the preconditioned residual
+    gmres_solver_real left_gmres{iterative_control(2000, 1e-11), 30, preconditioning_side::LEFT};
+    x = dense_vector_real(n);
+    iterative_result left = left_gmres.solve(variable, b, x, diagonal_scaling(variable));
+    check("gmres (left) + diagonal scaling", variable, x, b, TOLERANCE);
+    check_iterations("gmres (left) + diagonal scaling", left, plain / 2);
+
+    x = dense_vector_real(n);
+    plain = bicgstab.solve(variable, b, x).iterations;
+    x = dense_vector_real(n);
+    iterative_result scaled = bicgstab.solve(variable, b, x, diagonal_scaling(variable));
+    check("bicgstab + diagonal scaling", variable, x, b, TOLERANCE);
+    check_iterations("bicgstab + diagonal scaling", scaled, plain / 2);
+
+    bicgstab_solver_real left_bicgstab{iterative_control(2000, 1e-11), preconditioning_side::LEFT};
+    x = dense_vector_real(n);
+    iterative_result left_scaled = left_bicgstab.solve(variable, b, x, diagonal_scaling(variable));
+    check("bicgstab (left) + diagonal scaling", variable, x, b, TOLERANCE);
+    check_iterations("bicgstab (left) + diagonal scaling", left_scaled, plain / 2);
+  }
+
+  // The coefficients vary strongly, so every preconditioner must cut the iterations
+  //   at least in half, incomplete factorizations more than diagonal ones
+  void check_preconditioners(compressed_row_matrix_real const & convection) {
+    auto variable = make_variable_diffusion(30);
+    size_t n = variable.dim1();
+    dense_vector_real b = make_rhs(n);
+    double const TOLERANCE = 1e-7;
+
+    cg_solver_real cg{iterative_control(2000, 1e-9)};
+    dense_vector_real x(n);
+    size_t plain = cg.solve(variable, b, x).iterations;
+
+    x = dense_vector_real(n);
+    iterative_result jacobi = cg.solve(variable, b, x, jacobi_preconditioner_real(variable));
+    check("cg + jacobi", variable, x, b, TOLERANCE);
+    check_iterations("cg + jacobi", jacobi, plain / 2);
+
+    x = dense_vector_real(n);
+    iterative_result block_jacobi = cg.solve(variable, b, x, block_jacobi_preconditioner_real(variable, 3));
+    check("cg + block jacobi", variable, x, b, TOLERANCE);
+    check_iterations("cg + block jacobi", block_jacobi, plain / 2);
+
+    x = dense_vector_real(n);
+    iterative_result ic0 = cg.solve(variable, b, x, ic0_preconditioner_real(variable));
+    check("cg + ic0", variable, x, b, TOLERANCE);
+    check_iterations("cg + ic0", ic0, jacobi.iterations);
+
+    gmres_solver_real gmres{iterative_control(2000, 1e-9)};
+    x = dense_vector_real(n);
+    size_t gmres_plain = gmres.solve(convection, b, x).iterations;
+
+    x = dense_vector_real(n);
+    iterative_result ilu0 = gmres.solve(convection, b, x, ilu0_preconditioner_real(convection));
+    check("gmres + ilu0", convection, x, b, TOLERANCE);
+    check_iterations("gmres + ilu0", ilu0, gmres_plain / 2);
+
+    x = dense_vector_real(n);
+    iterative_result ilut = gmres.solve(convection, b, x, ilut_preconditioner_real(convection, 1e-3, 10));
+    check("gmres + ilut", convection, x, b, TOLERANCE);
+    check_iterations("gmres + ilut", ilut, ilu0.iterations);
+  }
+
+  // Block Jacobi blocks needing row interchanges after the first elimination step
+  void check_block_jacobi_pivoting() {
+    double const block[3][3] = {{1., 2., 0.}, {2., 1., 3.}, {4., 1., 1.}};
+    dense_matrix_real dense(6, 6);
+    for (size_t b = 0; b < 2; ++b) {
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+          dense(3 * b + i, 3 * b + j) = block[i][j] * (b + 1);
+        }
+      }
+    }
+    auto A = convert_matrix<compressed_row_matrix>(dense);
+
+    dense_vector_real r = make_rhs(6);
+    dense_vector_real z(6);
+    block_jacobi_preconditioner_real(A, 3).apply(r, z);
+    check("block jacobi with pivoting", A, z, r, 1e-12);
+  }
+
+  // Iterations of cg + amg must stay about the same when the grid is refined, with a
+  //   one-level preconditioner they would double with every refinement
+  void check_amg() {
+    size_t const GRIDS[] = {20, 40, 80};
+    size_t iterations[3];
+    cg_solver_real cg{iterative_control(2000, 1e-9)};
+    for (size_t g = 0; g < 3; ++g) {
+      auto poisson = make_convection_diffusion(GRIDS[g], 0.);
+      size_t n = poisson.dim1();
+      dense_vector_real b = make_rhs(n);
+      dense_vector_real x(n);
+      std::string name = "cg + amg on a " + std::to_string(GRIDS[g]) + "x" + std::to_string(GRIDS[g]) + " grid";
+      iterative_result result = cg.solve(poisson, b, x,
+          amg_preconditioner_real(poisson, amg_control(1, 0.08, amg_smoother::GAUSS_SEIDEL, 1, 50)));
+      check(name, poisson, x, b, 1e-7);
+      iterations[g] = result.iterations;
+    }
+    check_at_most("cg + amg iterations on the finest grid", iterations[2], iterations[0] * 3 / 2);
+
+    auto variable = make_variable_diffusion(40);
+    dense_vector_real b = make_rhs(variable.dim1());
+    dense_vector_real x(variable.dim1());
+    cg.solve(variable, b, x, amg_preconditioner_real(variable, amg_control(1, 0.08, amg_smoother::JACOBI, 2, 50)));
+    check("cg + amg with a jacobi smoother and variable coefficients", variable, x, b, 1e-7);
+
+    // Hermitian Laplacian with a magnetic phase on the horizontal links, the restriction
+    //   must be the conjugate transpose of the prolongator for the V-cycle to stay Hermitian
+    size_t const grid = 40;
+    compressed_row_builder_complex builder(grid * grid, grid * grid);
+    for (size_t y = 0; y < grid; ++y) {
+      std::complex<double> phase = std::polar(1., 0.15 * y);
+      for (size_t x = 0; x < grid; ++x) {
+        size_t i = y * grid + x;
+        builder.add(i, i, 4.);
+        if (x > 0) {
+          builder.add(i, i - 1, -std::conj(phase));
+        }
+        if (x + 1 < grid) {
+          builder.add(i, i + 1, -phase);
+        }
+        if (y > 0) {
+          builder.add(i, i - grid, -1.);
+        }
+        if (y + 1 < grid) {
+          builder.add(i, i + grid, -1.);
+        }
+      }
+    }
+    auto hermitian = builder.build();
+    size_t n = hermitian.dim1();
+    dense_vector_complex hb(n);
+    dense_vector_real real_b = make_rhs(n);
+    for (size_t i = 0; i < n; ++i) {
+      hb(i) = std::complex<double>(real_b(i), 1. - real_b(i));
+    }
+    dense_vector_complex hx(n);
+    cg_solver_complex hcg{iterative_control(2000, 1e-9)};
+    iterative_result hermitian_result = hcg.solve(hermitian, hb, hx,
+        amg_preconditioner_complex(hermitian, amg_control(1, 0.08, amg_smoother::GAUSS_SEIDEL, 1, 50)));
+    dense_vector_complex hr{hb};
+    mvprod_into(hermitian, hx, hr, -1., 1.);
+    check_value("cg + amg with a complex Hermitian matrix", nrm2(hr) / nrm2(hb), 1e-7);
+    check_at_most("cg + amg iterations with a complex Hermitian matrix", hermitian_result.iterations,
+        iterations[1] * 2);
+  }
+
+  // The matrix has enough nonzeros for 4 threads to get parts of the row partition,
+  //   products with them must give exactly the serial result
+  void check_parallel_spmv() {
+    auto a = make_convection_diffusion(130, 0.4);
+    size_t n = a.dim1();
+    dense_vector_real x = make_rhs(n);
+    dense_vector_real y0(n);
+    for (size_t i = 0; i < n; ++i) {
+      y0(i) = std::cos(0.3 * i);
+    }
+
+    dense_vector_real expected(n);
+    auto const & ia = a.row_offsets();
+    auto const & ja = a.column_indices();
+    for (size_t i = 0; i < n; ++i) {
+      double sum = 0.;
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        sum += a.data()[p] * x(ja[p]);
+      }
+      expected(i) = 2. * sum - 0.5 * y0(i);
+    }
+
+    size_t threads = num_threads();
+    set_num_threads(1);
+    dense_vector_real serial{y0};
+    mvprod_into(a, x, serial, 2., -0.5);
+    set_num_threads(4);
+    dense_vector_real parallel{y0};
+    mvprod_into(a, x, parallel, 2., -0.5);
+    set_num_threads(threads);
+
+    check_value("compressed_row_matrix product", relative_difference(serial, expected), 1e-15);
+    check_value("compressed_row_matrix product with 4 threads against 1 thread",
+        relative_difference(parallel, serial), 0.);
+  }
+
+  // Rows of very different lengths get sorted and padded, the product must still match
+  //   the one of the compressed_row_matrix for the SIMD and the portable chunk sizes
+  void check_sliced_ell(compressed_row_matrix_real const & poisson) {
+    size_t const n = 1000;
+    compressed_row_builder_real builder(n, n);
+    for (size_t i = 0; i < n; ++i) {
+      builder.add(i, i, 10.);
+      for (size_t k = 1; k <= (i * 7) % 23; ++k) {
+        builder.add(i, (i * 31 + k * 97) % n, std::sin(0.1 * i + k));
+      }
+    }
+    auto a = builder.build();
+    dense_vector_real x = make_rhs(n);
+    dense_vector_real expected = mvprod(a, x);
+
+    check_value("sliced_ell_matrix product",
+        relative_difference(mvprod(convert_matrix<sliced_ell_matrix>(a), x), expected), 1e-15);
+    check_value("sliced_ell_matrix product with 4 row chunks",
+        relative_difference(mvprod(make_sliced_ell_matrix(a, 4, 32), x), expected), 1e-15);
+    check_value("compressed_row_matrix from sliced_ell_matrix", relative_difference(
+        convert_matrix<dense_matrix>(convert_matrix<compressed_row_matrix>(convert_matrix<sliced_ell_matrix>(a))),
+        convert_matrix<dense_matrix>(a)), 0.);
+
+    auto sell = convert_matrix<sliced_ell_matrix>(poisson);
+    dense_vector_real b = make_rhs(poisson.dim1());
+    dense_vector_real y(poisson.dim1());
+    cg_solver_real cg{iterative_control(2000, 1e-9)};
+    cg.solve(sell, b, y);
+    check("cg with sliced_ell_matrix", poisson, y, b, 1e-7);
+  }
+
+  // The Poisson matrix with 2 coupled unknowns per node in block form
+  void check_block_matrix(compressed_row_matrix_real const & poisson) {
+    size_t nodes = poisson.dim1();
+    double const coupling[4] = {2., 0.5, 0.5, 1.};
+
+    block_compressed_row_builder_real<2> builder(nodes, nodes);
+    auto const & ia = poisson.row_offsets();
+    auto const & ja = poisson.column_indices();
+    for (size_t i = 0; i < nodes; ++i) {
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        double block[4];
+        for (size_t k = 0; k < 4; ++k) {
+          block[k] = poisson.data()[p] * coupling[k];
+        }
+        builder.add(i, ja[p], block);
+      }
+    }
+    auto A = builder.build();
+    auto scalar = make_compressed_row_matrix(A);
+
+    dense_vector_real b = make_rhs(A.dim1());
+    check_value("block_compressed_row_matrix product", relative_difference(mvprod(A, b), mvprod(scalar, b)), 1e-15);
+
+    cg_solver_real cg{iterative_control(2000, 1e-9)};
+    {
+      dense_vector_real x(A.dim1());
+      cg.solve(A, b, x, block_ilu0_preconditioner_real<2>(A));
+      check("cg + block ilu0 with block_compressed_row_matrix", scalar, x, b, 1e-7);
+    }
+    {
+      dense_vector_real x(A.dim1());
+      cg.solve(A, b, x, block_jacobi_preconditioner_real(A));
+      check("cg + block jacobi with block_compressed_row_matrix", scalar, x, b, 1e-7);
+    }
+  }
+
+  // x A by rows of A against the product by the explicit transpose, with threads
+  //   scattering into their own buffers when the matrix has enough parts
+  void check_transposed_products() {
+    auto csr = make_convection_diffusion(130, 0.4);
+    auto small = make_convection_diffusion(60, 0.4);
+    auto rowprof = convert_matrix<rowprof_matrix>(small);
+
+    size_t threads = num_threads();
+    set_num_threads(1);
+    dense_vector_real serial = mvprod(make_rhs(csr.dim1()), csr);
+
+    for (size_t count : {1, 4}) {
+      set_num_threads(count);
+      std::string suffix = count == 1 ? "" : " with 4 threads";
+
+      dense_vector_real x = make_rhs(csr.dim1());
+      dense_vector_real y(csr.dim2(), vector_type::ROW_VECTOR);
+      mvprod_into(x, csr, y);
+      dense_vector_real expected = mvprod(transpose(csr), x);
+      check_value("compressed_row_matrix transposed product" + suffix, relative_difference(y, expected), 1e-15);
+
+      // Scheduling must not change the result
+      dense_vector_real again(csr.dim2(), vector_type::ROW_VECTOR);
+      mvprod_into(x, csr, again);
+      check_value("compressed_row_matrix transposed product repeated" + suffix, relative_difference(again, y), 0.);
+
+      // A caller-owned workspace reused by two products
+      transposed_prod_workspace<double> work;
+      dense_vector_real with_work(csr.dim2(), vector_type::ROW_VECTOR);
+      mvprod_into(x, csr, with_work, work, 2., 0.);
+      mvprod_into(x, csr, with_work, work);
+      check_value("compressed_row_matrix transposed product with a workspace" + suffix,
+          relative_difference(with_work, y), 0.);
+
+      // Products by a shared const matrix inside a parallel loop run serially
+      std::vector<dense_vector_real> nested(4, dense_vector_real(csr.dim2(), vector_type::ROW_VECTOR));
+      details::parallel_chunks(nested.size(), 1, 1, [&](size_t first, size_t last) {
+        for (size_t k = first; k < last; ++k) {
+          mvprod_into(x, csr, nested[k]);
+        }
+      });
+      for (auto const & v : nested) {
+        check_value("compressed_row_matrix transposed product in a parallel loop" + suffix,
+            relative_difference(v, serial), 0.);
+      }
+
+      dense_vector_real z = make_rhs(rowprof.dim1());
+      dense_vector_real w(rowprof.dim2(), vector_type::ROW_VECTOR);
+      mvprod_into(z, rowprof, w, 2., 0.);
+      dense_vector_real expected_w = mvprod(transpose(small), z);
+      scal(2., expected_w);
+      check_value("rowprof_matrix transposed product" + suffix, relative_difference(w, expected_w), 1e-15);
+    }
+    set_num_threads(threads);
+  }
+}
+
+int main() {
+  check_gemm();
+
+  check_blas1();
+  check_nrm2_range();
+
+  check_parallel_products();
+
+  dense_matrix_real banded = make_banded(50);
+  check_mvprod_into<dense_matrix>("dense_matrix", make_dense(40, 60, 4.));
+  check_mvprod_into<compressed_row_matrix>("compressed_row_matrix", make_dense(40, 60, 5.));
+  check_mvprod_into<band_matrix>("band_matrix", banded);
+  check_mvprod_into<rowprof_matrix>("rowprof_matrix", banded);
+
+  check_expressions();
+
+  check_builder();
+
+  check_profile_conversions(banded);
+
+  size_t const GRID = 30;
+  auto convection = make_convection_diffusion(GRID, 0.4);
+  check_crmatrix_lu(convection);
+
+  auto poisson = make_convection_diffusion(GRID, 0.);
+  check_reordering(poisson);
+
+  check_fill_reducing(convection);
+
+  check_sparse_lu(convection);
+
+  check_band_lu(convection);
+
+  check_skyline(poisson);
+
+  check_sparse_cholesky(poisson);
+
+  check_lu_solve();
+
+  check_sparse_lu_levels();
+
+  check_block_solve(convection);
+
+  check_cg(poisson);
+
+  check_nonsymmetric_solvers(convection);
+
+  check_preconditioners(convection);
+  check_block_jacobi_pivoting();
+
+  check_amg();
+
+  check_parallel_spmv();
+
+  check_sliced_ell(poisson);
+
+  check_block_matrix(poisson);
+
+  check_transposed_products();
+
+  if (failures != 0) {
+    std::cout << failures << " checks FAILED\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "All checks passed\n";
+  return EXIT_SUCCESS;
+}
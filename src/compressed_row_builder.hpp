@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <iterator>
+
+#include "compressed_row_matrix.hpp"
+
+namespace fe { namespace la {
+  namespace details {
+    // Turns (row, column, value) triplets into compressed row arrays.
+    // Columns of every row are sorted, values of duplicate entries are summed.
+    // Triplet arrays are released as soon as they are not needed.
+    // Works in O(nnz log(nnz)) time and O(nnz + dim1) memory.
+    template<class Scalar, class Storage>
+    void compress_triplets(size_t dim1,
+        std::vector<size_t> & rows, std::vector<size_t> & cols, Storage & values,
+        std::vector<size_t> & ia, std::vector<size_t> & ja, Storage & a) {
+      assert(rows.size() == cols.size() && rows.size() == values.size());
+
+      size_t count = rows.size();
+
+      // Count elements in every row and turn counts into row offsets
+      ia.assign(dim1 + 1, 0);
+      for (size_t k = 0; k < count; ++k) {
+        assert(rows[k] < dim1);
+        ++ia[rows[k] + 1];
+      }
+      for (size_t i = 0; i < dim1; ++i) {
+        ia[i + 1] += ia[i];
+      }
+
+      // Scatter triplets to their rows
+      ja.resize(count);
+      a.resize(count);
+      {
+        std::vector<size_t> next(ia.begin(), ia.end() - 1);
+        for (size_t k = 0; k < count; ++k) {
+          size_t pos = next[rows[k]]++;
+          ja[pos] = cols[k];
+          a[pos] = values[k];
+        }
+      }
+      std::vector<size_t>().swap(rows);
+      std::vector<size_t>().swap(cols);
+      Storage().swap(values);
+
+      // Sort every row by column, sum duplicates and squeeze out the gaps
+      std::vector<std::pair<size_t, Scalar>> row;
+      size_t write = 0;
+      for (size_t i = 0; i < dim1; ++i) {
+        size_t first = ia[i];
+        size_t last = ia[i + 1];
+        ia[i] = write;
+
+        row.clear();
+        for (size_t k = first; k < last; ++k) {
+          row.emplace_back(ja[k], a[k]);
+        }
+        // Stable sort keeps duplicates in the order they were added
+        std::stable_sort(row.begin(), row.end(),
+            [](std::pair<size_t, Scalar> const & l, std::pair<size_t, Scalar> const & r) {
+              return l.first < r.first;
+            });
+
+        for (size_t k = 0; k < row.size(); ++k) {
+          if (write > ia[i] && ja[write - 1] == row[k].first) {
+            a[write - 1] += row[k].second;
+          } else {
+            ja[write] = row[k].first;
+            a[write] = row[k].second;
+            ++write;
+          }
+        }
+      }
+      ia[dim1] = write;
+
+      ja.resize(write);
+      a.resize(write);
+      ja.shrink_to_fit();
+      a.shrink_to_fit();
+    }
+  } // namespace details
+
+  /**
+   * Builds a compressed_row_matrix from (row, column, value) triplets,
+   * without ever storing the matrix in dense form.
+   * Triplets may come in any order, values of duplicate triplets are summed
+   * (which is what assembly of finite element matrices needs).
+   *
+   * When max_buffered is not zero, duplicates are merged every time the number
+   * of stored triplets reaches it, so memory stays proportional to the number
+   * of distinct entries rather than to the number of added triplets.
+   */
+  template<class Scalar, class Storage>
+  class compressed_row_builder {
+    public:
+      compressed_row_builder(size_t dim1, size_t dim2, size_t max_buffered = 0)
+          : dim1_(dim1), dim2_(dim2), max_buffered_(max_buffered),
+            compact_threshold_(max_buffered) {
+      }
+
+      size_t dim1() const {
+        return dim1_;
+      }
+
+      size_t dim2() const {
+        return dim2_;
+      }
+
+      // Number of triplets currently stored
+      size_t size() const {
+        return rows_.size();
+      }
+
+      void reserve(size_t count) {
+        rows_.reserve(count);
+        cols_.reserve(count);
+        values_.reserve(count);
+      }
+
+      void add(size_t i, size_t j, Scalar value) {
+        assert(i < dim1());
+        assert(j < dim2());
+
+        rows_.push_back(i);
+        cols_.push_back(j);
+        values_.push_back(value);
+
+        if (compact_threshold_ != 0 && size() >= compact_threshold_) {
+          compact();
+        }
+      }
+
+      // Adds a batch of triplets given by three parallel sequences
+      template<class RowIter, class ColIter, class ValueIter>
+      void add(RowIter rows_first, RowIter rows_last, ColIter cols_first, ValueIter values_first) {
+        for (; rows_first != rows_last; ++rows_first, ++cols_first, ++values_first) {
+          add(*rows_first, *cols_first, *values_first);
+        }
+      }
+
+      // Adds a dense element matrix, the index ranges give global positions of its rows and columns
+      template<class RowIndexIter, class ColIndexIter, class Matrix>
+      void add_block(RowIndexIter rows_first, RowIndexIter rows_last,
+          ColIndexIter cols_first, ColIndexIter cols_last, Matrix const & block) {
+        size_t i = 0;
+        for (auto row = rows_first; row != rows_last; ++row, ++i) {
+          size_t j = 0;
+          for (auto col = cols_first; col != cols_last; ++col, ++j) {
+            add(*row, *col, block(i, j));
+          }
+        }
+      }
+
+      // Sorts the stored triplets and merges duplicates
+      void compact() {
+        std::vector<size_t> ia;
+        std::vector<size_t> ja;
+        Storage a;
+        details::compress_triplets<Scalar>(dim1_, rows_, cols_, values_, ia, ja, a);
+
+        rows_.resize(ja.size());
+        for (size_t i = 0; i < dim1_; ++i) {
+          std::fill(rows_.begin() + ia[i], rows_.begin() + ia[i + 1], i);
+        }
+        cols_ = std::move(ja);
+        values_ = std::move(a);
+
+        // Grow the threshold with the number of distinct entries,
+        //   so the total work of all compactions stays O(nnz log(nnz))
+        if (max_buffered_ != 0) {
+          compact_threshold_ = std::max(max_buffered_, 2 * size());
+        }
+      }
+
+      // Makes the matrix from all added triplets, the builder is empty afterwards
+      compressed_row_matrix<Scalar, Storage> build() {
+        std::vector<size_t> ia;
+        std::vector<size_t> ja;
+        Storage a;
+        details::compress_triplets<Scalar>(dim1_, rows_, cols_, values_, ia, ja, a);
+        compact_threshold_ = max_buffered_;
+
+        return details::crmatrix_from_arrays<Scalar, Storage>(dim1_, dim2_,
+            std::move(ia), std::move(ja), std::move(a));
+      }
+    private:
+      size_t dim1_;
+      size_t dim2_;
+      size_t max_buffered_;
+      size_t compact_threshold_;
+
+      std::vector<size_t> rows_;
+      std::vector<size_t> cols_;
+      Storage values_;
+  };
+
+  typedef compressed_row_builder<double, std::vector<double>> compressed_row_builder_real;
+  typedef compressed_row_builder<std::complex<double>, std::vector<std::complex<double>>> compressed_row_builder_complex;
+} } // namespace fe::la
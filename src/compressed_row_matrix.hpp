@@ -3,6 +3,7 @@
 #include <vector>
 #include <algorithm>
 #include <iterator>
+#include <utility>
 
 #include <boost/iterator/iterator_facade.hpp>
 
@@ -10,6 +11,7 @@
 #include "products.hpp"
 #include "details/sparse_element_proxy.hpp"
 #include "details/sparse_matrix_vector_product.hpp"
+#include "details/sparse_matrix_product.hpp"
 
 namespace fe { namespace la {
   // Forward declarations
@@ -19,6 +21,10 @@ namespace fe { namespace la {
   namespace details {
     template<class Scalar, class Storage>
     compressed_row_matrix<Scalar, Storage> crmatrix_from_dense(dense_matrix<Scalar, Storage> const &);
+
+    template<class Scalar, class Storage>
+    compressed_row_matrix<Scalar, Storage> crmatrix_from_arrays(size_t dim1, size_t dim2,
+        std::vector<size_t> && ia, std::vector<size_t> && ja, Storage && a);
   } // namespace details
 
 
@@ -28,8 +34,8 @@ namespace fe { namespace la {
       template<class RanIndexIter, class RanIter> class non_null_row_iter;
 
       typedef details::sparse_element_proxy<Scalar> proxy_t;
-      typedef std::vector<size_t> index_storage_t;
     public:
+      typedef std::vector<size_t> index_storage_t;
       typedef Scalar scalar_t;
       typedef Storage storage_t;
       typedef proxy_t reference_t;
@@ -97,6 +103,9 @@ namespace fe { namespace la {
       compressed_row_matrix(compressed_row_matrix &&) = default;
       ~compressed_row_matrix() = default;
 
+      compressed_row_matrix & operator = (compressed_row_matrix const &) = default;
+      compressed_row_matrix & operator = (compressed_row_matrix &&) = default;
+
       size_t dim1() const {
         return dim1_;
       }
@@ -113,6 +122,21 @@ namespace fe { namespace la {
         return a_;
       }
 
+      // Elements of row i are data()[row_offsets()[i]] ... data()[row_offsets()[i + 1] - 1]
+      index_storage_t const & row_offsets() const {
+        return ia_;
+      }
+
+      // Column indices of elements in data(), sorted inside every row
+      index_storage_t const & column_indices() const {
+        return ja_;
+      }
+
+      // Row bounds of the parts of about equal nonzero counts that products split between threads
+      index_storage_t const & row_partition() const {
+        return partition_;
+      }
+
       reference_t operator () (size_t i, size_t j) {
         assert(i < dim1());
         assert(j < dim2());
@@ -187,12 +211,17 @@ namespace fe { namespace la {
 
       index_storage_t ia_;
       index_storage_t ja_;
+      // Depends only on the pattern, which does not change after construction
+      index_storage_t partition_;
 
       storage_t a_;
     private:
       friend compressed_row_matrix
           details::crmatrix_from_dense<scalar_t, storage_t>(
               dense_matrix<scalar_t, storage_t> const &);
+      friend compressed_row_matrix
+          details::crmatrix_from_arrays<scalar_t, storage_t>(size_t, size_t,
+              index_storage_t &&, index_storage_t &&, storage_t &&);
   };
 
   namespace details {
@@ -206,7 +235,7 @@ namespace fe { namespace la {
       for (size_t i = 0; i < source.dim1(); ++i) {
         res.ia_.emplace_back(res.a_.size());
         for (size_t j = 0; j < source.dim2(); ++j) {
-          if (source(i, j) != 0) {
+          if (source(i, j) != Scalar()) {
             res.ja_.emplace_back(j);
             res.a_.emplace_back(source(i, j));
           }
@@ -214,20 +243,96 @@ namespace fe { namespace la {
       }
 
       res.ia_.emplace_back(res.a_.size());
+      csr_row_partition(res.dim1(), res.ia_, res.partition_);
+
+      return res;
+    }
+
+    // Takes over already built arrays of the compressed row format:
+    //   row i has elements a[ia[i]] ... a[ia[i + 1] - 1] in columns ja[ia[i]] ... ja[ia[i + 1] - 1],
+    //   columns of each row must be sorted and unique
+    template<class Scalar, class Storage>
+    compressed_row_matrix<Scalar, Storage> crmatrix_from_arrays(size_t dim1, size_t dim2,
+        std::vector<size_t> && ia, std::vector<size_t> && ja, Storage && a) {
+      assert(ia.size() == dim1 + 1);
+      assert(ja.size() == ia[dim1] && a.size() == ia[dim1]);
+
+      compressed_row_matrix<Scalar, Storage> res{dim1, dim2};
+
+      res.ia_ = std::move(ia);
+      res.ja_ = std::move(ja);
+      res.a_ = std::move(a);
+      csr_row_partition(dim1, res.ia_, res.partition_);
 
       return res;
     }
 
     template<class Scalar, class Storage>
     struct mat_colvec_prod_impl_f<compressed_row_matrix, Scalar, Storage> {
-      dense_vector<Scalar, Storage> operator()(
-          compressed_row_matrix<Scalar, Storage> lhs
-          , dense_vector<Scalar, Storage> rhs) const {
-        return mv_sparse_prod(lhs, rhs);
+      void operator()(compressed_row_matrix<Scalar, Storage> const & lhs
+          ,dense_vector<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        assert(lhs.dim2() == rhs.dim());
+        assert(lhs.dim1() == res.dim());
+
+        csr_mv_prod(lhs.row_partition(), lhs.row_offsets(), lhs.column_indices(), lhs.data().data(),
+            rhs.data().data(), res.data().data(), alpha, beta);
+      }
+    };
+
+    // x^T A = (A^T x)^T, rows of A are scattered into the result.
+    //   A multithreaded product allocates buffers for its threads, mvprod_into with a workspace reuses them
+    template<class Scalar, class Storage>
+    struct mat_rowvec_prod_impl_f<compressed_row_matrix, Scalar, Storage> {
+      void operator()(dense_vector<Scalar, Storage> const & lhs
+          ,compressed_row_matrix<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        assert(lhs.dim() == rhs.dim1());
+        assert(res.dim() == rhs.dim2());
+
+        transposed_prod_workspace<Scalar> work;
+        csr_tmv_prod(rhs.row_partition(), rhs.dim2(), rhs.row_offsets(), rhs.column_indices(),
+            rhs.data().data(), lhs.data().data(), res.data().data(), alpha, beta, work);
       }
     };
   } //namespace details
 
+  // Computes res = alpha * lhs * rhs + beta * res with the thread buffers kept in work,
+  //   products reusing a workspace allocate memory only when the buffers grow.
+  // If beta is zero, res is overwritten and its old values are not read.
+  template<class Scalar, class Storage>
+  void mvprod_into(dense_vector<Scalar, Storage> const & lhs
+      ,compressed_row_matrix<Scalar, Storage> const & rhs
+      ,dense_vector<Scalar, Storage> & res
+      ,transposed_prod_workspace<Scalar> & work
+      ,typename dense_vector<Scalar, Storage>::scalar_t alpha = 1
+      ,typename dense_vector<Scalar, Storage>::scalar_t beta = 0) {
+    assert(&lhs != &res);
+    assert(lhs.dim() == rhs.dim1());
+    assert(res.dim() == rhs.dim2());
+
+    details::csr_tmv_prod(rhs.row_partition(), rhs.dim2(), rhs.row_offsets(), rhs.column_indices(),
+        rhs.data().data(), lhs.data().data(), res.data().data(), alpha, beta, work);
+  }
+
+  // A^T in compressed row form, which is also A in compressed column form:
+  //   row_offsets() of the result are the column offsets of A and column_indices() its row indices
+  template<class Scalar, class Storage>
+  compressed_row_matrix<Scalar, Storage> transpose(compressed_row_matrix<Scalar, Storage> const & a) {
+    std::vector<size_t> ia;
+    std::vector<size_t> ja;
+    Storage values;
+    details::csr_transpose(a.dim1(), a.dim2(), a.row_offsets(), a.column_indices(), a.data().data(),
+        ia, ja, values);
+
+    return details::crmatrix_from_arrays<Scalar, Storage>(a.dim2(), a.dim1(),
+        std::move(ia), std::move(ja), std::move(values));
+  }
+
   typedef compressed_row_matrix<double, std::vector<double>> compressed_row_matrix_real;
   typedef compressed_row_matrix<std::complex<double>, std::vector<std::complex<double>>> compressed_row_matrix_complex;
 } } // namespace fe::la
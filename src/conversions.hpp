@@ -2,11 +2,18 @@
 
 #include <algorithm>
 #include <utility>
+#include <tuple>
 
 #include "dense_matrix.hpp"
 #include "band_matrix.hpp"
 #include "rowprof_matrix.hpp"
+#include "skyline_matrix.hpp"
 #include "compressed_row_matrix.hpp"
+#include "symmetric_compressed_row_matrix.hpp"
+#include "sliced_ell_matrix.hpp"
+#include "row_profile.hpp"
+#include "permutation.hpp"
+#include "details/nonnull_elements.hpp"
 
 namespace fe { namespace la {
   namespace details {
@@ -23,10 +30,46 @@ namespace fe { namespace la {
       template<class Sc, class St> class InputMatrix,
       class Scalar,
       class Storage>
-  OutputMatrix<Scalar, Storage> convert_matrix(InputMatrix<Scalar, Storage> input) {
+  OutputMatrix<Scalar, Storage> convert_matrix(InputMatrix<Scalar, Storage> const & input) {
     return details::convert_matrix_f<OutputMatrix, InputMatrix, Scalar, Storage>()(input);
   }
 
+  // Conversions that can reuse the storage of input take it over, others copy
+  template<
+      template<class Sc, class St> class OutputMatrix,
+      template<class Sc, class St> class InputMatrix,
+      class Scalar,
+      class Storage>
+  OutputMatrix<Scalar, Storage> convert_matrix(InputMatrix<Scalar, Storage> && input) {
+    return details::convert_matrix_f<OutputMatrix, InputMatrix, Scalar, Storage>()(std::move(input));
+  }
+
+  namespace details {
+    template<
+        template<class Sc, class St> class OutputMatrix,
+        class Scalar,
+        class Storage>
+    struct convert_permuted_f;
+  } // namespace details
+
+  /**
+   * Converts the symmetrically reordered matrix P A P^T: element (i, j) of the result
+   * is element (perm.old_index(i), perm.old_index(j)) of input.
+   * Supported outputs are band_matrix, rowprof_matrix, skyline_matrix (for symmetric A)
+   * and compressed_row_matrix.
+   */
+  template<
+      template<class Sc, class St> class OutputMatrix,
+      template<class Sc, class St> class InputMatrix,
+      class Scalar,
+      class Storage>
+  OutputMatrix<Scalar, Storage> convert_matrix(InputMatrix<Scalar, Storage> const & input, permutation const & perm) {
+    assert(input.dim1() == input.dim2());
+    assert(input.dim1() == perm.size());
+
+    return details::convert_permuted_f<OutputMatrix, Scalar, Storage>()(input, perm);
+  }
+
   namespace details {
     template<
         template<class Sc, class St> class FromMatrix,
@@ -35,12 +78,45 @@ namespace fe { namespace la {
         class Storage>
     void assign_elementwise(ToMatrix<Scalar, Storage> & to, FromMatrix<Scalar, Storage> const & from);
 
+    template<
+        template<class Sc, class St> class FromMatrix,
+        template<class Sc, class St> class ToMatrix,
+        class Scalar,
+        class Storage>
+    void assign_nonnull(ToMatrix<Scalar, Storage> & to, FromMatrix<Scalar, Storage> const & from);
+
     template<class Scalar, class Storage>
     std::pair<size_t, size_t> calculate_band_count(dense_matrix<Scalar, Storage> const & matrix);
   } // namespace details
 
   namespace details {
 
+    // Converting a matrix to its own type copies or moves it
+    template<
+        template<class Sc, class St> class Matrix,
+        class Scalar,
+        class Storage>
+    struct convert_matrix_f<Matrix, Matrix, Scalar, Storage> {
+      Matrix<Scalar, Storage> operator () (Matrix<Scalar, Storage> const & input) {
+        return input;
+      }
+
+      Matrix<Scalar, Storage> operator () (Matrix<Scalar, Storage> && input) {
+        return std::move(input);
+      }
+    };
+
+    template<class Scalar, class Storage>
+    struct convert_matrix_f<dense_matrix, dense_matrix, Scalar, Storage> {
+      dense_matrix<Scalar, Storage> operator () (dense_matrix<Scalar, Storage> const & input) {
+        return input;
+      }
+
+      dense_matrix<Scalar, Storage> operator () (dense_matrix<Scalar, Storage> && input) {
+        return std::move(input);
+      }
+    };
+
     // Any matrix converted to dense_matrix by element-wise assignment
     template<
         template<class Sc, class St> class InputMatrix,
@@ -79,6 +155,217 @@ namespace fe { namespace la {
       }
     };
 
+    // Sparse matrices are converted by walking their non-null elements,
+    //   the target is allocated from the row profile of the source
+    template<class Scalar, class Storage>
+    struct convert_matrix_f<band_matrix, compressed_row_matrix, Scalar, Storage> {
+      band_matrix<Scalar, Storage> operator () (compressed_row_matrix<Scalar, Storage> const & input) {
+        band_matrix<Scalar, Storage> res{row_profile(input)};
+
+        details::assign_nonnull(res, input);
+
+        return res;
+      }
+    };
+
+    template<class Scalar, class Storage>
+    struct convert_matrix_f<rowprof_matrix, compressed_row_matrix, Scalar, Storage> {
+      rowprof_matrix<Scalar, Storage> operator () (compressed_row_matrix<Scalar, Storage> const & input) {
+        rowprof_matrix<Scalar, Storage> res{row_profile(input)};
+
+        details::assign_nonnull(res, input);
+
+        return res;
+      }
+    };
+
+    // Band and row-profile matrices are allocated from the profile of the reordered matrix
+    template<
+        template<class Sc, class St> class OutputMatrix,
+        class Scalar,
+        class Storage>
+    struct convert_permuted_f {
+      template<class InputMatrix>
+      OutputMatrix<Scalar, Storage> operator () (InputMatrix const & input, permutation const & perm) {
+        row_profile profile{input.dim1(), input.dim2()};
+        details::for_each_nonnull(input, [&](size_t i, size_t j, Scalar const &) {
+          profile.add(perm.new_index(i), perm.new_index(j));
+        });
+
+        OutputMatrix<Scalar, Storage> res{profile};
+        details::for_each_nonnull(input, [&](size_t i, size_t j, Scalar const & value) {
+          res(perm.new_index(i), perm.new_index(j)) = value;
+        });
+
+        return res;
+      }
+    };
+
+    template<class Scalar, class Storage>
+    struct convert_permuted_f<compressed_row_matrix, Scalar, Storage> {
+      template<class InputMatrix>
+      compressed_row_matrix<Scalar, Storage> operator () (InputMatrix const & input, permutation const & perm) {
+        size_t n = input.dim1();
+
+        // Count elements of every new row, then scatter them and sort each row
+        std::vector<size_t> ia(n + 1, 0);
+        details::for_each_nonnull(input, [&](size_t i, size_t, Scalar const &) {
+          ++ia[perm.new_index(i) + 1];
+        });
+        for (size_t i = 0; i < n; ++i) {
+          ia[i + 1] += ia[i];
+        }
+
+        std::vector<size_t> ja(ia[n]);
+        Storage a(ia[n]);
+        {
+          std::vector<size_t> next(ia.begin(), ia.end() - 1);
+          details::for_each_nonnull(input, [&](size_t i, size_t j, Scalar const & value) {
+            size_t pos = next[perm.new_index(i)]++;
+            ja[pos] = perm.new_index(j);
+            a[pos] = value;
+          });
+        }
+
+        std::vector<std::pair<size_t, Scalar>> row;
+        for (size_t i = 0; i < n; ++i) {
+          row.clear();
+          for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+            row.emplace_back(ja[p], a[p]);
+          }
+          std::sort(row.begin(), row.end(),
+              [](std::pair<size_t, Scalar> const & l, std::pair<size_t, Scalar> const & r) {
+                return l.first < r.first;
+              });
+          for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+            ja[p] = row[p - ia[i]].first;
+            a[p] = row[p - ia[i]].second;
+          }
+        }
+
+        return details::crmatrix_from_arrays<Scalar, Storage>(n, n, std::move(ia), std::move(ja), std::move(a));
+      }
+    };
+
+    // The lower triangle of a symmetric matrix goes to the skyline form,
+    //   the envelope also covers the transposed upper triangle pattern
+    template<
+        template<class Sc, class St> class InputMatrix,
+        class Scalar,
+        class Storage>
+    struct convert_matrix_f<skyline_matrix, InputMatrix, Scalar, Storage> {
+      skyline_matrix<Scalar, Storage> operator () (InputMatrix<Scalar, Storage> const & input) {
+        assert(input.dim1() == input.dim2());
+
+        // Element (i, j) widens row max(i, j) only, a row profile would widen all rows in between
+        size_t n = input.dim1();
+        std::vector<size_t> first_cols(n);
+        for (size_t i = 0; i < n; ++i) {
+          first_cols[i] = i;
+        }
+        details::for_each_nonnull(input, [&](size_t i, size_t j, Scalar const &) {
+          size_t row = std::max(i, j);
+          first_cols[row] = std::min(first_cols[row], std::min(i, j));
+        });
+
+        skyline_matrix<Scalar, Storage> res{n, first_cols};
+        details::for_each_nonnull(input, [&](size_t i, size_t j, Scalar const & value) {
+          if (j <= i) {
+            res(i, j) = value;
+          }
+        });
+
+        return res;
+      }
+    };
+
+    template<class Scalar, class Storage>
+    struct convert_matrix_f<skyline_matrix, skyline_matrix, Scalar, Storage> {
+      skyline_matrix<Scalar, Storage> operator () (skyline_matrix<Scalar, Storage> const & input) {
+        return input;
+      }
+
+      skyline_matrix<Scalar, Storage> operator () (skyline_matrix<Scalar, Storage> && input) {
+        return std::move(input);
+      }
+    };
+
+    // The lower triangle of a symmetric matrix goes to the half-storage compressed row form
+    template<
+        template<class Sc, class St> class InputMatrix,
+        class Scalar,
+        class Storage>
+    struct convert_matrix_f<symmetric_compressed_row_matrix, InputMatrix, Scalar, Storage> {
+      symmetric_compressed_row_matrix<Scalar, Storage> operator () (InputMatrix<Scalar, Storage> const & input) {
+        assert(input.dim1() == input.dim2());
+
+        size_t n = input.dim1();
+        std::vector<std::vector<std::pair<size_t, Scalar>>> rows(n);
+        details::for_each_nonnull(input, [&](size_t i, size_t j, Scalar const & value) {
+          if (j <= i) {
+            rows[i].emplace_back(j, value);
+          }
+        });
+
+        std::vector<size_t> ia(n + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+          ia[i + 1] = ia[i] + rows[i].size();
+        }
+
+        std::vector<size_t> ja(ia[n]);
+        Storage a(ia[n]);
+        for (size_t i = 0; i < n; ++i) {
+          std::sort(rows[i].begin(), rows[i].end(),
+              [](std::pair<size_t, Scalar> const & l, std::pair<size_t, Scalar> const & r) {
+                return l.first < r.first;
+              });
+          for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+            ja[p] = rows[i][p - ia[i]].first;
+            a[p] = rows[i][p - ia[i]].second;
+          }
+        }
+
+        return details::symcrmatrix_from_arrays<Scalar, Storage>(n, std::move(ia), std::move(ja), std::move(a));
+      }
+    };
+
+    template<class Scalar, class Storage>
+    struct convert_matrix_f<symmetric_compressed_row_matrix, symmetric_compressed_row_matrix, Scalar, Storage> {
+      symmetric_compressed_row_matrix<Scalar, Storage> operator () (
+          symmetric_compressed_row_matrix<Scalar, Storage> const & input) {
+        return input;
+      }
+
+      symmetric_compressed_row_matrix<Scalar, Storage> operator () (
+          symmetric_compressed_row_matrix<Scalar, Storage> && input) {
+        return std::move(input);
+      }
+    };
+
+    // Both triangles of a symmetric matrix in full compressed row form
+    template<class Scalar, class Storage>
+    struct convert_matrix_f<compressed_row_matrix, symmetric_compressed_row_matrix, Scalar, Storage> {
+      compressed_row_matrix<Scalar, Storage> operator () (
+          symmetric_compressed_row_matrix<Scalar, Storage> const & input) {
+        return convert_permuted_f<compressed_row_matrix, Scalar, Storage>()(input, permutation(input.dim1()));
+      }
+    };
+
+    template<class Scalar, class Storage>
+    struct convert_matrix_f<sliced_ell_matrix, compressed_row_matrix, Scalar, Storage> {
+      sliced_ell_matrix<Scalar, Storage> operator () (compressed_row_matrix<Scalar, Storage> const & input) {
+        return make_sliced_ell_matrix(input);
+      }
+    };
+
+    // For square matrices
+    template<class Scalar, class Storage>
+    struct convert_matrix_f<compressed_row_matrix, sliced_ell_matrix, Scalar, Storage> {
+      compressed_row_matrix<Scalar, Storage> operator () (sliced_ell_matrix<Scalar, Storage> const & input) {
+        return convert_permuted_f<compressed_row_matrix, Scalar, Storage>()(input, permutation(input.dim1()));
+      }
+    };
+
     template<class Scalar, class Storage>
     struct convert_matrix_f<compressed_row_matrix, dense_matrix, Scalar, Storage> {
       compressed_row_matrix<Scalar, Storage> operator () (dense_matrix<Scalar, Storage> const & input) {
@@ -103,6 +390,24 @@ namespace fe { namespace la {
       }
     }
 
+    // Copies non-null elements of from, all other elements of to must be zero
+    template<
+        template<class Sc, class St> class FromMatrix,
+        template<class Sc, class St> class ToMatrix,
+        class Scalar,
+        class Storage>
+    void assign_nonnull(ToMatrix<Scalar, Storage> & to, FromMatrix<Scalar, Storage> const & from) {
+      assert(from.dim1() == to.dim1());
+      assert(from.dim2() == to.dim2());
+
+      for (size_t i = 0; i < from.dim1(); ++i) {
+        auto iter_end = from.nnrow_cend(i);
+        for (auto iter = from.nnrow_cbegin(i); iter != iter_end; ++iter) {
+          to(i, iter.index()) = *iter;
+        }
+      }
+    }
+
     // First element of returned pair is left_band_index, second element is right_band_index
     template<class Scalar, class Storage>
     std::pair<size_t, size_t> calculate_band_count(dense_matrix<Scalar, Storage> const & matrix) {
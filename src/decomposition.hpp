@@ -1,8 +1,16 @@
 #pragma once
 
 #include <cassert>
+#include <vector>
+#include <utility>
 
+#include "compressed_row_matrix.hpp"
+#include "band_matrix.hpp"
+#include "skyline_matrix.hpp"
 #include "details/sparse_element_proxy.hpp"
+#include "details/sparse_lu_kernels.hpp"
+#include "details/band_lu_kernels.hpp"
+#include "details/skyline_kernels.hpp"
 
 namespace fe { namespace la {
 
@@ -113,4 +121,99 @@ namespace fe { namespace la {
       }
     }
   }
+
+  namespace details {
+    // Replaces mat with its L + U (or L + D + U) factors, including fill-in
+    template<class Scalar, class Storage>
+    void crmatrix_lu_inplace(compressed_row_matrix<Scalar, Storage> & mat, bool ldu) {
+      assert(mat.dim1() == mat.dim2());
+
+      size_t n = mat.dim1();
+      auto const & ia = mat.row_offsets();
+      auto const & ja = mat.column_indices();
+
+      std::vector<size_t> lu_ia;
+      std::vector<size_t> lu_ja;
+      std::vector<size_t> lu_diag;
+      lu_symbolic(n, ia, ja, lu_ia, lu_ja, lu_diag);
+
+      std::vector<size_t> map;
+      lu_scatter_map(n, ia, ja, lu_ia, lu_ja, map);
+
+      Storage lu_a(lu_ja.size(), Scalar());
+      for (size_t p = 0; p < map.size(); ++p) {
+        lu_a[map[p]] = mat.data()[p];
+      }
+
+      std::vector<Scalar> work(n, Scalar());
+      lu_numeric(n, lu_ia, lu_ja, lu_diag, lu_a.data(), work.data());
+      if (ldu) {
+        lu_to_ldu(n, lu_ia, lu_diag, lu_a.data());
+      }
+
+      mat = crmatrix_from_arrays<Scalar, Storage>(n, n,
+          std::move(lu_ia), std::move(lu_ja), std::move(lu_a));
+    }
+  } // namespace details
+
+  // Compressed row matrices get the exact fill pattern of L + U computed first,
+  //   so fill-in is stored and the numeric phase works in O(flops)
+  template<class Scalar, class Storage>
+  void sparse_lu_decomposition(compressed_row_matrix<Scalar, Storage> & mat) {
+    details::crmatrix_lu_inplace(mat, false);
+  }
+
+  template<class Scalar, class Storage>
+  void lu_decomposition(compressed_row_matrix<Scalar, Storage> & mat) {
+    details::crmatrix_lu_inplace(mat, false);
+  }
+
+  template<class Scalar, class Storage>
+  void sparse_ldu_decomposition(compressed_row_matrix<Scalar, Storage> & mat) {
+    details::crmatrix_lu_inplace(mat, true);
+  }
+
+  template<class Scalar, class Storage>
+  void ldu_decomposition(compressed_row_matrix<Scalar, Storage> & mat) {
+    details::crmatrix_lu_inplace(mat, true);
+  }
+
+  // Band matrices are factored in their own storage: LU without pivoting
+  //   keeps the band, so it costs O(n * bands_left * bands_right)
+  template<class Scalar, class Storage>
+  void sparse_lu_decomposition(band_matrix<Scalar, Storage> & mat) {
+    assert(mat.dim1() == mat.dim2());
+
+    details::band_lu(mat.dim1(), mat.bands_left(), mat.bands_right(), mat.data().data());
+  }
+
+  template<class Scalar, class Storage>
+  void lu_decomposition(band_matrix<Scalar, Storage> & mat) {
+    sparse_lu_decomposition(mat);
+  }
+
+  template<class Scalar, class Storage>
+  void sparse_ldu_decomposition(band_matrix<Scalar, Storage> & mat) {
+    assert(mat.dim1() == mat.dim2());
+
+    details::band_lu(mat.dim1(), mat.bands_left(), mat.bands_right(), mat.data().data());
+    details::band_lu_to_ldu(mat.dim1(), mat.bands_left(), mat.bands_right(), mat.data().data());
+  }
+
+  template<class Scalar, class Storage>
+  void ldu_decomposition(band_matrix<Scalar, Storage> & mat) {
+    sparse_ldu_decomposition(mat);
+  }
+
+  // Symmetric A = L D L^T inside the envelope: L with unit diagonal below the diagonal, D on it
+  template<class Scalar, class Storage>
+  void ldlt_decomposition(skyline_matrix<Scalar, Storage> & mat) {
+    details::skyline_ldlt(mat.dim1(), mat.row_offsets(), mat.data().data());
+  }
+
+  // Symmetric positive definite A = L L^T inside the envelope
+  template<class Scalar, class Storage>
+  void cholesky_decomposition(skyline_matrix<Scalar, Storage> & mat) {
+    details::skyline_cholesky(mat.dim1(), mat.row_offsets(), mat.data().data());
+  }
 } } // namespace fe::la
@@ -7,10 +7,14 @@
 #include <complex>
 #include <iterator>
 
+#include "details/gemm.hpp"
+#include "details/blas1_kernels.hpp"
+#include "details/matrix_expression.hpp"
+
 namespace fe { namespace la {
 
 template<class Scalar, class Storage>
-class dense_matrix {
+class dense_matrix : public details::matrix_expression<dense_matrix<Scalar, Storage>> {
   public:
     typedef Storage storage_t;
     typedef Scalar scalar_t;
@@ -23,8 +27,32 @@ class dense_matrix {
     }
     dense_matrix(dense_matrix && other) = default;
     dense_matrix(dense_matrix const & other) = default;
+
+    // Evaluates an element-wise expression, e.g. a * x + b * y
+    template<class Expr>
+    dense_matrix(details::matrix_expression<Expr> const & expr)
+        : dim1_(expr.self().dim1()), dim2_(expr.self().dim2()), data_(dim1_ * dim2_) {
+      details::assign_expression(data_.data(), data_.size(), expr.self());
+    }
+
     virtual ~dense_matrix() {};
 
+    dense_matrix & operator = (dense_matrix && other) = default;
+    dense_matrix & operator = (dense_matrix const & other) = default;
+
+    // The expression is evaluated in place if dimensions match,
+    //   so this matrix may appear in it
+    template<class Expr>
+    dense_matrix & operator = (details::matrix_expression<Expr> const & expr) {
+      if (dim1() == expr.self().dim1() && dim2() == expr.self().dim2()) {
+        details::assign_expression(data_.data(), data_.size(), expr.self());
+      } else {
+        dense_matrix res(expr);
+        *this = std::move(res);
+      }
+      return *this;
+    }
+
     storage_t & data() {
       return data_;
     }
@@ -53,10 +81,7 @@ class dense_matrix {
       assert(dim1() == rhs.dim1() && dim2() == rhs.dim2());
 
       // Add matrices element-wise
-      auto const & rdata = rhs.data();
-
-      std::transform(std::begin(data()), std::end(data()), std::begin(rdata), std::begin(data()),
-            [](scalar_t left, scalar_t right) {return left + right;});
+      details::axpy_kernel(data().size(), scalar_t(1), rhs.data().data(), data().data());
 
       return *this;
     }
@@ -64,17 +89,32 @@ class dense_matrix {
     dense_matrix & operator -= (dense_matrix const & rhs) {
       assert(dim1() == rhs.dim1() && dim2() == rhs.dim2());
 
-      // Add matrices element-wise
-      auto const & rdata = rhs.data();
+      // Subtract matrices element-wise
+      details::axpy_kernel(data().size(), scalar_t(-1), rhs.data().data(), data().data());
+
+      return *this;
+    }
 
-      std::transform(std::begin(data()), std::end(data()), std::begin(rdata), std::begin(data()),
-            [](scalar_t left, scalar_t right) {return left - right;});
+    template<class Expr>
+    dense_matrix & operator += (details::matrix_expression<Expr> const & rhs) {
+      assert(dim1() == rhs.self().dim1() && dim2() == rhs.self().dim2());
+
+      details::add_expression(data_.data(), data_.size(), rhs.self());
+
+      return *this;
+    }
+
+    template<class Expr>
+    dense_matrix & operator -= (details::matrix_expression<Expr> const & rhs) {
+      assert(dim1() == rhs.self().dim1() && dim2() == rhs.self().dim2());
+
+      details::subtract_expression(data_.data(), data_.size(), rhs.self());
 
       return *this;
     }
 
     dense_matrix & operator *= (Scalar rhs) {
-      std::for_each(std::begin(data()), std::end(data()), [rhs](Scalar & num) { num *= rhs; });
+      details::scal_kernel(data().size(), rhs, data().data());
       return *this;
     }
   private:
@@ -114,6 +154,20 @@ void mprod_inplace(Mat1<Scalar, Storage> const & lhs,
     }
   }
 }
+
+// Dense matrices are multiplied by the blocked gemm kernel
+template<class Scalar, class Storage>
+void mprod_inplace(dense_matrix<Scalar, Storage> const & lhs,
+    dense_matrix<Scalar, Storage> const & rhs, dense_matrix<Scalar, Storage> & res) {
+  assert(lhs.dim2() == rhs.dim1());
+  assert(res.dim1() == lhs.dim1());
+  assert(res.dim2() == rhs.dim2());
+
+  gemm_parallel(lhs.dim1(), rhs.dim2(), lhs.dim2(),
+      lhs.data().data(), lhs.dim2(),
+      rhs.data().data(), rhs.dim2(),
+      res.data().data(), res.dim2());
+}
 } // namespace details
 
 template<class Scalar, class Storage>
@@ -3,6 +3,7 @@
 #include "dense_matrix.hpp"
 
 #include <vector>
+#include <type_traits>
 
 namespace fe { namespace la {
 
@@ -27,6 +28,24 @@ class dense_vector : public dense_matrix<Scalar, Storage> {
     dense_vector(dense_vector const &) = default;
     dense_vector(dense_vector &&) = default;
 
+    // Evaluates an element-wise expression of vectors, e.g. a * x + b * y.
+    //   A dense_matrix itself is not an expression here, so it never becomes a vector implicitly
+    template<class Expr, class = typename std::enable_if<details::is_expression_node<Expr>::value>::type>
+    dense_vector(details::matrix_expression<Expr> const & expr)
+        : base(expr) {
+      assert(this->dim1() == 1 || this->dim2() == 1);
+    }
+
+    dense_vector & operator = (dense_vector const &) = default;
+    dense_vector & operator = (dense_vector &&) = default;
+
+    template<class Expr, class = typename std::enable_if<details::is_expression_node<Expr>::value>::type>
+    dense_vector & operator = (details::matrix_expression<Expr> const & expr) {
+      assert(expr.self().dim1() == 1 || expr.self().dim2() == 1);
+      base::operator = (expr);
+      return *this;
+    }
+
 
     explicit dense_vector(size_t dim, vector_type type = vector_type::COLUMN_VECTOR)
         : dense_matrix<Scalar, Storage>(
@@ -62,11 +81,11 @@ struct mvprod_f {
     assert(lhs.dim2() == rhs.dim1());
 
     typedef dense_vector<Scalar, Storage> vec;
-    typedef dense_matrix<Scalar, Storage> mat;
 
     vec res{lhs.dim1()};
 
-    details::mprod_inplace(lhs, rhs, res);
+    details::gemv_parallel(lhs.dim1(), lhs.dim2(), Scalar(1), lhs.data().data(), lhs.dim2(),
+        rhs.data().data(), Scalar(), res.data().data());
 
     return res;
   }
@@ -78,11 +97,11 @@ dense_vector<Scalar, Storage> mvprod(dense_vector<Scalar, Storage> const & lhs,
   assert(lhs.dim2() == rhs.dim1());
 
   typedef dense_vector<Scalar, Storage> vec;
-  typedef dense_matrix<Scalar, Storage> mat;
 
   vec res{rhs.dim2(), vector_type::ROW_VECTOR};
 
-  details::mprod_inplace(lhs, rhs, res);
+  details::gevm_parallel(rhs.dim1(), rhs.dim2(), Scalar(1), lhs.data().data(),
+      rhs.data().data(), rhs.dim2(), Scalar(), res.data().data());
 
   return res;
 }
@@ -0,0 +1,257 @@
+#ifndef AMG_KERNELS_HPP_
+#define AMG_KERNELS_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "sparse_matrix_product.hpp"
+
+// Setup and smoothing steps of smoothed aggregation multigrid (amg.hpp) on compressed
+//   row arrays with sorted columns.
+// Unknowns are grouped in nodes of block_size consecutive unknowns (the components of
+//   one mesh node for systems like elasticity, block_size = 1 for scalar problems).
+
+namespace fe { namespace la { namespace details {
+  size_t const NOT_AGGREGATED = size_t(-1);
+
+  // Node matrix with the Frobenius norms of the block_size x block_size blocks of A
+  template<class Scalar>
+  void block_norms(size_t n, size_t block_size,
+      std::vector<size_t> const & ia, std::vector<size_t> const & ja, Scalar const * a,
+      std::vector<size_t> & b_ia, std::vector<size_t> & b_ja, std::vector<double> & b_a) {
+    assert(n % block_size == 0);
+
+    size_t nodes = n / block_size;
+    size_t const unset = size_t(-1);
+
+    b_ia.assign(1, 0);
+    b_ja.clear();
+    b_a.clear();
+
+    std::vector<size_t> pos(nodes, unset);
+    for (size_t node = 0; node < nodes; ++node) {
+      size_t row_begin = b_ja.size();
+      for (size_t i = node * block_size; i < (node + 1) * block_size; ++i) {
+        for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+          size_t j = ja[p] / block_size;
+          if (pos[j] == unset || pos[j] < row_begin) {
+            pos[j] = b_ja.size();
+            b_ja.push_back(j);
+            b_a.push_back(0);
+          }
+          b_a[pos[j]] += std::norm(a[p]);
+        }
+      }
+      for (size_t q = row_begin; q < b_ja.size(); ++q) {
+        b_a[q] = std::sqrt(b_a[q]);
+      }
+      b_ia.push_back(b_ja.size());
+    }
+  }
+
+  /**
+   * Strong connections of the node graph: node j is strongly connected to node i if
+   *   |a_ij| >= threshold * sqrt(|a_ii| |a_jj|)
+   * for the block norms of the node matrix (ia, ja, norms).
+   */
+  inline void strong_connections(size_t nodes, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      std::vector<double> const & norms, double threshold,
+      std::vector<size_t> & s_ia, std::vector<size_t> & s_ja) {
+    std::vector<double> diag(nodes, 0.);
+    for (size_t i = 0; i < nodes; ++i) {
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        if (ja[p] == i) {
+          diag[i] = norms[p];
+        }
+      }
+    }
+
+    s_ia.assign(1, 0);
+    s_ja.clear();
+    for (size_t i = 0; i < nodes; ++i) {
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        size_t j = ja[p];
+        if (j != i && norms[p] != 0. && norms[p] >= threshold * std::sqrt(diag[i] * diag[j])) {
+          s_ja.push_back(j);
+        }
+      }
+      s_ia.push_back(s_ja.size());
+    }
+  }
+
+  /**
+   * Greedy aggregation of the strength graph in three passes:
+   *   1. a node whose strong neighbours are all free forms an aggregate with them,
+   *   2. the remaining nodes join an aggregate of pass 1 next to them,
+   *   3. what is still left forms aggregates with its free neighbours.
+   * Nodes without strong connections stay NOT_AGGREGATED, the smoother alone handles them.
+   * Returns the number of aggregates, agg[i] is the aggregate of node i.
+   */
+  inline size_t aggregate(size_t nodes, std::vector<size_t> const & s_ia, std::vector<size_t> const & s_ja,
+      std::vector<size_t> & agg) {
+    agg.assign(nodes, NOT_AGGREGATED);
+    size_t count = 0;
+
+    for (size_t i = 0; i < nodes; ++i) {
+      if (agg[i] != NOT_AGGREGATED || s_ia[i] == s_ia[i + 1]) {
+        continue;
+      }
+      bool free = true;
+      for (size_t p = s_ia[i]; p < s_ia[i + 1] && free; ++p) {
+        free = agg[s_ja[p]] == NOT_AGGREGATED;
+      }
+      if (free) {
+        agg[i] = count;
+        for (size_t p = s_ia[i]; p < s_ia[i + 1]; ++p) {
+          agg[s_ja[p]] = count;
+        }
+        ++count;
+      }
+    }
+
+    std::vector<size_t> first_pass(agg);
+    for (size_t i = 0; i < nodes; ++i) {
+      if (agg[i] != NOT_AGGREGATED) {
+        continue;
+      }
+      for (size_t p = s_ia[i]; p < s_ia[i + 1]; ++p) {
+        if (first_pass[s_ja[p]] != NOT_AGGREGATED) {
+          agg[i] = first_pass[s_ja[p]];
+          break;
+        }
+      }
+    }
+
+    for (size_t i = 0; i < nodes; ++i) {
+      if (agg[i] != NOT_AGGREGATED || s_ia[i] == s_ia[i + 1]) {
+        continue;
+      }
+      agg[i] = count;
+      for (size_t p = s_ia[i]; p < s_ia[i + 1]; ++p) {
+        if (agg[s_ja[p]] == NOT_AGGREGATED) {
+          agg[s_ja[p]] = count;
+        }
+      }
+      ++count;
+    }
+
+    return count;
+  }
+
+  // Positions of the diagonal elements and their inverses, every row must have a nonzero diagonal
+  template<class Scalar>
+  void inverse_diagonal(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      Scalar const * a, std::vector<size_t> & diag, std::vector<Scalar> & inv_diag) {
+    diag.resize(n);
+    inv_diag.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      auto pos = std::lower_bound(ja.begin() + ia[i], ja.begin() + ia[i + 1], i);
+      assert(pos != ja.begin() + ia[i + 1] && *pos == i);
+      diag[i] = pos - ja.begin();
+      assert(a[diag[i]] != Scalar());
+      inv_diag[i] = Scalar(1) / a[diag[i]];
+    }
+  }
+
+  // Upper bound of the spectral radius of D^-1 A by the largest row sum of |D^-1 A|
+  template<class Scalar>
+  double jacobi_spectral_bound(size_t n, std::vector<size_t> const & ia, Scalar const * a,
+      std::vector<Scalar> const & inv_diag) {
+    double res = 0;
+    for (size_t i = 0; i < n; ++i) {
+      double sum = 0;
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        sum += std::abs(a[p]);
+      }
+      res = std::max(res, sum * std::abs(inv_diag[i]));
+    }
+    return res;
+  }
+
+  /**
+   * Smoothed prolongator P = (I - omega D^-1 A) P0. The tentative prolongator P0
+   * interpolates the constant vectors of every component exactly: the unknown c of
+   * a node in aggregate k maps to the coarse unknown k * block_size + c with the weight
+   * 1 / sqrt(size of the aggregate), which makes the columns of P0 orthonormal.
+   */
+  template<class Scalar, class Storage>
+  void smoothed_prolongator(size_t n, size_t block_size,
+      std::vector<size_t> const & ia, std::vector<size_t> const & ja, Scalar const * a,
+      std::vector<Scalar> const & inv_diag, double omega,
+      std::vector<size_t> const & agg, size_t count,
+      std::vector<size_t> & p_ia, std::vector<size_t> & p_ja, Storage & p_a) {
+    std::vector<size_t> agg_size(count, 0);
+    for (size_t k : agg) {
+      if (k != NOT_AGGREGATED) {
+        ++agg_size[k];
+      }
+    }
+
+    std::vector<size_t> t_ia(1, 0);
+    std::vector<size_t> t_ja;
+    Storage t_a;
+    for (size_t i = 0; i < n; ++i) {
+      size_t k = agg[i / block_size];
+      if (k != NOT_AGGREGATED) {
+        t_ja.push_back(k * block_size + i % block_size);
+        t_a.push_back(Scalar(1 / std::sqrt(double(agg_size[k]))));
+      }
+      t_ia.push_back(t_ja.size());
+    }
+
+    csr_multiply(n, count * block_size, ia, ja, a, t_ia, t_ja, t_a.data(), p_ia, p_ja, p_a);
+
+    for (size_t i = 0; i < n; ++i) {
+      Scalar factor = -omega * inv_diag[i];
+      for (size_t q = p_ia[i]; q < p_ia[i + 1]; ++q) {
+        p_a[q] *= factor;
+      }
+      // The diagonal of A puts column t_ja of P0 into the row of A P0
+      if (t_ia[i] != t_ia[i + 1]) {
+        size_t j = t_ja[t_ia[i]];
+        auto pos = std::lower_bound(p_ja.begin() + p_ia[i], p_ja.begin() + p_ia[i + 1], j);
+        assert(pos != p_ja.begin() + p_ia[i + 1] && *pos == j);
+        p_a[pos - p_ja.begin()] += t_a[t_ia[i]];
+      }
+    }
+  }
+
+  // Damped Jacobi sweep x += omega D^-1 (b - A x), r is a buffer of n elements
+  template<class Scalar>
+  void jacobi_sweep(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      Scalar const * a, std::vector<Scalar> const & inv_diag, double omega,
+      Scalar const * b, Scalar * x, Scalar * r) {
+    for (size_t i = 0; i < n; ++i) {
+      Scalar sum = b[i];
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        sum -= a[p] * x[ja[p]];
+      }
+      r[i] = sum;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      x[i] += omega * inv_diag[i] * r[i];
+    }
+  }
+
+  // Gauss-Seidel sweep over rows in increasing (forward) or decreasing order
+  template<class Scalar>
+  void gauss_seidel_sweep(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      Scalar const * a, std::vector<size_t> const & diag, std::vector<Scalar> const & inv_diag,
+      Scalar const * b, Scalar * x, bool forward) {
+    for (size_t k = 0; k < n; ++k) {
+      size_t i = forward ? k : n - 1 - k;
+      Scalar sum = b[i];
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        if (p != diag[i]) {
+          sum -= a[p] * x[ja[p]];
+        }
+      }
+      x[i] = sum * inv_diag[i];
+    }
+  }
+} } } // namespace fe::la::details
+
+#endif // AMG_KERNELS_HPP_
@@ -0,0 +1,234 @@
+#ifndef BAND_LU_KERNELS_HPP_
+#define BAND_LU_KERNELS_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "gemm.hpp"
+
+// LU decomposition and triangular solves of n x n band matrices stored by rows:
+//   element (i, j) with i - ml <= j <= i + mu is a[i * w + (j - i + ml)], w = ml + mu + 1.
+// This is the storage of band_matrix. Rows of a rectangular block lying inside
+//   the band are w - 1 elements apart, so such blocks are dense matrices
+//   with leading dimension w - 1 and are updated with gemm.
+
+namespace fe { namespace la { namespace details {
+  // Bands at least this wide are factored by blocks of BAND_LU_BLOCK columns
+  size_t const BAND_LU_BLOCKED_MIN_BANDS = 48;
+  size_t const BAND_LU_BLOCK = 32;
+
+  template<class Scalar>
+  Scalar & band_at(Scalar * a, size_t w, size_t ml, size_t i, size_t j) {
+    return a[i * w + j + ml - i];
+  }
+
+  // Unblocked LU without pivoting, L has unit diagonal and is stored below it.
+  // The factors stay inside the band.
+  template<class Scalar>
+  void band_lu_unblocked(size_t n, size_t ml, size_t mu, Scalar * a) {
+    size_t w = ml + mu + 1;
+
+    for (size_t k = 0; k < n; ++k) {
+      Scalar const * row_k = &band_at(a, w, ml, k, k);
+      size_t i_end = std::min(n, k + ml + 1);
+      size_t j_end = std::min(n, k + mu + 1);
+
+      for (size_t i = k + 1; i < i_end; ++i) {
+        Scalar * row_i = &band_at(a, w, ml, i, k);
+        Scalar l_ik = row_i[0] / row_k[0];
+        row_i[0] = l_ik;
+        for (size_t j = 1; j < j_end - k; ++j) {
+          row_i[j] -= l_ik * row_k[j];
+        }
+      }
+    }
+  }
+
+  /**
+   * Blocked LU without pivoting. For every block of nb columns:
+   *   the panel (all rows of the block columns) is factored,
+   *   U12 (block rows to the right of the panel) is solved with L11,
+   *   A22 -= L21 * U12 is done by gemm; A22 lies completely inside the band.
+   * Gives the same factors as band_lu_unblocked up to rounding.
+   */
+  template<class Scalar>
+  void band_lu_blocked(size_t n, size_t ml, size_t mu, Scalar * a, size_t nb) {
+    size_t w = ml + mu + 1;
+    std::vector<Scalar> l21(ml * nb);
+    std::vector<Scalar> u12(nb * mu);
+
+    for (size_t k0 = 0; k0 < n; k0 += nb) {
+      size_t k_end = std::min(n, k0 + nb);
+      size_t kb = k_end - k0;
+
+      // Panel and U12, column by column, every column of the block is eliminated
+      //   in columns up to the end of the band of its row
+      for (size_t k = k0; k < k_end; ++k) {
+        Scalar const * row_k = &band_at(a, w, ml, k, k);
+        size_t i_end = std::min(n, k + ml + 1);
+        size_t j_end = std::min(n, k + mu + 1);
+
+        for (size_t i = k + 1; i < i_end; ++i) {
+          Scalar * row_i = &band_at(a, w, ml, i, k);
+          Scalar l_ik = row_i[0] / row_k[0];
+          row_i[0] = l_ik;
+          // Rows below the block only get updates inside the block columns here
+          size_t row_j_end = (i < k_end) ? j_end : std::min(j_end, k_end);
+          for (size_t j = 1; j < row_j_end - k; ++j) {
+            row_i[j] -= l_ik * row_k[j];
+          }
+        }
+      }
+
+      // A22 is rows k_end ... k_end + m22 - 1, columns k_end ... k_end + n22 - 1
+      size_t m22 = std::min(n - k_end, ml);
+      size_t n22 = std::min(n - k_end, mu);
+      if (m22 == 0 || n22 == 0) {
+        continue;
+      }
+
+      // -L21 and U12 are trapezoids of the band, copy them with zeros outside of it
+      for (size_t i = 0; i < m22; ++i) {
+        for (size_t k = 0; k < kb; ++k) {
+          size_t row = k_end + i;
+          size_t col = k0 + k;
+          l21[i * kb + k] = (row <= col + ml) ? -band_at(a, w, ml, row, col) : Scalar();
+        }
+      }
+      for (size_t k = 0; k < kb; ++k) {
+        for (size_t j = 0; j < n22; ++j) {
+          size_t row = k0 + k;
+          size_t col = k_end + j;
+          u12[k * n22 + j] = (col <= row + mu) ? band_at(a, w, ml, row, col) : Scalar();
+        }
+      }
+
+      gemm(m22, n22, kb, l21.data(), kb, u12.data(), n22,
+          &band_at(a, w, ml, k_end, k_end), w - 1);
+    }
+  }
+
+  template<class Scalar>
+  void band_lu(size_t n, size_t ml, size_t mu, Scalar * a) {
+    if (ml >= BAND_LU_BLOCKED_MIN_BANDS && mu >= BAND_LU_BLOCKED_MIN_BANDS) {
+      band_lu_blocked(n, ml, mu, a, BAND_LU_BLOCK);
+    } else {
+      band_lu_unblocked(n, ml, mu, a);
+    }
+  }
+
+  // Solves L U x = b in place for factors of band_lu
+  template<class Scalar>
+  void band_lu_solve(size_t n, size_t ml, size_t mu, Scalar const * a, Scalar * x) {
+    size_t w = ml + mu + 1;
+
+    for (size_t i = 0; i < n; ++i) {
+      size_t j_begin = (i < ml) ? 0 : i - ml;
+      Scalar const * row_i = a + i * w + ml - i;
+      Scalar sum = x[i];
+      for (size_t j = j_begin; j < i; ++j) {
+        sum -= row_i[j] * x[j];
+      }
+      x[i] = sum;
+    }
+
+    for (size_t i = n; i-- > 0;) {
+      size_t j_end = std::min(n, i + mu + 1);
+      Scalar const * row_i = a + i * w + ml - i;
+      Scalar sum = x[i];
+      for (size_t j = i + 1; j < j_end; ++j) {
+        sum -= row_i[j] * x[j];
+      }
+      x[i] = sum / row_i[i];
+    }
+  }
+
+  /**
+   * LU with partial pivoting (like LAPACK gbtrf). The matrix has ml bands below
+   * and ml + mr above the diagonal, the upper ml of them are zero on entry and
+   * receive the fill caused by row interchanges.
+   * At step k rows k and pivots[k] are swapped in columns k and to the right,
+   * so multipliers of earlier steps stay where they were computed.
+   */
+  template<class Scalar>
+  void band_lu_pivoting(size_t n, size_t ml, size_t mr, Scalar * a, size_t * pivots) {
+    size_t mu = ml + mr;
+    size_t w = ml + mu + 1;
+
+    for (size_t k = 0; k < n; ++k) {
+      size_t i_end = std::min(n, k + ml + 1);
+
+      size_t p = k;
+      for (size_t i = k + 1; i < i_end; ++i) {
+        if (std::abs(band_at(a, w, ml, i, k)) > std::abs(band_at(a, w, ml, p, k))) {
+          p = i;
+        }
+      }
+      pivots[k] = p;
+
+      size_t j_end = std::min(n, k + mu + 1);
+      if (p != k) {
+        Scalar * row_k = &band_at(a, w, ml, k, k);
+        Scalar * row_p = &band_at(a, w, ml, p, k);
+        for (size_t j = 0; j < j_end - k; ++j) {
+          std::swap(row_k[j], row_p[j]);
+        }
+      }
+
+      Scalar const * row_k = &band_at(a, w, ml, k, k);
+      for (size_t i = k + 1; i < i_end; ++i) {
+        Scalar * row_i = &band_at(a, w, ml, i, k);
+        Scalar l_ik = row_i[0] / row_k[0];
+        row_i[0] = l_ik;
+        for (size_t j = 1; j < j_end - k; ++j) {
+          row_i[j] -= l_ik * row_k[j];
+        }
+      }
+    }
+  }
+
+  // Solves A x = b in place for factors of band_lu_pivoting
+  template<class Scalar>
+  void band_lu_pivoting_solve(size_t n, size_t ml, size_t mr, Scalar const * a, size_t const * pivots, Scalar * x) {
+    size_t mu = ml + mr;
+    size_t w = ml + mu + 1;
+
+    for (size_t k = 0; k < n; ++k) {
+      std::swap(x[k], x[pivots[k]]);
+      size_t i_end = std::min(n, k + ml + 1);
+      for (size_t i = k + 1; i < i_end; ++i) {
+        x[i] -= a[i * w + k + ml - i] * x[k];
+      }
+    }
+
+    for (size_t i = n; i-- > 0;) {
+      size_t j_end = std::min(n, i + mu + 1);
+      Scalar const * row_i = a + i * w + ml - i;
+      Scalar sum = x[i];
+      for (size_t j = i + 1; j < j_end; ++j) {
+        sum -= row_i[j] * x[j];
+      }
+      x[i] = sum / row_i[i];
+    }
+  }
+
+  // Turns L U into L D U with unit diagonal U, D stored on the diagonal
+  template<class Scalar>
+  void band_lu_to_ldu(size_t n, size_t ml, size_t mu, Scalar * a) {
+    size_t w = ml + mu + 1;
+
+    for (size_t i = 0; i < n; ++i) {
+      Scalar * row_i = a + i * w + ml - i;
+      Scalar d = row_i[i];
+      size_t j_end = std::min(n, i + mu + 1);
+      for (size_t j = i + 1; j < j_end; ++j) {
+        row_i[j] /= d;
+      }
+    }
+  }
+} } } // namespace fe::la::details
+
+#endif // BAND_LU_KERNELS_HPP_
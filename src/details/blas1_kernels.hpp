@@ -0,0 +1,536 @@
+#ifndef BLAS1_KERNELS_HPP_
+#define BLAS1_KERNELS_HPP_
+
+#include <cstddef>
+#include <complex>
+#include <cmath>
+#include <algorithm>
+
+#include "simd_dispatch.hpp"
+
+namespace fe { namespace la { namespace details {
+  template<class Scalar>
+  struct real_type {
+    typedef Scalar type;
+  };
+
+  template<class T>
+  struct real_type<std::complex<T>> {
+    typedef T type;
+  };
+
+  template<class Scalar>
+  Scalar conj_if_complex(Scalar const & value) {
+    return value;
+  }
+
+  template<class T>
+  std::complex<T> conj_if_complex(std::complex<T> const & value) {
+    return std::conj(value);
+  }
+
+  template<class Scalar>
+  Scalar abs_squared(Scalar const & value) {
+    return value * value;
+  }
+
+  template<class T>
+  T abs_squared(std::complex<T> const & value) {
+    return std::norm(value);
+  }
+
+  // Portable kernels, used for any scalar type and as a fallback for the SIMD ones
+
+  // y += alpha * x
+  template<class Scalar>
+  void axpy_portable(size_t n, Scalar alpha, Scalar const * x, Scalar * y) {
+    for (size_t i = 0; i < n; ++i) {
+      y[i] += alpha * x[i];
+    }
+  }
+
+  // x *= alpha
+  template<class Scalar>
+  void scal_portable(size_t n, Scalar alpha, Scalar * x) {
+    for (size_t i = 0; i < n; ++i) {
+      x[i] *= alpha;
+    }
+  }
+
+  // sum of x[i] * y[i]
+  template<class Scalar>
+  Scalar dot_portable(size_t n, Scalar const * x, Scalar const * y) {
+    Scalar s0 = Scalar(), s1 = Scalar();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+      s0 += x[i] * y[i];
+      s1 += x[i + 1] * y[i + 1];
+    }
+    for (; i < n; ++i) {
+      s0 += x[i] * y[i];
+    }
+    return s0 + s1;
+  }
+
+  // sum of conj(x[i]) * y[i]
+  template<class Scalar>
+  Scalar dotc_portable(size_t n, Scalar const * x, Scalar const * y) {
+    Scalar s0 = Scalar(), s1 = Scalar();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+      s0 += conj_if_complex(x[i]) * y[i];
+      s1 += conj_if_complex(x[i + 1]) * y[i + 1];
+    }
+    for (; i < n; ++i) {
+      s0 += conj_if_complex(x[i]) * y[i];
+    }
+    return s0 + s1;
+  }
+
+  // sum of |x[i]|^2
+  template<class Scalar>
+  typename real_type<Scalar>::type sumsq_portable(size_t n, Scalar const * x) {
+    typedef typename real_type<Scalar>::type real_t;
+    real_t s0 = real_t(), s1 = real_t();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+      s0 += abs_squared(x[i]);
+      s1 += abs_squared(x[i + 1]);
+    }
+    for (; i < n; ++i) {
+      s0 += abs_squared(x[i]);
+    }
+    return s0 + s1;
+  }
+
+  // Largest magnitude of the real and imaginary parts
+  template<class Scalar>
+  Scalar max_component(Scalar const & value) {
+    return std::abs(value);
+  }
+
+  template<class T>
+  T max_component(std::complex<T> const & value) {
+    return std::max(std::abs(value.real()), std::abs(value.imag()));
+  }
+
+  // sqrt of the sum of |x[i]|^2 with every element divided by the largest component first,
+  //   so no square overflows or underflows; a second pass over x, used when the plain sum fails
+  template<class Scalar>
+  typename real_type<Scalar>::type nrm2_scaled(size_t n, Scalar const * x) {
+    typedef typename real_type<Scalar>::type real_t;
+    real_t scale = real_t();
+    for (size_t i = 0; i < n; ++i) {
+      scale = std::max(scale, max_component(x[i]));
+    }
+    if (scale == real_t() || !std::isfinite(scale)) {
+      return scale;
+    }
+
+    real_t sum = real_t();
+    for (size_t i = 0; i < n; ++i) {
+      sum += abs_squared(x[i] / scale);
+    }
+    return scale * std::sqrt(sum);
+  }
+
+#ifdef FE_LA_X86_SIMD
+  // AVX2 kernels. Complex numbers are processed as interleaved (re, im) pairs of doubles.
+
+  __attribute__((target("avx2,fma")))
+  inline double hsum_avx2(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+  }
+
+  // Returns (even lanes sum, odd lanes sum)
+  __attribute__((target("avx2,fma")))
+  inline void hsum_even_odd_avx2(__m256d v, double & even, double & odd) {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    even = _mm_cvtsd_f64(s);
+    odd = _mm_cvtsd_f64(_mm_unpackhi_pd(s, s));
+  }
+
+  // Multiplies interleaved complex numbers in x by the complex (re, im)
+  __attribute__((target("avx2,fma")))
+  inline __m256d cmul_avx2(__m256d re, __m256d im, __m256d x) {
+    __m256d swapped = _mm256_permute_pd(x, 0x5);
+    return _mm256_fmaddsub_pd(re, x, _mm256_mul_pd(im, swapped));
+  }
+
+  __attribute__((target("avx2,fma")))
+  inline void axpy_avx2(size_t n, double alpha, double const * x, double * y) {
+    __m256d a = _mm256_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      __m256d y0 = _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+      __m256d y1 = _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4));
+      _mm256_storeu_pd(y + i, y0);
+      _mm256_storeu_pd(y + i + 4, y1);
+    }
+    for (; i < n; ++i) {
+      y[i] += alpha * x[i];
+    }
+  }
+
+  __attribute__((target("avx2,fma")))
+  inline void scal_avx2(size_t n, double alpha, double * x) {
+    __m256d a = _mm256_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      _mm256_storeu_pd(x + i, _mm256_mul_pd(a, _mm256_loadu_pd(x + i)));
+    }
+    for (; i < n; ++i) {
+      x[i] *= alpha;
+    }
+  }
+
+  __attribute__((target("avx2,fma")))
+  inline double dot_avx2(size_t n, double const * x, double const * y) {
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd();
+    __m256d s3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+      s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), s1);
+      s2 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 8), _mm256_loadu_pd(y + i + 8), s2);
+      s3 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 12), _mm256_loadu_pd(y + i + 12), s3);
+    }
+    for (; i + 4 <= n; i += 4) {
+      s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+    }
+    double res = hsum_avx2(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+    for (; i < n; ++i) {
+      res += x[i] * y[i];
+    }
+    return res;
+  }
+
+  // n is the number of complex numbers
+  __attribute__((target("avx2,fma")))
+  inline void zaxpy_avx2(size_t n, std::complex<double> alpha,
+      std::complex<double> const * x, std::complex<double> * y) {
+    double const * xd = reinterpret_cast<double const *>(x);
+    double * yd = reinterpret_cast<double *>(y);
+    __m256d re = _mm256_set1_pd(alpha.real());
+    __m256d im = _mm256_set1_pd(alpha.imag());
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+      __m256d prod = cmul_avx2(re, im, _mm256_loadu_pd(xd + 2 * i));
+      _mm256_storeu_pd(yd + 2 * i, _mm256_add_pd(_mm256_loadu_pd(yd + 2 * i), prod));
+    }
+    for (; i < n; ++i) {
+      y[i] += alpha * x[i];
+    }
+  }
+
+  __attribute__((target("avx2,fma")))
+  inline void zscal_avx2(size_t n, std::complex<double> alpha, std::complex<double> * x) {
+    double * xd = reinterpret_cast<double *>(x);
+    __m256d re = _mm256_set1_pd(alpha.real());
+    __m256d im = _mm256_set1_pd(alpha.imag());
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+      _mm256_storeu_pd(xd + 2 * i, cmul_avx2(re, im, _mm256_loadu_pd(xd + 2 * i)));
+    }
+    for (; i < n; ++i) {
+      x[i] *= alpha;
+    }
+  }
+
+  // Computes sum(conj(x) * y) if conjugate is set and sum(x * y) otherwise
+  __attribute__((target("avx2,fma")))
+  inline void zdot_avx2(size_t n, std::complex<double> const * x, std::complex<double> const * y,
+      bool conjugate, std::complex<double> & res) {
+    double const * xd = reinterpret_cast<double const *>(x);
+    double const * yd = reinterpret_cast<double const *>(y);
+    // direct holds (xr * yr, xi * yi), crossed holds (xr * yi, xi * yr)
+    __m256d direct = _mm256_setzero_pd();
+    __m256d crossed = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+      __m256d xv = _mm256_loadu_pd(xd + 2 * i);
+      __m256d yv = _mm256_loadu_pd(yd + 2 * i);
+      direct = _mm256_fmadd_pd(xv, yv, direct);
+      crossed = _mm256_fmadd_pd(xv, _mm256_permute_pd(yv, 0x5), crossed);
+    }
+    double d_even, d_odd, c_even, c_odd;
+    hsum_even_odd_avx2(direct, d_even, d_odd);
+    hsum_even_odd_avx2(crossed, c_even, c_odd);
+    if (conjugate) {
+      res = std::complex<double>(d_even + d_odd, c_even - c_odd);
+      for (; i < n; ++i) {
+        res += std::conj(x[i]) * y[i];
+      }
+    } else {
+      res = std::complex<double>(d_even - d_odd, c_even + c_odd);
+      for (; i < n; ++i) {
+        res += x[i] * y[i];
+      }
+    }
+  }
+
+  // AVX-512 kernels, same structure as the AVX2 ones with twice as wide vectors
+
+  __attribute__((target("avx512f")))
+  inline double hsum_avx512(__m512d v) {
+    double lanes[8];
+    _mm512_storeu_pd(lanes, v);
+    return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+  }
+
+  __attribute__((target("avx512f")))
+  inline void hsum_even_odd_avx512(__m512d v, double & even, double & odd) {
+    double lanes[8];
+    _mm512_storeu_pd(lanes, v);
+    even = (lanes[0] + lanes[2]) + (lanes[4] + lanes[6]);
+    odd = (lanes[1] + lanes[3]) + (lanes[5] + lanes[7]);
+  }
+
+  __attribute__((target("avx512f")))
+  inline __m512d cmul_avx512(__m512d re, __m512d im, __m512d x) {
+    __m512d swapped = _mm512_shuffle_pd(x, x, 0x55);
+    return _mm512_fmaddsub_pd(re, x, _mm512_mul_pd(im, swapped));
+  }
+
+  __attribute__((target("avx512f")))
+  inline void axpy_avx512(size_t n, double alpha, double const * x, double * y) {
+    __m512d a = _mm512_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      __m512d y0 = _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i));
+      __m512d y1 = _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8));
+      _mm512_storeu_pd(y + i, y0);
+      _mm512_storeu_pd(y + i + 8, y1);
+    }
+    for (; i < n; ++i) {
+      y[i] += alpha * x[i];
+    }
+  }
+
+  __attribute__((target("avx512f")))
+  inline void scal_avx512(size_t n, double alpha, double * x) {
+    __m512d a = _mm512_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      _mm512_storeu_pd(x + i, _mm512_mul_pd(a, _mm512_loadu_pd(x + i)));
+    }
+    for (; i < n; ++i) {
+      x[i] *= alpha;
+    }
+  }
+
+  __attribute__((target("avx512f")))
+  inline double dot_avx512(size_t n, double const * x, double const * y) {
+    __m512d s0 = _mm512_setzero_pd();
+    __m512d s1 = _mm512_setzero_pd();
+    __m512d s2 = _mm512_setzero_pd();
+    __m512d s3 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+      s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+      s1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), s1);
+      s2 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 16), _mm512_loadu_pd(y + i + 16), s2);
+      s3 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 24), _mm512_loadu_pd(y + i + 24), s3);
+    }
+    for (; i + 8 <= n; i += 8) {
+      s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+    }
+    double res = hsum_avx512(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+    for (; i < n; ++i) {
+      res += x[i] * y[i];
+    }
+    return res;
+  }
+
+  __attribute__((target("avx512f")))
+  inline void zaxpy_avx512(size_t n, std::complex<double> alpha,
+      std::complex<double> const * x, std::complex<double> * y) {
+    double const * xd = reinterpret_cast<double const *>(x);
+    double * yd = reinterpret_cast<double *>(y);
+    __m512d re = _mm512_set1_pd(alpha.real());
+    __m512d im = _mm512_set1_pd(alpha.imag());
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m512d prod = cmul_avx512(re, im, _mm512_loadu_pd(xd + 2 * i));
+      _mm512_storeu_pd(yd + 2 * i, _mm512_add_pd(_mm512_loadu_pd(yd + 2 * i), prod));
+    }
+    for (; i < n; ++i) {
+      y[i] += alpha * x[i];
+    }
+  }
+
+  __attribute__((target("avx512f")))
+  inline void zscal_avx512(size_t n, std::complex<double> alpha, std::complex<double> * x) {
+    double * xd = reinterpret_cast<double *>(x);
+    __m512d re = _mm512_set1_pd(alpha.real());
+    __m512d im = _mm512_set1_pd(alpha.imag());
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      _mm512_storeu_pd(xd + 2 * i, cmul_avx512(re, im, _mm512_loadu_pd(xd + 2 * i)));
+    }
+    for (; i < n; ++i) {
+      x[i] *= alpha;
+    }
+  }
+
+  __attribute__((target("avx512f")))
+  inline void zdot_avx512(size_t n, std::complex<double> const * x, std::complex<double> const * y,
+      bool conjugate, std::complex<double> & res) {
+    double const * xd = reinterpret_cast<double const *>(x);
+    double const * yd = reinterpret_cast<double const *>(y);
+    __m512d direct = _mm512_setzero_pd();
+    __m512d crossed = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m512d xv = _mm512_loadu_pd(xd + 2 * i);
+      __m512d yv = _mm512_loadu_pd(yd + 2 * i);
+      direct = _mm512_fmadd_pd(xv, yv, direct);
+      crossed = _mm512_fmadd_pd(xv, _mm512_shuffle_pd(yv, yv, 0x55), crossed);
+    }
+    double d_even, d_odd, c_even, c_odd;
+    hsum_even_odd_avx512(direct, d_even, d_odd);
+    hsum_even_odd_avx512(crossed, c_even, c_odd);
+    if (conjugate) {
+      res = std::complex<double>(d_even + d_odd, c_even - c_odd);
+      for (; i < n; ++i) {
+        res += std::conj(x[i]) * y[i];
+      }
+    } else {
+      res = std::complex<double>(d_even - d_odd, c_even + c_odd);
+      for (; i < n; ++i) {
+        res += x[i] * y[i];
+      }
+    }
+  }
+#endif // FE_LA_X86_SIMD
+
+  // Dispatching kernels. Generic versions are used for scalar types without SIMD kernels.
+
+  template<class Scalar>
+  void axpy_kernel(size_t n, Scalar alpha, Scalar const * x, Scalar * y) {
+    axpy_portable(n, alpha, x, y);
+  }
+
+  template<class Scalar>
+  void scal_kernel(size_t n, Scalar alpha, Scalar * x) {
+    scal_portable(n, alpha, x);
+  }
+
+  template<class Scalar>
+  Scalar dot_kernel(size_t n, Scalar const * x, Scalar const * y) {
+    return dot_portable(n, x, y);
+  }
+
+  template<class Scalar>
+  Scalar dotc_kernel(size_t n, Scalar const * x, Scalar const * y) {
+    return dotc_portable(n, x, y);
+  }
+
+  template<class Scalar>
+  typename real_type<Scalar>::type sumsq_kernel(size_t n, Scalar const * x) {
+    return sumsq_portable(n, x);
+  }
+
+  inline void axpy_kernel(size_t n, double alpha, double const * x, double * y) {
+#ifdef FE_LA_X86_SIMD
+    switch (cpu_simd_level()) {
+      case simd_level::AVX512: return axpy_avx512(n, alpha, x, y);
+      case simd_level::AVX2: return axpy_avx2(n, alpha, x, y);
+      default: break;
+    }
+#endif
+    axpy_portable(n, alpha, x, y);
+  }
+
+  inline void scal_kernel(size_t n, double alpha, double * x) {
+#ifdef FE_LA_X86_SIMD
+    switch (cpu_simd_level()) {
+      case simd_level::AVX512: return scal_avx512(n, alpha, x);
+      case simd_level::AVX2: return scal_avx2(n, alpha, x);
+      default: break;
+    }
+#endif
+    scal_portable(n, alpha, x);
+  }
+
+  inline double dot_kernel(size_t n, double const * x, double const * y) {
+#ifdef FE_LA_X86_SIMD
+    switch (cpu_simd_level()) {
+      case simd_level::AVX512: return dot_avx512(n, x, y);
+      case simd_level::AVX2: return dot_avx2(n, x, y);
+      default: break;
+    }
+#endif
+    return dot_portable(n, x, y);
+  }
+
+  inline double dotc_kernel(size_t n, double const * x, double const * y) {
+    return dot_kernel(n, x, y);
+  }
+
+  inline double sumsq_kernel(size_t n, double const * x) {
+    return dot_kernel(n, x, x);
+  }
+
+  inline void axpy_kernel(size_t n, std::complex<double> alpha,
+      std::complex<double> const * x, std::complex<double> * y) {
+#ifdef FE_LA_X86_SIMD
+    switch (cpu_simd_level()) {
+      case simd_level::AVX512: return zaxpy_avx512(n, alpha, x, y);
+      case simd_level::AVX2: return zaxpy_avx2(n, alpha, x, y);
+      default: break;
+    }
+#endif
+    axpy_portable(n, alpha, x, y);
+  }
+
+  inline void scal_kernel(size_t n, std::complex<double> alpha, std::complex<double> * x) {
+#ifdef FE_LA_X86_SIMD
+    switch (cpu_simd_level()) {
+      case simd_level::AVX512: return zscal_avx512(n, alpha, x);
+      case simd_level::AVX2: return zscal_avx2(n, alpha, x);
+      default: break;
+    }
+#endif
+    scal_portable(n, alpha, x);
+  }
+
+  inline std::complex<double> dot_kernel(size_t n,
+      std::complex<double> const * x, std::complex<double> const * y) {
+#ifdef FE_LA_X86_SIMD
+    std::complex<double> res;
+    switch (cpu_simd_level()) {
+      case simd_level::AVX512: zdot_avx512(n, x, y, false, res); return res;
+      case simd_level::AVX2: zdot_avx2(n, x, y, false, res); return res;
+      default: break;
+    }
+#endif
+    return dot_portable(n, x, y);
+  }
+
+  inline std::complex<double> dotc_kernel(size_t n,
+      std::complex<double> const * x, std::complex<double> const * y) {
+#ifdef FE_LA_X86_SIMD
+    std::complex<double> res;
+    switch (cpu_simd_level()) {
+      case simd_level::AVX512: zdot_avx512(n, x, y, true, res); return res;
+      case simd_level::AVX2: zdot_avx2(n, x, y, true, res); return res;
+      default: break;
+    }
+#endif
+    return dotc_portable(n, x, y);
+  }
+
+  // |x|^2 of a complex vector is the squared norm of its 2n real components
+  inline double sumsq_kernel(size_t n, std::complex<double> const * x) {
+    double const * xd = reinterpret_cast<double const *>(x);
+    return dot_kernel(2 * n, xd, xd);
+  }
+} } } // namespace fe::la::details
+
+#endif // BLAS1_KERNELS_HPP_
@@ -0,0 +1,107 @@
+#ifndef BLOCK_KERNELS_HPP_
+#define BLOCK_KERNELS_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+// Operations on dense B x B blocks stored row-major, B is a compile-time constant so
+//   the compiler unrolls the loops and keeps small blocks in registers.
+
+namespace fe { namespace la { namespace details {
+  // y += A x
+  template<size_t B, class Scalar>
+  void block_mv_add(Scalar const * a, Scalar const * x, Scalar * y) {
+    for (size_t r = 0; r < B; ++r) {
+      Scalar sum = Scalar();
+      for (size_t c = 0; c < B; ++c) {
+        sum += a[r * B + c] * x[c];
+      }
+      y[r] += sum;
+    }
+  }
+
+  // y -= A x
+  template<size_t B, class Scalar>
+  void block_mv_sub(Scalar const * a, Scalar const * x, Scalar * y) {
+    for (size_t r = 0; r < B; ++r) {
+      Scalar sum = Scalar();
+      for (size_t c = 0; c < B; ++c) {
+        sum += a[r * B + c] * x[c];
+      }
+      y[r] -= sum;
+    }
+  }
+
+  // C = A B, C must not overlap A or B
+  template<size_t B, class Scalar>
+  void block_mm(Scalar const * a, Scalar const * b, Scalar * c) {
+    for (size_t r = 0; r < B; ++r) {
+      for (size_t j = 0; j < B; ++j) {
+        Scalar sum = Scalar();
+        for (size_t k = 0; k < B; ++k) {
+          sum += a[r * B + k] * b[k * B + j];
+        }
+        c[r * B + j] = sum;
+      }
+    }
+  }
+
+  // C -= A B
+  template<size_t B, class Scalar>
+  void block_mm_sub(Scalar const * a, Scalar const * b, Scalar * c) {
+    for (size_t r = 0; r < B; ++r) {
+      for (size_t k = 0; k < B; ++k) {
+        Scalar a_rk = a[r * B + k];
+        for (size_t j = 0; j < B; ++j) {
+          c[r * B + j] -= a_rk * b[k * B + j];
+        }
+      }
+    }
+  }
+
+  // Inverts A in place by Gauss-Jordan elimination with partial pivoting, A must be nonsingular
+  template<size_t B, class Scalar>
+  void block_invert(Scalar * a) {
+    size_t piv[B];
+    for (size_t k = 0; k < B; ++k) {
+      size_t p = k;
+      for (size_t i = k + 1; i < B; ++i) {
+        if (std::abs(a[i * B + k]) > std::abs(a[p * B + k])) {
+          p = i;
+        }
+      }
+      piv[k] = p;
+      if (p != k) {
+        std::swap_ranges(a + k * B, a + (k + 1) * B, a + p * B);
+      }
+      assert(a[k * B + k] != Scalar());
+
+      Scalar inv = Scalar(1) / a[k * B + k];
+      a[k * B + k] = Scalar(1);
+      for (size_t j = 0; j < B; ++j) {
+        a[k * B + j] *= inv;
+      }
+      for (size_t i = 0; i < B; ++i) {
+        if (i != k) {
+          Scalar f = a[i * B + k];
+          a[i * B + k] = Scalar();
+          for (size_t j = 0; j < B; ++j) {
+            a[i * B + j] -= f * a[k * B + j];
+          }
+        }
+      }
+    }
+    // Row interchanges of the elimination are column interchanges of the inverse
+    for (size_t k = B; k-- > 0;) {
+      if (piv[k] != k) {
+        for (size_t i = 0; i < B; ++i) {
+          std::swap(a[i * B + k], a[i * B + piv[k]]);
+        }
+      }
+    }
+  }
+} } } // namespace fe::la::details
+
+#endif // BLOCK_KERNELS_HPP_
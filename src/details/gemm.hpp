@@ -0,0 +1,293 @@
+#ifndef GEMM_HPP_
+#define GEMM_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <complex>
+#include <vector>
+#include <algorithm>
+
+#include "../threads.hpp"
+
+namespace fe { namespace la { namespace details {
+  // Blocking parameters of the gemm kernel.
+  //   mr x nr is the size of the register tile computed by the micro-kernel,
+  //   a packed mc x kc block of lhs is meant to stay in L2 cache,
+  //   a packed kc x nr micro-panel of rhs is meant to stay in L1 cache.
+  template<class Scalar>
+  struct gemm_blocking {
+    static size_t const mr = 4;
+    static size_t const nr = 8;
+    static size_t const mc = 96;
+    static size_t const kc = 256;
+    static size_t const nc = 2048;
+  };
+
+  template<class T>
+  struct gemm_blocking<std::complex<T>> {
+    static size_t const mr = 2;
+    static size_t const nr = 4;
+    static size_t const mc = 64;
+    static size_t const kc = 192;
+    static size_t const nc = 1024;
+  };
+
+  // Products smaller than this (in multiply-adds) are not worth packing
+  size_t const GEMM_SMALL_SIZE = 32 * 32 * 32;
+  // Minimal amount of multiply-adds worth giving to a separate thread
+  size_t const PARALLEL_MIN_WORK = 64 * 64 * 64;
+
+  // Packs rows [0, m) and columns [0, k) of lhs into micro-panels of mr rows.
+  // Inside a micro-panel elements are stored column by column, the last
+  // micro-panel is padded with zeros.
+  template<class Scalar>
+  void gemm_pack_lhs(size_t m, size_t k, Scalar const * a, size_t lda, Scalar * packed) {
+    size_t const mr = gemm_blocking<Scalar>::mr;
+
+    for (size_t i = 0; i < m; i += mr) {
+      size_t rows = std::min(mr, m - i);
+      for (size_t p = 0; p < k; ++p) {
+        for (size_t ii = 0; ii < rows; ++ii) {
+          packed[ii] = a[(i + ii) * lda + p];
+        }
+        for (size_t ii = rows; ii < mr; ++ii) {
+          packed[ii] = Scalar();
+        }
+        packed += mr;
+      }
+    }
+  }
+
+  // Packs rows [0, k) and columns [0, n) of rhs into micro-panels of nr columns.
+  // Inside a micro-panel elements are stored row by row, the last
+  // micro-panel is padded with zeros.
+  template<class Scalar>
+  void gemm_pack_rhs(size_t k, size_t n, Scalar const * b, size_t ldb, Scalar * packed) {
+    size_t const nr = gemm_blocking<Scalar>::nr;
+
+    for (size_t j = 0; j < n; j += nr) {
+      size_t cols = std::min(nr, n - j);
+      for (size_t p = 0; p < k; ++p) {
+        Scalar const * row = b + p * ldb + j;
+        for (size_t jj = 0; jj < cols; ++jj) {
+          packed[jj] = row[jj];
+        }
+        for (size_t jj = cols; jj < nr; ++jj) {
+          packed[jj] = Scalar();
+        }
+        packed += nr;
+      }
+    }
+  }
+
+  // Computes C += A * B for an mr x k micro-panel of A and a k x nr micro-panel of B.
+  // Only the top-left m x n corner of the tile is written back to C.
+  template<class Scalar>
+  void gemm_micro_kernel(size_t k, Scalar const * a, Scalar const * b,
+      Scalar * c, size_t ldc, size_t m, size_t n) {
+    size_t const mr = gemm_blocking<Scalar>::mr;
+    size_t const nr = gemm_blocking<Scalar>::nr;
+
+    // Accumulators have fixed size, so the compiler can keep them in registers
+    Scalar acc[mr][nr];
+    for (size_t i = 0; i < mr; ++i) {
+      for (size_t j = 0; j < nr; ++j) {
+        acc[i][j] = Scalar();
+      }
+    }
+
+    for (size_t p = 0; p < k; ++p) {
+      for (size_t i = 0; i < mr; ++i) {
+        Scalar a_ip = a[i];
+        for (size_t j = 0; j < nr; ++j) {
+          acc[i][j] += a_ip * b[j];
+        }
+      }
+      a += mr;
+      b += nr;
+    }
+
+    for (size_t i = 0; i < m; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        c[i * ldc + j] += acc[i][j];
+      }
+    }
+  }
+
+  // Computes C += A * B with a straightforward i-k-j loop, used for small products
+  template<class Scalar>
+  void gemm_small(size_t m, size_t n, size_t k,
+      Scalar const * a, size_t lda, Scalar const * b, size_t ldb,
+      Scalar * c, size_t ldc) {
+    for (size_t i = 0; i < m; ++i) {
+      Scalar * c_row = c + i * ldc;
+      for (size_t p = 0; p < k; ++p) {
+        Scalar a_ip = a[i * lda + p];
+        Scalar const * b_row = b + p * ldb;
+        for (size_t j = 0; j < n; ++j) {
+          c_row[j] += a_ip * b_row[j];
+        }
+      }
+    }
+  }
+
+  // Computes C += A * B using packed blocks, see gemm for the meaning of parameters
+  template<class Scalar>
+  void gemm_blocked(size_t m, size_t n, size_t k,
+      Scalar const * a, size_t lda, Scalar const * b, size_t ldb,
+      Scalar * c, size_t ldc) {
+    typedef gemm_blocking<Scalar> blocking;
+    size_t const mr = blocking::mr;
+    size_t const nr = blocking::nr;
+    size_t const max_mc = blocking::mc;
+    size_t const max_kc = blocking::kc;
+    size_t const max_nc = blocking::nc;
+
+    // Shrink the blocks for matrices smaller than a single block
+    size_t const mc = std::min(max_mc, (m + mr - 1) / mr * mr);
+    size_t const kc = std::min(max_kc, k);
+    size_t const nc = std::min(max_nc, (n + nr - 1) / nr * nr);
+
+    std::vector<Scalar> packed_a(mc * kc);
+    std::vector<Scalar> packed_b(kc * nc);
+
+    for (size_t jc = 0; jc < n; jc += nc) {
+      size_t nb = std::min(nc, n - jc);
+      for (size_t pc = 0; pc < k; pc += kc) {
+        size_t kb = std::min(kc, k - pc);
+        gemm_pack_rhs(kb, nb, b + pc * ldb + jc, ldb, packed_b.data());
+
+        for (size_t ic = 0; ic < m; ic += mc) {
+          size_t mb = std::min(mc, m - ic);
+          gemm_pack_lhs(mb, kb, a + ic * lda + pc, lda, packed_a.data());
+
+          for (size_t jr = 0; jr < nb; jr += nr) {
+            for (size_t ir = 0; ir < mb; ir += mr) {
+              gemm_micro_kernel(kb,
+                  packed_a.data() + ir * kb,
+                  packed_b.data() + jr * kb,
+                  c + (ic + ir) * ldc + jc + jr, ldc,
+                  std::min(mr, mb - ir),
+                  std::min(nr, nb - jr));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Computes C += A * B, where A is m x k, B is k x n and C is m x n.
+   * All matrices are stored row by row, ld* is the distance between
+   * the beginnings of two consecutive rows.
+   */
+  template<class Scalar>
+  void gemm(size_t m, size_t n, size_t k,
+      Scalar const * a, size_t lda, Scalar const * b, size_t ldb,
+      Scalar * c, size_t ldc) {
+    if (m == 0 || n == 0 || k == 0) {
+      return;
+    }
+
+    if (m * n * k <= GEMM_SMALL_SIZE) {
+      gemm_small(m, n, k, a, lda, b, ldb, c, ldc);
+    } else {
+      gemm_blocked(m, n, k, a, lda, b, ldb, c, ldc);
+    }
+  }
+
+  // The same as gemm, but rows of C are split between threads.
+  // Every element of C is computed by the same operations as in gemm,
+  // so the result does not depend on the number of threads.
+  template<class Scalar>
+  void gemm_parallel(size_t m, size_t n, size_t k,
+      Scalar const * a, size_t lda, Scalar const * b, size_t ldb,
+      Scalar * c, size_t ldc) {
+    if (m * n * k <= GEMM_SMALL_SIZE) {
+      gemm(m, n, k, a, lda, b, ldb, c, ldc);
+      return;
+    }
+
+    size_t const mr = gemm_blocking<Scalar>::mr;
+    size_t min_rows = std::max(mr, PARALLEL_MIN_WORK / (n * k));
+
+    parallel_chunks(m, min_rows, mr, [&](size_t first, size_t last) {
+      gemm_blocked(last - first, n, k, a + first * lda, lda, b, ldb, c + first * ldc, ldc);
+    });
+  }
+
+  // y = beta * y, where y is overwritten by zeros if beta is zero
+  template<class Scalar>
+  void scale_output(size_t n, Scalar beta, Scalar * y) {
+    if (beta == Scalar()) {
+      std::fill(y, y + n, Scalar());
+    } else if (beta != Scalar(1)) {
+      for (size_t i = 0; i < n; ++i) {
+        y[i] *= beta;
+      }
+    }
+  }
+
+  // Computes y = alpha * A * x + beta * y, where A is m x n stored row by row.
+  // If beta is zero, y is not read.
+  template<class Scalar>
+  void gemv(size_t m, size_t n, Scalar alpha, Scalar const * a, size_t lda,
+      Scalar const * x, Scalar beta, Scalar * y) {
+    for (size_t i = 0; i < m; ++i) {
+      Scalar const * a_row = a + i * lda;
+      // Several independent partial sums hide the latency of additions
+      Scalar s0 = Scalar(), s1 = Scalar(), s2 = Scalar(), s3 = Scalar();
+      size_t j = 0;
+      for (; j + 4 <= n; j += 4) {
+        s0 += a_row[j] * x[j];
+        s1 += a_row[j + 1] * x[j + 1];
+        s2 += a_row[j + 2] * x[j + 2];
+        s3 += a_row[j + 3] * x[j + 3];
+      }
+      for (; j < n; ++j) {
+        s0 += a_row[j] * x[j];
+      }
+      Scalar sum = alpha * ((s0 + s1) + (s2 + s3));
+      y[i] = (beta == Scalar()) ? sum : beta * y[i] + sum;
+    }
+  }
+
+  // Computes y = alpha * x * A + beta * y, where A is m x n stored row by row.
+  // If beta is zero, y is not read.
+  template<class Scalar>
+  void gevm(size_t m, size_t n, Scalar alpha, Scalar const * x, Scalar const * a, size_t lda,
+      Scalar beta, Scalar * y) {
+    scale_output(n, beta, y);
+    for (size_t i = 0; i < m; ++i) {
+      Scalar x_i = alpha * x[i];
+      Scalar const * a_row = a + i * lda;
+      for (size_t j = 0; j < n; ++j) {
+        y[j] += x_i * a_row[j];
+      }
+    }
+  }
+
+  // The same as gemv, with rows of A split between threads
+  template<class Scalar>
+  void gemv_parallel(size_t m, size_t n, Scalar alpha, Scalar const * a, size_t lda,
+      Scalar const * x, Scalar beta, Scalar * y) {
+    size_t min_rows = PARALLEL_MIN_WORK / std::max<size_t>(n, 1) + 1;
+
+    parallel_chunks(m, min_rows, 1, [&](size_t first, size_t last) {
+      gemv(last - first, n, alpha, a + first * lda, lda, x, beta, y + first);
+    });
+  }
+
+  // The same as gevm, with columns of A split between threads
+  template<class Scalar>
+  void gevm_parallel(size_t m, size_t n, Scalar alpha, Scalar const * x, Scalar const * a, size_t lda,
+      Scalar beta, Scalar * y) {
+    size_t min_cols = PARALLEL_MIN_WORK / std::max<size_t>(m, 1) + 1;
+
+    parallel_chunks(n, min_cols, 8, [&](size_t first, size_t last) {
+      gevm(m, last - first, alpha, x, a + first, lda, beta, y + first);
+    });
+  }
+} } } // namespace fe::la::details
+
+#endif // GEMM_HPP_
@@ -0,0 +1,301 @@
+#ifndef INCOMPLETE_FACTORIZATION_KERNELS_HPP_
+#define INCOMPLETE_FACTORIZATION_KERNELS_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "blas1_kernels.hpp"
+#include "block_kernels.hpp"
+
+// Incomplete factorizations of matrices in compressed row form with sorted columns.
+// L + U factors are stored like the complete ones (sparse_lu_kernels.hpp): unit
+//   diagonal L below the diagonal, U on and above it, diag[i] is the position of
+//   the diagonal of row i.
+
+namespace fe { namespace la { namespace details {
+  size_t const NOT_IN_ROW = size_t(-1);
+
+  // Positions of the diagonal elements, every row must have one
+  inline void diagonal_positions(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      std::vector<size_t> & diag) {
+    diag.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      auto b = ja.begin() + ia[i];
+      auto e = ja.begin() + ia[i + 1];
+      auto pos = std::lower_bound(b, e, i);
+      assert(pos != e && *pos == i);
+      diag[i] = pos - ja.begin();
+    }
+  }
+
+  /**
+   * ILU(0) in place: L U restricted to the pattern of A, updates that fall outside
+   * of it are dropped.
+   *
+   * @param pos A buffer of n NOT_IN_ROW values, it is left in that state.
+   */
+  template<class Scalar>
+  void ilu0(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      std::vector<size_t> const & diag, Scalar * a, std::vector<size_t> & pos) {
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        pos[ja[p]] = p;
+      }
+
+      for (size_t p = ia[i]; p < diag[i]; ++p) {
+        size_t k = ja[p];
+        Scalar l_ik = a[p] / a[diag[k]];
+        a[p] = l_ik;
+
+        for (size_t q = diag[k] + 1; q < ia[k + 1]; ++q) {
+          if (pos[ja[q]] != NOT_IN_ROW) {
+            a[pos[ja[q]]] -= l_ik * a[q];
+          }
+        }
+      }
+
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        pos[ja[p]] = NOT_IN_ROW;
+      }
+    }
+  }
+
+  /**
+   * Block ILU(0) in place for compressed rows of B x B blocks (block_compressed_row_matrix),
+   * the same elimination as ilu0 with blocks for elements: L_ik = A_ik U_kk^-1 and
+   * A_ij -= L_ik U_kj inside the pattern. L has identity diagonal blocks, the inverses
+   * of the diagonal blocks of U go to inv_diag (B * B values for every block row).
+   *
+   * @param pos A buffer of n NOT_IN_ROW values, it is left in that state.
+   */
+  template<size_t B, class Scalar>
+  void block_ilu0(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      std::vector<size_t> const & diag, Scalar * a, Scalar * inv_diag, std::vector<size_t> & pos) {
+    size_t const bb = B * B;
+    Scalar l[B * B];
+
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        pos[ja[p]] = p;
+      }
+
+      for (size_t p = ia[i]; p < diag[i]; ++p) {
+        size_t k = ja[p];
+        block_mm<B>(a + p * bb, inv_diag + k * bb, l);
+        std::copy(l, l + bb, a + p * bb);
+
+        for (size_t q = diag[k] + 1; q < ia[k + 1]; ++q) {
+          if (pos[ja[q]] != NOT_IN_ROW) {
+            block_mm_sub<B>(a + p * bb, a + q * bb, a + pos[ja[q]] * bb);
+          }
+        }
+      }
+
+      std::copy(a + diag[i] * bb, a + (diag[i] + 1) * bb, inv_diag + i * bb);
+      block_invert<B>(inv_diag + i * bb);
+
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        pos[ja[p]] = NOT_IN_ROW;
+      }
+    }
+  }
+
+  // Solves L U x = b in place for the factors of block_ilu0
+  template<size_t B, class Scalar>
+  void block_lu_solve_inplace(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      std::vector<size_t> const & diag, Scalar const * a, Scalar const * inv_diag, Scalar * x) {
+    size_t const bb = B * B;
+
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t p = ia[i]; p < diag[i]; ++p) {
+        block_mv_sub<B>(a + p * bb, x + ja[p] * B, x + i * B);
+      }
+    }
+
+    Scalar t[B];
+    for (size_t i = n; i-- > 0;) {
+      for (size_t p = diag[i] + 1; p < ia[i + 1]; ++p) {
+        block_mv_sub<B>(a + p * bb, x + ja[p] * B, x + i * B);
+      }
+      std::copy(x + i * B, x + (i + 1) * B, t);
+      std::fill(x + i * B, x + (i + 1) * B, Scalar());
+      block_mv_add<B>(inv_diag + i * bb, t, x + i * B);
+    }
+  }
+
+  /**
+   * IC(0) in place: A = L L^T restricted to the pattern of the lower triangle,
+   * given by rows with the diagonal last in every row.
+   * l_ij = (a_ij - sum over k < j of l_ik * l_jk) / l_jj, where the sum runs over
+   * the common columns of the sorted rows i and j.
+   */
+  template<class Scalar>
+  void ic0(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja, Scalar * a) {
+    for (size_t i = 0; i < n; ++i) {
+      assert(ia[i + 1] > ia[i] && ja[ia[i + 1] - 1] == i);
+
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        size_t j = ja[p];
+
+        Scalar sum = a[p];
+        size_t q = ia[i];
+        size_t r = ia[j];
+        while (q < p && r < ia[j + 1] - 1) {
+          if (ja[q] < ja[r]) {
+            ++q;
+          } else if (ja[q] > ja[r]) {
+            ++r;
+          } else {
+            sum -= a[q++] * a[r++];
+          }
+        }
+
+        a[p] = j == i ? std::sqrt(sum) : sum / a[ia[j + 1] - 1];
+      }
+    }
+  }
+
+  /**
+   * ILUT(tolerance, fill) of Saad: row i is eliminated in a dense work row, then
+   * elements smaller than tolerance * ||a_i|| are dropped and only the fill largest
+   * elements of each of L and U are kept besides the diagonal.
+   * The factors are written to lu_ia, lu_ja, lu_a and lu_diag.
+   */
+  template<class Scalar, class Storage>
+  void ilut(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja, Scalar const * a,
+      double tolerance, size_t fill,
+      std::vector<size_t> & lu_ia, std::vector<size_t> & lu_ja, Storage & lu_a, std::vector<size_t> & lu_diag) {
+    typedef typename real_type<Scalar>::type real_t;
+
+    lu_ia.assign(1, 0);
+    lu_ja.clear();
+    lu_a.clear();
+    lu_diag.resize(n);
+
+    std::vector<Scalar> work(n, Scalar());
+    std::vector<bool> nonzero(n, false);
+    // Columns with a value in the work row, below the diagonal kept as a min-heap
+    std::vector<size_t> lower;
+    std::vector<size_t> upper;
+    std::vector<size_t> kept;
+
+    for (size_t i = 0; i < n; ++i) {
+      lower.clear();
+      upper.clear();
+
+      real_t row_norm = 0;
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        size_t j = ja[p];
+        row_norm += abs_squared(a[p]);
+        work[j] = a[p];
+        nonzero[j] = true;
+        if (j < i) {
+          lower.push_back(j);
+        } else {
+          upper.push_back(j);
+        }
+      }
+      row_norm = std::sqrt(row_norm);
+      real_t drop = real_t(tolerance) * row_norm;
+
+      if (!nonzero[i]) {
+        nonzero[i] = true;
+        work[i] = Scalar();
+        upper.push_back(i);
+      }
+
+      // Eliminate columns below the diagonal in increasing order, fill may add new ones
+      std::make_heap(lower.begin(), lower.end(), std::greater<size_t>());
+      kept.clear();
+      while (!lower.empty()) {
+        std::pop_heap(lower.begin(), lower.end(), std::greater<size_t>());
+        size_t k = lower.back();
+        lower.pop_back();
+
+        Scalar l_ik = work[k] / lu_a[lu_diag[k]];
+        if (std::abs(l_ik) < drop) {
+          work[k] = Scalar();
+          nonzero[k] = false;
+          continue;
+        }
+        work[k] = l_ik;
+        kept.push_back(k);
+
+        for (size_t q = lu_diag[k] + 1; q < lu_ia[k + 1]; ++q) {
+          size_t j = lu_ja[q];
+          if (!nonzero[j]) {
+            nonzero[j] = true;
+            work[j] = Scalar();
+            if (j < i) {
+              lower.push_back(j);
+              std::push_heap(lower.begin(), lower.end(), std::greater<size_t>());
+            } else {
+              upper.push_back(j);
+            }
+          }
+          work[j] -= l_ik * lu_a[q];
+        }
+      }
+
+      // Keeps the fill largest elements of a part of the row, sorted by column
+      auto select = [&](std::vector<size_t> & cols, bool keep_diagonal) {
+        size_t count = 0;
+        for (size_t c = 0; c < cols.size(); ++c) {
+          size_t j = cols[c];
+          if ((keep_diagonal && j == i) || std::abs(work[j]) >= drop) {
+            cols[count++] = j;
+          } else {
+            work[j] = Scalar();
+            nonzero[j] = false;
+          }
+        }
+        cols.resize(count);
+
+        auto by_size = [&](size_t l, size_t r) {
+          if (keep_diagonal && (l == i || r == i)) {
+            return l == i && r != i;
+          }
+          return std::abs(work[l]) > std::abs(work[r]);
+        };
+        size_t limit = fill + (keep_diagonal ? 1 : 0);
+        if (cols.size() > limit) {
+          std::nth_element(cols.begin(), cols.begin() + limit, cols.end(), by_size);
+          for (size_t c = limit; c < cols.size(); ++c) {
+            work[cols[c]] = Scalar();
+            nonzero[cols[c]] = false;
+          }
+          cols.resize(limit);
+        }
+        std::sort(cols.begin(), cols.end());
+      };
+      select(kept, false);
+      select(upper, true);
+
+      for (size_t j : kept) {
+        lu_ja.push_back(j);
+        lu_a.push_back(work[j]);
+      }
+      lu_diag[i] = lu_ja.size();
+      for (size_t j : upper) {
+        lu_ja.push_back(j);
+        lu_a.push_back(work[j]);
+      }
+      // A zero pivot would stop the next rows, it is replaced by the drop tolerance
+      if (lu_a[lu_diag[i]] == Scalar()) {
+        lu_a[lu_diag[i]] = drop > 0 ? Scalar(drop) : Scalar(1);
+      }
+      lu_ia.push_back(lu_ja.size());
+
+      for (size_t p = lu_ia[i]; p < lu_ia[i + 1]; ++p) {
+        work[lu_ja[p]] = Scalar();
+        nonzero[lu_ja[p]] = false;
+      }
+    }
+  }
+} } } // namespace fe::la::details
+
+#endif // INCOMPLETE_FACTORIZATION_KERNELS_HPP_
@@ -0,0 +1,118 @@
+#ifndef LEVEL_SCHEDULE_HPP_
+#define LEVEL_SCHEDULE_HPP_
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+#include "../threads.hpp"
+
+// Level scheduling (wavefronts) of sparse triangular solves.
+// Row i of L x = b depends on the rows j < i with l_ij != 0, its level is one more
+//   than the highest level among them. Rows of one level are independent and are
+//   solved in parallel, each by exactly the same operations as in the serial solve,
+//   so the results do not depend on the number of threads.
+
+namespace fe { namespace la { namespace details {
+  // Levels smaller than this many rows per thread are solved by the calling thread
+  size_t const LEVEL_MIN_ROWS = 256;
+
+  // Rows grouped by level: level l is rows[offsets[l]] ... rows[offsets[l + 1] - 1]
+  struct level_schedule {
+    std::vector<size_t> rows;
+    std::vector<size_t> offsets;
+
+    size_t levels() const {
+      return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+  };
+
+  // Sorts rows by level (counting sort, rows of a level stay in increasing order)
+  inline void group_by_level(std::vector<size_t> const & level, size_t level_count, level_schedule & schedule) {
+    schedule.offsets.assign(level_count + 1, 0);
+    for (size_t i = 0; i < level.size(); ++i) {
+      ++schedule.offsets[level[i] + 1];
+    }
+    for (size_t l = 0; l < level_count; ++l) {
+      schedule.offsets[l + 1] += schedule.offsets[l];
+    }
+
+    schedule.rows.resize(level.size());
+    std::vector<size_t> next(schedule.offsets.begin(), schedule.offsets.end() - 1);
+    for (size_t i = 0; i < level.size(); ++i) {
+      schedule.rows[next[level[i]]++] = i;
+    }
+  }
+
+  // Levels of the strictly lower part of L + U in compressed row form (diag[i] is the
+  //   position of the diagonal of row i, elements before it are in L)
+  inline void lower_level_schedule(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      std::vector<size_t> const & diag, level_schedule & schedule) {
+    std::vector<size_t> level(n, 0);
+    size_t level_count = n > 0 ? 1 : 0;
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t p = ia[i]; p < diag[i]; ++p) {
+        level[i] = std::max(level[i], level[ja[p]] + 1);
+      }
+      level_count = std::max(level_count, level[i] + 1);
+    }
+
+    group_by_level(level, level_count, schedule);
+  }
+
+  // Levels of the strictly upper part, rows depend on rows after them
+  inline void upper_level_schedule(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      std::vector<size_t> const & diag, level_schedule & schedule) {
+    std::vector<size_t> level(n, 0);
+    size_t level_count = n > 0 ? 1 : 0;
+    for (size_t i = n; i-- > 0;) {
+      for (size_t p = diag[i] + 1; p < ia[i + 1]; ++p) {
+        level[i] = std::max(level[i], level[ja[p]] + 1);
+      }
+      level_count = std::max(level_count, level[i] + 1);
+    }
+
+    group_by_level(level, level_count, schedule);
+  }
+
+  // Calls solve_row(i) for every row, level by level, rows of large levels in parallel
+  template<class SolveRow>
+  void for_each_row_by_levels(level_schedule const & schedule, SolveRow const & solve_row) {
+    size_t const * rows = schedule.rows.data();
+    for (size_t l = 0; l < schedule.levels(); ++l) {
+      size_t first = schedule.offsets[l];
+      size_t size = schedule.offsets[l + 1] - first;
+
+      // parallel_chunks runs small levels serially without waking the pool
+      parallel_chunks(size, LEVEL_MIN_ROWS, 1, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+          solve_row(rows[first + k]);
+        }
+      });
+    }
+  }
+
+  // Same as lu_solve_inplace (sparse_lu_kernels.hpp) with rows of every level solved in parallel
+  template<class Scalar>
+  void lu_solve_levels(std::vector<size_t> const & lu_ia, std::vector<size_t> const & lu_ja,
+      std::vector<size_t> const & lu_diag, Scalar const * lu_a,
+      level_schedule const & lower, level_schedule const & upper, Scalar * x) {
+    for_each_row_by_levels(lower, [&](size_t i) {
+      Scalar sum = x[i];
+      for (size_t p = lu_ia[i]; p < lu_diag[i]; ++p) {
+        sum -= lu_a[p] * x[lu_ja[p]];
+      }
+      x[i] = sum;
+    });
+
+    for_each_row_by_levels(upper, [&](size_t i) {
+      Scalar sum = x[i];
+      for (size_t p = lu_diag[i] + 1; p < lu_ia[i + 1]; ++p) {
+        sum -= lu_a[p] * x[lu_ja[p]];
+      }
+      x[i] = sum / lu_a[lu_diag[i]];
+    });
+  }
+} } } // namespace fe::la::details
+
+#endif // LEVEL_SCHEDULE_HPP_
@@ -0,0 +1,182 @@
+#ifndef MATRIX_EXPRESSION_HPP_
+#define MATRIX_EXPRESSION_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+
+// Expression templates for element-wise arithmetic on dense matrices and vectors.
+// An expression like a * x + b * y - z builds a tree of lightweight objects,
+//   which is evaluated in a single loop when assigned to a dense_matrix or dense_vector.
+// Expressions keep references to the matrices they are built from, so they
+//   must not outlive them (don't store them in auto variables).
+
+namespace fe { namespace la {
+  template<class Scalar, class Storage>
+  class dense_matrix;
+
+  namespace details {
+    // Base of dense_matrix and of all expression nodes
+    template<class Derived>
+    struct matrix_expression {
+      Derived const & self() const {
+        return static_cast<Derived const &>(*this);
+      }
+    };
+
+    // True for expression nodes, false for the matrices they are built of
+    template<class Expr>
+    struct is_expression_node : std::true_type {
+    };
+
+    template<class Scalar, class Storage>
+    struct is_expression_node<dense_matrix<Scalar, Storage>> : std::false_type {
+    };
+
+    // Expression nodes are stored by value, matrices by reference
+    template<class Expr>
+    struct expression_traits {
+      typedef Expr operand_t;
+      typedef typename Expr::scalar_t scalar_t;
+
+      static scalar_t at(Expr const & expr, size_t i) {
+        return expr[i];
+      }
+    };
+
+    template<class Scalar, class Storage>
+    struct expression_traits<dense_matrix<Scalar, Storage>> {
+      typedef dense_matrix<Scalar, Storage> const & operand_t;
+      typedef Scalar scalar_t;
+
+      static Scalar at(dense_matrix<Scalar, Storage> const & matrix, size_t i) {
+        return matrix.data()[i];
+      }
+    };
+
+    struct plus_op {
+      template<class Scalar>
+      static Scalar apply(Scalar const & lhs, Scalar const & rhs) {
+        return lhs + rhs;
+      }
+    };
+
+    struct minus_op {
+      template<class Scalar>
+      static Scalar apply(Scalar const & lhs, Scalar const & rhs) {
+        return lhs - rhs;
+      }
+    };
+
+    // Element-wise lhs op rhs
+    template<class Lhs, class Rhs, class Op>
+    class binary_expression : public matrix_expression<binary_expression<Lhs, Rhs, Op>> {
+      public:
+        typedef typename expression_traits<Lhs>::scalar_t scalar_t;
+
+        binary_expression(Lhs const & lhs, Rhs const & rhs)
+            : lhs_(lhs), rhs_(rhs) {
+          assert(lhs.dim1() == rhs.dim1() && lhs.dim2() == rhs.dim2());
+        }
+
+        size_t dim1() const {
+          return lhs_.dim1();
+        }
+
+        size_t dim2() const {
+          return lhs_.dim2();
+        }
+
+        scalar_t operator [] (size_t i) const {
+          return Op::apply(expression_traits<Lhs>::at(lhs_, i), expression_traits<Rhs>::at(rhs_, i));
+        }
+      private:
+        typename expression_traits<Lhs>::operand_t lhs_;
+        typename expression_traits<Rhs>::operand_t rhs_;
+    };
+
+    // Element-wise alpha * expr
+    template<class Expr>
+    class scaled_expression : public matrix_expression<scaled_expression<Expr>> {
+      public:
+        typedef typename expression_traits<Expr>::scalar_t scalar_t;
+
+        scaled_expression(scalar_t alpha, Expr const & expr)
+            : alpha_(alpha), expr_(expr) {
+        }
+
+        size_t dim1() const {
+          return expr_.dim1();
+        }
+
+        size_t dim2() const {
+          return expr_.dim2();
+        }
+
+        scalar_t operator [] (size_t i) const {
+          return alpha_ * expression_traits<Expr>::at(expr_, i);
+        }
+      private:
+        scalar_t alpha_;
+        typename expression_traits<Expr>::operand_t expr_;
+    };
+
+    // Evaluates dst[i] = expr[i] for all elements in one pass.
+    // Every element only depends on the same elements of operands,
+    //   so dst may be used in expr.
+    template<class Scalar, class Expr>
+    void assign_expression(Scalar * dst, size_t size, Expr const & expr) {
+      for (size_t i = 0; i < size; ++i) {
+        dst[i] = expression_traits<Expr>::at(expr, i);
+      }
+    }
+
+    template<class Scalar, class Expr>
+    void add_expression(Scalar * dst, size_t size, Expr const & expr) {
+      for (size_t i = 0; i < size; ++i) {
+        dst[i] += expression_traits<Expr>::at(expr, i);
+      }
+    }
+
+    template<class Scalar, class Expr>
+    void subtract_expression(Scalar * dst, size_t size, Expr const & expr) {
+      for (size_t i = 0; i < size; ++i) {
+        dst[i] -= expression_traits<Expr>::at(expr, i);
+      }
+    }
+  } // namespace details
+
+  template<class Lhs, class Rhs>
+  details::binary_expression<Lhs, Rhs, details::plus_op>
+      operator + (details::matrix_expression<Lhs> const & lhs, details::matrix_expression<Rhs> const & rhs) {
+    return {lhs.self(), rhs.self()};
+  }
+
+  template<class Lhs, class Rhs>
+  details::binary_expression<Lhs, Rhs, details::minus_op>
+      operator - (details::matrix_expression<Lhs> const & lhs, details::matrix_expression<Rhs> const & rhs) {
+    return {lhs.self(), rhs.self()};
+  }
+
+  template<class Expr>
+  details::scaled_expression<Expr> operator * (
+      typename details::expression_traits<Expr>::scalar_t alpha,
+      details::matrix_expression<Expr> const & expr) {
+    return {alpha, expr.self()};
+  }
+
+  template<class Expr>
+  details::scaled_expression<Expr> operator * (
+      details::matrix_expression<Expr> const & expr,
+      typename details::expression_traits<Expr>::scalar_t alpha) {
+    return {alpha, expr.self()};
+  }
+
+  template<class Expr>
+  details::scaled_expression<Expr> operator - (details::matrix_expression<Expr> const & expr) {
+    typedef typename details::expression_traits<Expr>::scalar_t scalar_t;
+    return {scalar_t(-1), expr.self()};
+  }
+} } // namespace fe::la
+
+#endif // MATRIX_EXPRESSION_HPP_
@@ -0,0 +1,92 @@
+#ifndef NONNULL_ELEMENTS_HPP_
+#define NONNULL_ELEMENTS_HPP_
+
+#include <cstddef>
+
+namespace fe { namespace la {
+  template<class Scalar, class Storage>
+  class dense_matrix;
+
+  template<class Scalar, class Storage>
+  class symmetric_compressed_row_matrix;
+
+  template<class Scalar, class Storage>
+  class sliced_ell_matrix;
+
+  template<class Scalar, class Storage, size_t B>
+  class block_compressed_row_matrix;
+
+  namespace details {
+    // Calls f(i, j, value) for every non-null element of a sparse matrix, row by row
+    template<class Matrix, class F>
+    void for_each_nonnull(Matrix const & matrix, F f) {
+      for (size_t i = 0; i < matrix.dim1(); ++i) {
+        auto iter_end = matrix.nnrow_cend(i);
+        for (auto iter = matrix.nnrow_cbegin(i); iter != iter_end; ++iter) {
+          f(i, iter.index(), *iter);
+        }
+      }
+    }
+
+    // Dense matrices have no non-null iterators, zeros are skipped by value
+    template<class Scalar, class Storage, class F>
+    void for_each_nonnull(dense_matrix<Scalar, Storage> const & matrix, F f) {
+      for (size_t i = 0; i < matrix.dim1(); ++i) {
+        for (size_t j = 0; j < matrix.dim2(); ++j) {
+          if (matrix(i, j) != Scalar()) {
+            f(i, j, matrix(i, j));
+          }
+        }
+      }
+    }
+
+    // Symmetric matrices report the stored lower triangle and its mirror above the diagonal
+    template<class Scalar, class Storage, class F>
+    void for_each_nonnull(symmetric_compressed_row_matrix<Scalar, Storage> const & matrix, F f) {
+      auto const & ia = matrix.row_offsets();
+      auto const & ja = matrix.column_indices();
+      auto const & a = matrix.data();
+      for (size_t i = 0; i < matrix.dim1(); ++i) {
+        for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+          f(i, ja[p], a[p]);
+          if (ja[p] != i) {
+            f(ja[p], i, a[p]);
+          }
+        }
+      }
+    }
+
+    // Sliced ELLPACK matrices report rows in their stored order, without the padding
+    template<class Scalar, class Storage, class F>
+    void for_each_nonnull(sliced_ell_matrix<Scalar, Storage> const & matrix, F f) {
+      size_t chunk = matrix.chunk_size();
+      auto const & chunk_ptr = matrix.chunk_offsets();
+      auto const & col = matrix.column_indices();
+      auto const & a = matrix.data();
+      for (size_t pos = 0; pos < matrix.dim1(); ++pos) {
+        size_t first = chunk_ptr[pos / chunk] + pos % chunk;
+        for (size_t k = 0; k < matrix.row_lengths()[pos]; ++k) {
+          f(matrix.row_order()[pos], col[first + k * chunk], a[first + k * chunk]);
+        }
+      }
+    }
+
+    // Block matrices report every element of the stored blocks, row by row
+    template<class Scalar, class Storage, size_t B, class F>
+    void for_each_nonnull(block_compressed_row_matrix<Scalar, Storage, B> const & matrix, F f) {
+      auto const & ia = matrix.row_offsets();
+      auto const & ja = matrix.column_indices();
+      auto const & a = matrix.data();
+      for (size_t i = 0; i < matrix.dim1(); ++i) {
+        size_t bi = i / B;
+        for (size_t q = ia[bi]; q < ia[bi + 1]; ++q) {
+          for (size_t c = 0; c < B; ++c) {
+            f(i, ja[q] * B + c, a[q * B * B + (i % B) * B + c]);
+          }
+        }
+      }
+    }
+  } // namespace details
+} } // namespace fe::la
+
+#endif // NONNULL_ELEMENTS_HPP_
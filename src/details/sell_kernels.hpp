@@ -0,0 +1,169 @@
+#ifndef SELL_KERNELS_HPP_
+#define SELL_KERNELS_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+#include "simd_dispatch.hpp"
+#include "sparse_matrix_vector_product.hpp"
+
+// Products of a matrix in SELL-C-sigma form (sliced_ell_matrix.hpp) by a vector.
+// Chunk c holds rows row_order[c * C] ... row_order[c * C + C - 1] padded to the length
+//   of the longest of them and stored column by column: element k of the chunk row r is
+//   at chunk_ptr[c] + k * C + r. A SIMD lane computes one row, so C rows go at once.
+
+namespace fe { namespace la { namespace details {
+  // Largest supported chunk size
+  size_t const SELL_MAX_CHUNK = 64;
+
+  // y[row_order[r]] = alpha * acc[r] + beta * y[row_order[r]] for count rows of a chunk
+  template<class Scalar>
+  void sell_store_chunk(size_t count, Scalar const * acc, size_t const * row_order, Scalar * y,
+      Scalar alpha, Scalar beta) {
+    for (size_t r = 0; r < count; ++r) {
+      Scalar & res = y[row_order[r]];
+      res = beta == Scalar() ? alpha * acc[r] : alpha * acc[r] + beta * res;
+    }
+  }
+
+  // y = alpha * A x + beta * y for the rows of chunks first ... last - 1 of A with dim1 rows
+  template<class Scalar>
+  void sell_prod_portable(size_t chunk, size_t first, size_t last, size_t dim1,
+      size_t const * chunk_ptr, size_t const * col, Scalar const * a, size_t const * row_order,
+      Scalar const * x, Scalar * y, Scalar alpha, Scalar beta) {
+    assert(chunk <= SELL_MAX_CHUNK);
+
+    Scalar acc[SELL_MAX_CHUNK];
+    for (size_t c = first; c < last; ++c) {
+      std::fill(acc, acc + chunk, Scalar());
+      for (size_t p = chunk_ptr[c]; p < chunk_ptr[c + 1]; p += chunk) {
+        for (size_t r = 0; r < chunk; ++r) {
+          acc[r] += a[p + r] * x[col[p + r]];
+        }
+      }
+      sell_store_chunk(std::min(chunk, dim1 - c * chunk), acc, row_order + c * chunk, y, alpha, beta);
+    }
+  }
+
+#ifdef FE_LA_X86_SIMD
+  // Column indices are gathered as 64-bit integers, so these kernels need a 64-bit size_t
+
+  __attribute__((target("avx2,fma")))
+  inline void sell4_prod_avx2(size_t first, size_t last, size_t dim1,
+      size_t const * chunk_ptr, size_t const * col, double const * a, size_t const * row_order,
+      double const * x, double * y, double alpha, double beta) {
+    double acc[4];
+    for (size_t c = first; c < last; ++c) {
+      __m256d s0 = _mm256_setzero_pd();
+      __m256d s1 = _mm256_setzero_pd();
+      size_t p = chunk_ptr[c];
+      size_t end = chunk_ptr[c + 1];
+      for (; p + 8 <= end; p += 8) {
+        __m256i i0 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(col + p));
+        __m256i i1 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(col + p + 4));
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + p), _mm256_i64gather_pd(x, i0, 8), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + p + 4), _mm256_i64gather_pd(x, i1, 8), s1);
+      }
+      if (p < end) {
+        __m256i i0 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(col + p));
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + p), _mm256_i64gather_pd(x, i0, 8), s0);
+      }
+      _mm256_storeu_pd(acc, _mm256_add_pd(s0, s1));
+      sell_store_chunk(std::min<size_t>(4, dim1 - c * 4), acc, row_order + c * 4, y, alpha, beta);
+    }
+  }
+
+  __attribute__((target("avx2,fma")))
+  inline void sell8_prod_avx2(size_t first, size_t last, size_t dim1,
+      size_t const * chunk_ptr, size_t const * col, double const * a, size_t const * row_order,
+      double const * x, double * y, double alpha, double beta) {
+    double acc[8];
+    for (size_t c = first; c < last; ++c) {
+      __m256d s0 = _mm256_setzero_pd();
+      __m256d s1 = _mm256_setzero_pd();
+      for (size_t p = chunk_ptr[c]; p < chunk_ptr[c + 1]; p += 8) {
+        __m256i i0 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(col + p));
+        __m256i i1 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(col + p + 4));
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + p), _mm256_i64gather_pd(x, i0, 8), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + p + 4), _mm256_i64gather_pd(x, i1, 8), s1);
+      }
+      _mm256_storeu_pd(acc, s0);
+      _mm256_storeu_pd(acc + 4, s1);
+      sell_store_chunk(std::min<size_t>(8, dim1 - c * 8), acc, row_order + c * 8, y, alpha, beta);
+    }
+  }
+
+  __attribute__((target("avx512f")))
+  inline void sell8_prod_avx512(size_t first, size_t last, size_t dim1,
+      size_t const * chunk_ptr, size_t const * col, double const * a, size_t const * row_order,
+      double const * x, double * y, double alpha, double beta) {
+    double acc[8];
+    // Gathers are masked with all lanes set, GCC warns about the source of the unmasked form
+    __m512d const zero = _mm512_setzero_pd();
+    for (size_t c = first; c < last; ++c) {
+      __m512d s0 = _mm512_setzero_pd();
+      __m512d s1 = _mm512_setzero_pd();
+      size_t p = chunk_ptr[c];
+      size_t end = chunk_ptr[c + 1];
+      for (; p + 16 <= end; p += 16) {
+        __m512i i0 = _mm512_loadu_si512(col + p);
+        __m512i i1 = _mm512_loadu_si512(col + p + 8);
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + p), _mm512_mask_i64gather_pd(zero, 0xFF, i0, x, 8), s0);
+        s1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + p + 8), _mm512_mask_i64gather_pd(zero, 0xFF, i1, x, 8), s1);
+      }
+      if (p < end) {
+        __m512i i0 = _mm512_loadu_si512(col + p);
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + p), _mm512_mask_i64gather_pd(zero, 0xFF, i0, x, 8), s0);
+      }
+      _mm512_storeu_pd(acc, _mm512_add_pd(s0, s1));
+      sell_store_chunk(std::min<size_t>(8, dim1 - c * 8), acc, row_order + c * 8, y, alpha, beta);
+    }
+  }
+#endif
+
+  // Dispatching kernel, SIMD versions exist for double and chunk sizes 4 and 8
+  template<class Scalar>
+  void sell_prod_chunks(size_t chunk, size_t first, size_t last, size_t dim1,
+      size_t const * chunk_ptr, size_t const * col, Scalar const * a, size_t const * row_order,
+      Scalar const * x, Scalar * y, Scalar alpha, Scalar beta) {
+    sell_prod_portable(chunk, first, last, dim1, chunk_ptr, col, a, row_order, x, y, alpha, beta);
+  }
+
+  inline void sell_prod_chunks(size_t chunk, size_t first, size_t last, size_t dim1,
+      size_t const * chunk_ptr, size_t const * col, double const * a, size_t const * row_order,
+      double const * x, double * y, double alpha, double beta) {
+#ifdef FE_LA_X86_SIMD
+    if (sizeof(size_t) == 8 && (chunk == 4 || chunk == 8)) {
+      switch (cpu_simd_level()) {
+        case simd_level::AVX512:
+          if (chunk == 8) {
+            return sell8_prod_avx512(first, last, dim1, chunk_ptr, col, a, row_order, x, y, alpha, beta);
+          }
+          return sell4_prod_avx2(first, last, dim1, chunk_ptr, col, a, row_order, x, y, alpha, beta);
+        case simd_level::AVX2:
+          if (chunk == 8) {
+            return sell8_prod_avx2(first, last, dim1, chunk_ptr, col, a, row_order, x, y, alpha, beta);
+          }
+          return sell4_prod_avx2(first, last, dim1, chunk_ptr, col, a, row_order, x, y, alpha, beta);
+        default: break;
+      }
+    }
+#endif
+    sell_prod_portable(chunk, first, last, dim1, chunk_ptr, col, a, row_order, x, y, alpha, beta);
+  }
+
+  // The product for all chunks, consecutive parts of the chunk partition are given to every thread
+  template<class Scalar>
+  void sell_prod(size_t chunk, size_t dim1, std::vector<size_t> const & partition,
+      std::vector<size_t> const & chunk_ptr, std::vector<size_t> const & col, Scalar const * a,
+      std::vector<size_t> const & row_order, Scalar const * x, Scalar * y, Scalar alpha, Scalar beta) {
+    parallel_chunks(partition.size() - 1, SPMV_MIN_PARTS, 1, [&](size_t first, size_t last) {
+      sell_prod_chunks(chunk, partition[first], partition[last], dim1, chunk_ptr.data(), col.data(), a,
+          row_order.data(), x, y, alpha, beta);
+    });
+  }
+} } } // namespace fe::la::details
+
+#endif // SELL_KERNELS_HPP_
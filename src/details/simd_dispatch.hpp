@@ -0,0 +1,40 @@
+#ifndef SIMD_DISPATCH_HPP_
+#define SIMD_DISPATCH_HPP_
+
+// SIMD kernels are compiled with per-function target attributes, so the rest
+// of the code does not need any special compiler flags. They are only
+// available with gcc-compatible compilers on x86. Define FE_LA_NO_SIMD to
+// always use portable kernels.
+#if !defined(FE_LA_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FE_LA_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace fe { namespace la { namespace details {
+  enum class simd_level {
+    PORTABLE,
+    AVX2,
+    AVX512
+  };
+
+  inline simd_level detect_simd_level() {
+#ifdef FE_LA_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return simd_level::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return simd_level::AVX2;
+    }
+#endif
+    return simd_level::PORTABLE;
+  }
+
+  // The instruction set of the running cpu, detected once per process
+  inline simd_level cpu_simd_level() {
+    static simd_level const level = detect_simd_level();
+    return level;
+  }
+} } } // namespace fe::la::details
+
+#endif // SIMD_DISPATCH_HPP_
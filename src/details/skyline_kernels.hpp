@@ -0,0 +1,110 @@
+#ifndef SKYLINE_KERNELS_HPP_
+#define SKYLINE_KERNELS_HPP_
+
+#include <cstddef>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <algorithm>
+
+#include "blas1_kernels.hpp"
+
+// Factorizations and solves of symmetric matrices in skyline form:
+//   row i holds columns first(i) ... i in a[ia[i]] ... a[ia[i + 1] - 1], first(i) = i + 1 - (ia[i + 1] - ia[i]).
+// Both factorizations work row by row (Crout): row i only needs rows before it,
+//   and every inner product runs over the overlap of two contiguous rows.
+
+namespace fe { namespace la { namespace details {
+  inline size_t skyline_first(std::vector<size_t> const & ia, size_t i) {
+    return i + ia[i] + 1 - ia[i + 1];
+  }
+
+  // A = L D L^T in place: L (unit diagonal) below the diagonal, D on it
+  template<class Scalar>
+  void skyline_ldlt(size_t n, std::vector<size_t> const & ia, Scalar * a) {
+    for (size_t i = 0; i < n; ++i) {
+      size_t first_i = skyline_first(ia, i);
+      Scalar * row_i = a + ia[i];
+
+      // row_i[j] becomes g_ij = l_ij * d_j for now
+      for (size_t j = first_i; j < i; ++j) {
+        size_t first_j = skyline_first(ia, j);
+        size_t k0 = std::max(first_i, first_j);
+        Scalar const * row_j = a + ia[j];
+
+        row_i[j - first_i] -= dot_kernel(j - k0, row_i + (k0 - first_i), row_j + (k0 - first_j));
+      }
+
+      Scalar d = row_i[i - first_i];
+      for (size_t j = first_i; j < i; ++j) {
+        Scalar g_ij = row_i[j - first_i];
+        Scalar l_ij = g_ij / a[ia[j + 1] - 1];
+        d -= g_ij * l_ij;
+        row_i[j - first_i] = l_ij;
+      }
+      row_i[i - first_i] = d;
+    }
+  }
+
+  // A = L L^T in place, L stored on and below the diagonal
+  template<class Scalar>
+  void skyline_cholesky(size_t n, std::vector<size_t> const & ia, Scalar * a) {
+    for (size_t i = 0; i < n; ++i) {
+      size_t first_i = skyline_first(ia, i);
+      Scalar * row_i = a + ia[i];
+
+      for (size_t j = first_i; j < i; ++j) {
+        size_t first_j = skyline_first(ia, j);
+        size_t k0 = std::max(first_i, first_j);
+        Scalar const * row_j = a + ia[j];
+
+        Scalar s = row_i[j - first_i] - dot_kernel(j - k0, row_i + (k0 - first_i), row_j + (k0 - first_j));
+        row_i[j - first_i] = s / a[ia[j + 1] - 1];
+      }
+
+      Scalar d = row_i[i - first_i] - dot_kernel(i - first_i, row_i, row_i);
+      row_i[i - first_i] = std::sqrt(d);
+    }
+  }
+
+  // Solves L y = b by rows, the diagonal of L is one if unit_diagonal, stored otherwise
+  template<class Scalar>
+  void skyline_lower_solve(size_t n, std::vector<size_t> const & ia, Scalar const * a, Scalar * x,
+      bool unit_diagonal) {
+    for (size_t i = 0; i < n; ++i) {
+      size_t first_i = skyline_first(ia, i);
+      Scalar s = x[i] - dot_kernel(i - first_i, a + ia[i], x + first_i);
+      x[i] = unit_diagonal ? s : s / a[ia[i + 1] - 1];
+    }
+  }
+
+  // Solves L^T x = y by columns of L^T, which are the stored rows of L
+  template<class Scalar>
+  void skyline_upper_solve(size_t n, std::vector<size_t> const & ia, Scalar const * a, Scalar * x,
+      bool unit_diagonal) {
+    for (size_t i = n; i-- > 0;) {
+      size_t first_i = skyline_first(ia, i);
+      if (!unit_diagonal) {
+        x[i] /= a[ia[i + 1] - 1];
+      }
+      axpy_kernel(i - first_i, -x[i], a + ia[i], x + first_i);
+    }
+  }
+
+  template<class Scalar>
+  void skyline_ldlt_solve(size_t n, std::vector<size_t> const & ia, Scalar const * a, Scalar * x) {
+    skyline_lower_solve(n, ia, a, x, true);
+    for (size_t i = 0; i < n; ++i) {
+      x[i] /= a[ia[i + 1] - 1];
+    }
+    skyline_upper_solve(n, ia, a, x, true);
+  }
+
+  template<class Scalar>
+  void skyline_cholesky_solve(size_t n, std::vector<size_t> const & ia, Scalar const * a, Scalar * x) {
+    skyline_lower_solve(n, ia, a, x, false);
+    skyline_upper_solve(n, ia, a, x, false);
+  }
+} } } // namespace fe::la::details
+
+#endif // SKYLINE_KERNELS_HPP_
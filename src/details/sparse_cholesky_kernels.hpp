@@ -0,0 +1,153 @@
+#ifndef SPARSE_CHOLESKY_KERNELS_HPP_
+#define SPARSE_CHOLESKY_KERNELS_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "triangular_solve.hpp"
+
+// Kernels of the up-looking sparse Cholesky decomposition (as in CSparse).
+// The input is the lower triangle of a symmetric matrix by rows (ia, ja),
+//   which is the upper triangle by columns.
+// Row i of L is computed from row i of A by a sparse triangular solve with
+//   the first i rows of L; its pattern is the set of vertices reached from
+//   the elements of row i of A in the elimination tree.
+// L is stored by columns (lp, li, lx) with the diagonal first in every column.
+
+namespace fe { namespace la { namespace details {
+  size_t const ETREE_ROOT = size_t(-1);
+
+  // Elimination tree: parent[k] is the row of the first element below the diagonal
+  //   in column k of L, ETREE_ROOT if there is none
+  inline void elimination_tree(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      std::vector<size_t> & parent) {
+    parent.assign(n, ETREE_ROOT);
+    // Path-compressed ancestors
+    std::vector<size_t> ancestor(n, ETREE_ROOT);
+
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        // Walk from column j up to the root of its current subtree, attaching it to i
+        for (size_t k = ja[p]; k != ETREE_ROOT && k < i;) {
+          size_t next = ancestor[k];
+          ancestor[k] = i;
+          if (next == ETREE_ROOT) {
+            parent[k] = i;
+          }
+          k = next;
+        }
+      }
+    }
+  }
+
+  // Pattern of row i of L without the diagonal, in topological order of the
+  //   elimination tree: stack[top] ... stack[n - 1]. Returns top.
+  // marker[k] == i marks visited columns, it must not be i for any k on entry.
+  inline size_t elimination_reach(size_t i, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      std::vector<size_t> const & parent, std::vector<size_t> & marker, std::vector<size_t> & stack) {
+    size_t n = parent.size();
+    size_t top = n;
+    marker[i] = i;
+
+    for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+      // Path from ja[p] up to the first visited vertex, then pushed reversed
+      size_t len = 0;
+      for (size_t k = ja[p]; marker[k] != i; k = parent[k]) {
+        stack[len++] = k;
+        marker[k] = i;
+      }
+      while (len > 0) {
+        stack[--top] = stack[--len];
+      }
+    }
+
+    return top;
+  }
+
+  // Column pointers of L (including diagonals) for the pattern of A
+  inline void cholesky_symbolic(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      std::vector<size_t> const & parent, std::vector<size_t> & lp) {
+    std::vector<size_t> marker(n, ETREE_ROOT);
+    std::vector<size_t> stack(n);
+
+    lp.assign(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+      size_t top = elimination_reach(i, ia, ja, parent, marker, stack);
+      for (size_t t = top; t < n; ++t) {
+        ++lp[stack[t] + 1];
+      }
+      ++lp[i + 1];
+    }
+    for (size_t k = 0; k < n; ++k) {
+      lp[k + 1] += lp[k];
+    }
+  }
+
+  /**
+   * Numeric factorization into preallocated L: A = L L^T if ldlt is false,
+   * A = L D L^T with unit diagonal L and D on the diagonal of L otherwise.
+   * work is a buffer of n zeros and is left zero, marker, stack and next have size n.
+   */
+  template<class Scalar>
+  void cholesky_numeric(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      Scalar const * a, std::vector<size_t> const & parent, std::vector<size_t> const & lp,
+      std::vector<size_t> & li, Scalar * lx, bool ldlt,
+      Scalar * work, std::vector<size_t> & marker, std::vector<size_t> & stack, std::vector<size_t> & next) {
+    std::fill(marker.begin(), marker.end(), ETREE_ROOT);
+    for (size_t k = 0; k < n; ++k) {
+      next[k] = lp[k] + 1;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      size_t top = elimination_reach(i, ia, ja, parent, marker, stack);
+
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        work[ja[p]] = a[p];
+      }
+      Scalar d = work[i];
+      work[i] = Scalar();
+
+      for (size_t t = top; t < n; ++t) {
+        size_t k = stack[t];
+        Scalar y_k = work[k];
+        work[k] = Scalar();
+
+        // Forward substitution with L (unit L for L D L^T, where y_k = d_k * l_ik)
+        Scalar l_ik = y_k / lx[lp[k]];
+        Scalar x_k = ldlt ? y_k : l_ik;
+
+        // Column k holds rows below k computed so far, all of them before i
+        for (size_t p = lp[k] + 1; p < next[k]; ++p) {
+          work[li[p]] -= lx[p] * x_k;
+        }
+
+        d -= l_ik * x_k;
+
+        size_t p = next[k]++;
+        li[p] = i;
+        lx[p] = l_ik;
+      }
+
+      li[lp[i]] = i;
+      lx[lp[i]] = ldlt ? d : std::sqrt(d);
+    }
+  }
+
+  // Solves L L^T x = b or L D L^T x = b in place
+  template<class Scalar>
+  void cholesky_solve_inplace(size_t n, std::vector<size_t> const & lp, std::vector<size_t> const & li,
+      Scalar const * lx, bool ldlt, Scalar * x) {
+    csc_lower_solve(n, lp, li, lx, x, ldlt);
+    if (ldlt) {
+      for (size_t k = 0; k < n; ++k) {
+        x[k] /= lx[lp[k]];
+      }
+    }
+    csc_lower_transpose_solve(n, lp, li, lx, x, ldlt);
+  }
+} } } // namespace fe::la::details
+
+#endif // SPARSE_CHOLESKY_KERNELS_HPP_
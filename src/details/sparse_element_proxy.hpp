@@ -30,7 +30,17 @@ namespace fe { namespace la { namespace details {
         if (value_ptr_) {
           *value_ptr_ = value;
         } else {
-          assert(value == 0);
+          assert(value == scalar_t());
+        }
+
+        return *this;
+      }
+
+      sparse_element_proxy & operator += (scalar_t value) {
+        if (value_ptr_) {
+          *value_ptr_ += value;
+        } else {
+          assert(value == scalar_t());
         }
 
         return *this;
@@ -40,7 +50,7 @@ namespace fe { namespace la { namespace details {
         if (value_ptr_) {
           *value_ptr_ -= value;
         } else {
-          assert(value == 0);
+          assert(value == scalar_t());
         }
 
         return *this;
@@ -0,0 +1,193 @@
+#ifndef SPARSE_LU_KERNELS_HPP_
+#define SPARSE_LU_KERNELS_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <algorithm>
+
+#include "triangular_solve.hpp"
+
+// Kernels of the LU decomposition without pivoting of a matrix in compressed
+// row form. The factorization is split in two phases:
+//   symbolic - computes the pattern of L + U including all fill-in,
+//   numeric - computes values of L and U inside that pattern.
+// L has unit diagonal and is stored below the diagonal, U on and above it,
+// exactly like in the in-place dense lu_decomposition.
+
+namespace fe { namespace la { namespace details {
+  /**
+   * Computes the pattern of L + U for a square matrix with pattern (ia, ja).
+   * Row i of L + U is the pattern of row i of A plus the diagonal, plus, for
+   * every k < i in row i of L (in increasing order), columns of row k of U.
+   *
+   * @param lu_diag receives positions of diagonal elements in lu_ja.
+   */
+  inline void lu_symbolic(size_t n,
+      std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      std::vector<size_t> & lu_ia, std::vector<size_t> & lu_ja, std::vector<size_t> & lu_diag) {
+    assert(ia.size() == n + 1);
+
+    lu_ia.assign(n + 1, 0);
+    lu_ja.clear();
+    lu_diag.assign(n, 0);
+
+    // marker[j] == i means column j is already in row i
+    std::vector<size_t> marker(n, n);
+    // Columns of L in the current row not yet merged, smallest first
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> lower;
+    std::vector<size_t> row;
+
+    for (size_t i = 0; i < n; ++i) {
+      row.clear();
+
+      auto add_column = [&](size_t j) {
+        if (marker[j] != i) {
+          marker[j] = i;
+          row.push_back(j);
+          if (j < i) {
+            lower.push(j);
+          }
+        }
+      };
+
+      add_column(i);
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        add_column(ja[p]);
+      }
+
+      while (!lower.empty()) {
+        size_t k = lower.top();
+        lower.pop();
+
+        // Columns of row k of U, they are right after its diagonal
+        for (size_t p = lu_diag[k] + 1; p < lu_ia[k + 1]; ++p) {
+          add_column(lu_ja[p]);
+        }
+      }
+
+      std::sort(row.begin(), row.end());
+
+      lu_diag[i] = lu_ja.size() + (std::lower_bound(row.begin(), row.end(), i) - row.begin());
+      lu_ja.insert(lu_ja.end(), row.begin(), row.end());
+      lu_ia[i + 1] = lu_ja.size();
+    }
+  }
+
+  // Positions in the L + U pattern of every element of A, so values of A can be
+  // copied to the factor without searching
+  inline void lu_scatter_map(size_t n,
+      std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      std::vector<size_t> const & lu_ia, std::vector<size_t> const & lu_ja,
+      std::vector<size_t> & map) {
+    map.resize(ia[n]);
+
+    for (size_t i = 0; i < n; ++i) {
+      // Both rows are sorted, so a merge finds all positions
+      size_t q = lu_ia[i];
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        while (lu_ja[q] != ja[p]) {
+          ++q;
+          assert(q < lu_ia[i + 1]);
+        }
+        map[p] = q;
+      }
+    }
+  }
+
+  /**
+   * Computes values of L and U in place. On entry lu_a holds values of A in the
+   * L + U pattern (zeros at fill-in positions).
+   *
+   * @param work A buffer of n zeros, it is left filled with zeros.
+   */
+  template<class Scalar>
+  void lu_numeric(size_t n,
+      std::vector<size_t> const & lu_ia, std::vector<size_t> const & lu_ja,
+      std::vector<size_t> const & lu_diag, Scalar * lu_a, Scalar * work) {
+    for (size_t i = 0; i < n; ++i) {
+      size_t row_begin = lu_ia[i];
+      size_t row_end = lu_ia[i + 1];
+
+      for (size_t p = row_begin; p < row_end; ++p) {
+        work[lu_ja[p]] = lu_a[p];
+      }
+
+      // Columns below the diagonal are sorted, so rows of U are applied
+      //   in the order of elimination
+      for (size_t p = row_begin; p < lu_diag[i]; ++p) {
+        size_t k = lu_ja[p];
+        Scalar l_ik = work[k] / lu_a[lu_diag[k]];
+        work[k] = l_ik;
+
+        for (size_t q = lu_diag[k] + 1; q < lu_ia[k + 1]; ++q) {
+          work[lu_ja[q]] -= l_ik * lu_a[q];
+        }
+      }
+
+      for (size_t p = row_begin; p < row_end; ++p) {
+        lu_a[p] = work[lu_ja[p]];
+        work[lu_ja[p]] = Scalar();
+      }
+    }
+  }
+
+  // Turns L U with U stored on and above the diagonal into L D U,
+  // where U has unit diagonal and D is stored on the diagonal
+  template<class Scalar>
+  void lu_to_ldu(size_t n,
+      std::vector<size_t> const & lu_ia, std::vector<size_t> const & lu_diag, Scalar * lu_a) {
+    for (size_t i = 0; i < n; ++i) {
+      Scalar d = lu_a[lu_diag[i]];
+      for (size_t p = lu_diag[i] + 1; p < lu_ia[i + 1]; ++p) {
+        lu_a[p] /= d;
+      }
+    }
+  }
+
+  // Solves L U x = b in place, x holds b on entry
+  template<class Scalar>
+  void lu_solve_inplace(size_t n,
+      std::vector<size_t> const & lu_ia, std::vector<size_t> const & lu_ja,
+      std::vector<size_t> const & lu_diag, Scalar const * lu_a, Scalar * x) {
+    // L has unit diagonal
+    for (size_t i = 0; i < n; ++i) {
+      Scalar sum = x[i];
+      for (size_t p = lu_ia[i]; p < lu_diag[i]; ++p) {
+        sum -= lu_a[p] * x[lu_ja[p]];
+      }
+      x[i] = sum;
+    }
+
+    for (size_t i = n; i-- > 0;) {
+      Scalar sum = x[i];
+      for (size_t p = lu_diag[i] + 1; p < lu_ia[i + 1]; ++p) {
+        sum -= lu_a[p] * x[lu_ja[p]];
+      }
+      x[i] = sum / lu_a[lu_diag[i]];
+    }
+  }
+
+  // Solves L U X = B in place for a row-major n x width block X with rows ldx apart
+  template<class Scalar>
+  void lu_solve_block(size_t n,
+      std::vector<size_t> const & lu_ia, std::vector<size_t> const & lu_ja,
+      std::vector<size_t> const & lu_diag, Scalar const * lu_a, Scalar * x, size_t ldx, size_t width) {
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t p = lu_ia[i]; p < lu_diag[i]; ++p) {
+        axpy_kernel(width, -lu_a[p], x + lu_ja[p] * ldx, x + i * ldx);
+      }
+    }
+
+    for (size_t i = n; i-- > 0;) {
+      for (size_t p = lu_diag[i] + 1; p < lu_ia[i + 1]; ++p) {
+        axpy_kernel(width, -lu_a[p], x + lu_ja[p] * ldx, x + i * ldx);
+      }
+      divide_row(width, lu_a[lu_diag[i]], x + i * ldx);
+    }
+  }
+} } } // namespace fe::la::details
+
+#endif // SPARSE_LU_KERNELS_HPP_
@@ -0,0 +1,98 @@
+#ifndef SPARSE_MATRIX_PRODUCT_HPP_
+#define SPARSE_MATRIX_PRODUCT_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+// Transpose and product of matrices given by compressed row arrays (ia, ja, a),
+//   the results have sorted columns in every row.
+
+namespace fe { namespace la { namespace details {
+  // B = A^T for a dim1 x dim2 matrix A, by counting the elements of every column
+  template<class Scalar, class Storage>
+  void csr_transpose(size_t dim1, size_t dim2,
+      std::vector<size_t> const & ia, std::vector<size_t> const & ja, Scalar const * a,
+      std::vector<size_t> & b_ia, std::vector<size_t> & b_ja, Storage & b_a) {
+    size_t nnz = ia[dim1];
+
+    b_ia.assign(dim2 + 1, 0);
+    for (size_t p = 0; p < nnz; ++p) {
+      ++b_ia[ja[p] + 1];
+    }
+    for (size_t j = 0; j < dim2; ++j) {
+      b_ia[j + 1] += b_ia[j];
+    }
+
+    b_ja.resize(nnz);
+    b_a.resize(nnz);
+    // Next free position of every row of B, rows of A are visited in order so columns come sorted
+    std::vector<size_t> next(b_ia.begin(), b_ia.end() - 1);
+    for (size_t i = 0; i < dim1; ++i) {
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        size_t q = next[ja[p]]++;
+        b_ja[q] = i;
+        b_a[q] = a[p];
+      }
+    }
+  }
+
+  /**
+   * C = A B for a dim1 x k matrix A and a k x dim2 matrix B (Gustavson's algorithm):
+   * row i of C is accumulated from the rows of B selected by row i of A.
+   */
+  template<class Scalar, class Storage>
+  void csr_multiply(size_t dim1, size_t dim2,
+      std::vector<size_t> const & a_ia, std::vector<size_t> const & a_ja, Scalar const * a,
+      std::vector<size_t> const & b_ia, std::vector<size_t> const & b_ja, Scalar const * b,
+      std::vector<size_t> & c_ia, std::vector<size_t> & c_ja, Storage & c_a) {
+    size_t const unset = size_t(-1);
+
+    c_ia.assign(1, 0);
+    c_ja.clear();
+    c_a.clear();
+
+    // Position of column j in the current row of C if it is not before row_begin
+    std::vector<size_t> pos(dim2, unset);
+    std::vector<std::pair<size_t, Scalar>> row;
+
+    for (size_t i = 0; i < dim1; ++i) {
+      size_t row_begin = c_ja.size();
+
+      for (size_t p = a_ia[i]; p < a_ia[i + 1]; ++p) {
+        size_t k = a_ja[p];
+        for (size_t q = b_ia[k]; q < b_ia[k + 1]; ++q) {
+          size_t j = b_ja[q];
+          if (pos[j] == unset || pos[j] < row_begin) {
+            pos[j] = c_ja.size();
+            c_ja.push_back(j);
+            c_a.push_back(a[p] * b[q]);
+          } else {
+            c_a[pos[j]] += a[p] * b[q];
+          }
+        }
+      }
+
+      size_t row_end = c_ja.size();
+      if (!std::is_sorted(c_ja.begin() + row_begin, c_ja.end())) {
+        row.clear();
+        for (size_t q = row_begin; q < row_end; ++q) {
+          row.emplace_back(c_ja[q], c_a[q]);
+        }
+        std::sort(row.begin(), row.end(), [](std::pair<size_t, Scalar> const & l,
+            std::pair<size_t, Scalar> const & r) {
+          return l.first < r.first;
+        });
+        for (size_t q = row_begin; q < row_end; ++q) {
+          c_ja[q] = row[q - row_begin].first;
+          c_a[q] = row[q - row_begin].second;
+        }
+      }
+      c_ia.push_back(row_end);
+    }
+  }
+} } } // namespace fe::la::details
+
+#endif // SPARSE_MATRIX_PRODUCT_HPP_
@@ -2,48 +2,262 @@
 #define SPARSE_MATRIX_VECTOR_PRODUCT_HPP_
 
 #include <cassert>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
 #include "../dense_vector.hpp"
+#include "../threads.hpp"
+
+namespace fe { namespace la {
+  // Buffers of the threads of a sparse matrix product by a row vector. A product without
+  //   a workspace allocates its own; passing one to repeated products lets them reuse
+  //   the buffers. A workspace must not be used by two products at the same time.
+  template<class Scalar>
+  struct transposed_prod_workspace {
+    // First column held by the buffer of every chunk of rows
+    std::vector<size_t> col_begin;
+    std::vector<std::vector<Scalar>> values;
+  };
+} } // namespace fe::la
 
 namespace fe { namespace la { namespace details {
+  // Nonzeros in one part of the row partition of a compressed row matrix
+  size_t const SPMV_PART_NNZ = 4096;
+  // Smallest number of parts worth a thread
+  size_t const SPMV_MIN_PARTS = 8;
+
+  // Splits the rows of a compressed row matrix into contiguous parts of about
+  //   SPMV_PART_NNZ nonzeros, part k has rows bounds[k] ... bounds[k + 1] - 1.
+  //   Parts of equal nonzero counts, not row counts, keep threads busy when row lengths vary.
+  inline void csr_row_partition(size_t dim1, std::vector<size_t> const & ia, std::vector<size_t> & bounds) {
+    bounds.assign(1, 0);
+    for (size_t row = 0; row < dim1;) {
+      row = std::lower_bound(ia.begin() + row + 1, ia.begin() + dim1, ia[row] + SPMV_PART_NNZ) - ia.begin();
+      bounds.push_back(row);
+    }
+  }
+
+  // y = alpha * A x + beta * y for rows first ... last - 1 of A given by compressed row arrays
+  template<class Scalar>
+  void csr_mv_prod_rows(size_t first, size_t last, size_t const * ia, size_t const * ja, Scalar const * a,
+      Scalar const * x, Scalar * y, Scalar alpha, Scalar beta) {
+    bool overwrite = beta == Scalar();
+    for (size_t i = first; i < last; ++i) {
+      Scalar sum = Scalar();
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        sum += a[p] * x[ja[p]];
+      }
+      y[i] = overwrite ? alpha * sum : alpha * sum + beta * y[i];
+    }
+  }
+
+  // The same for all rows, consecutive parts of the row partition are given to every thread
+  template<class Scalar>
+  void csr_mv_prod(std::vector<size_t> const & partition, std::vector<size_t> const & ia,
+      std::vector<size_t> const & ja, Scalar const * a, Scalar const * x, Scalar * y, Scalar alpha, Scalar beta) {
+    parallel_chunks(partition.size() - 1, SPMV_MIN_PARTS, 1, [&](size_t first, size_t last) {
+      csr_mv_prod_rows(partition[first], partition[last], ia.data(), ja.data(), a, x, y, alpha, beta);
+    });
+  }
+
+  // y += alpha * A^T x for rows first ... last - 1 of A given by compressed row arrays,
+  //   y holds columns col_begin ... of the result. Every row is scattered into y,
+  //   so A is read row by row just as in the product by A.
+  template<class Scalar>
+  void csr_tmv_prod_rows(size_t first, size_t last, size_t const * ia, size_t const * ja, Scalar const * a,
+      Scalar const * x, Scalar * y, size_t col_begin, Scalar alpha) {
+    for (size_t i = first; i < last; ++i) {
+      Scalar alpha_x_i = alpha * x[i];
+      for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+        y[ja[p] - col_begin] += a[p] * alpha_x_i;
+      }
+    }
+  }
+
+  // The same for a row profile, row i has elements in columns first_col[i] ... without gaps
+  template<class Scalar>
+  void rowprof_tmv_prod_rows(size_t first, size_t last, size_t const * ia, size_t const * first_col,
+      Scalar const * a, Scalar const * x, Scalar * y, size_t col_begin, Scalar alpha) {
+    for (size_t i = first; i < last; ++i) {
+      Scalar alpha_x_i = alpha * x[i];
+      Scalar const * a_i = a + ia[i];
+      Scalar * y_i = y + first_col[i] - col_begin;
+      size_t count = ia[i + 1] - ia[i];
+      for (size_t k = 0; k < count; ++k) {
+        y_i[k] += a_i[k] * alpha_x_i;
+      }
+    }
+  }
+
+  /**
+   * y = alpha * A^T x + beta * y for a matrix with dim2 columns whose rows are split by
+   * partition (see csr_row_partition). column_range(first, last) returns the bounds
+   * [begin, end) of the columns used by rows first ... last - 1 and
+   * scatter_rows(first, last, y, col_begin, alpha) adds their part of the product to y.
+   *
+   * Rows given to different threads hit the same columns, so every thread scatters into
+   * its own buffer in work covering only its column range and the buffers are summed in
+   * row order afterwards, which keeps the result independent of scheduling.
+   */
+  template<class Scalar, class ColumnRange, class ScatterRows>
+  void transposed_prod(std::vector<size_t> const & partition, size_t dim2, Scalar * y,
+      Scalar alpha, Scalar beta, transposed_prod_workspace<Scalar> & work,
+      ColumnRange const & column_range, ScatterRows const & scatter_rows) {
+    size_t parts = partition.size() - 1;
+    size_t chunk_size = parallel_chunk_size(parts, SPMV_MIN_PARTS, 1);
+    if (chunk_size >= parts) {
+      scale_output(dim2, beta, y);
+      scatter_rows(partition[0], partition[parts], y, size_t(0), alpha);
+      return;
+    }
+
+    size_t chunks = (parts + chunk_size - 1) / chunk_size;
+    if (work.values.size() < chunks) {
+      work.col_begin.resize(chunks);
+      work.values.resize(chunks);
+    }
+    parallel_chunks(parts, SPMV_MIN_PARTS, 1, [&](size_t first, size_t last) {
+      size_t chunk = first / chunk_size;
+      size_t first_row = partition[first];
+      size_t last_row = partition[last];
+
+      std::pair<size_t, size_t> cols = column_range(first_row, last_row);
+      std::vector<Scalar> & buf = work.values[chunk];
+      work.col_begin[chunk] = cols.first;
+      buf.assign(cols.second - cols.first, Scalar());
+      scatter_rows(first_row, last_row, buf.data(), cols.first, alpha);
+    });
+
+    parallel_chunks(dim2, SPMV_PART_NNZ, 1, [&](size_t first, size_t last) {
+      scale_output(last - first, beta, y + first);
+      for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        std::vector<Scalar> const & buf = work.values[chunk];
+        size_t col_begin = work.col_begin[chunk];
+        size_t begin = std::max(first, col_begin);
+        size_t end = std::min(last, col_begin + buf.size());
+        for (size_t j = begin; j < end; ++j) {
+          y[j] += buf[j - col_begin];
+        }
+      }
+    });
+  }
+
+  // y = alpha * A^T x + beta * y for A given by compressed row arrays
+  template<class Scalar>
+  void csr_tmv_prod(std::vector<size_t> const & partition, size_t dim2, std::vector<size_t> const & ia,
+      std::vector<size_t> const & ja, Scalar const * a, Scalar const * x, Scalar * y, Scalar alpha, Scalar beta,
+      transposed_prod_workspace<Scalar> & work) {
+    transposed_prod(partition, dim2, y, alpha, beta, work,
+        [&](size_t first, size_t last) {
+          // Columns of every row are sorted
+          size_t begin = dim2;
+          size_t end = 0;
+          for (size_t i = first; i < last; ++i) {
+            if (ia[i] != ia[i + 1]) {
+              begin = std::min(begin, ja[ia[i]]);
+              end = std::max(end, ja[ia[i + 1] - 1] + 1);
+            }
+          }
+          return begin < end ? std::make_pair(begin, end) : std::make_pair(size_t(0), size_t(0));
+        },
+        [&](size_t first, size_t last, Scalar * res, size_t col_begin, Scalar factor) {
+          csr_tmv_prod_rows(first, last, ia.data(), ja.data(), a, x, res, col_begin, factor);
+        });
+  }
+
+  // The same for a row profile
+  template<class Scalar>
+  void rowprof_tmv_prod(std::vector<size_t> const & partition, size_t dim2, std::vector<size_t> const & ia,
+      std::vector<size_t> const & first_col, Scalar const * a, Scalar const * x, Scalar * y,
+      Scalar alpha, Scalar beta, transposed_prod_workspace<Scalar> & work) {
+    transposed_prod(partition, dim2, y, alpha, beta, work,
+        [&](size_t first, size_t last) {
+          size_t begin = dim2;
+          size_t end = 0;
+          for (size_t i = first; i < last; ++i) {
+            if (ia[i] != ia[i + 1]) {
+              begin = std::min(begin, first_col[i]);
+              end = std::max(end, first_col[i] + ia[i + 1] - ia[i]);
+            }
+          }
+          return begin < end ? std::make_pair(begin, end) : std::make_pair(size_t(0), size_t(0));
+        },
+        [&](size_t first, size_t last, Scalar * res, size_t col_begin, Scalar factor) {
+          rowprof_tmv_prod_rows(first, last, ia.data(), first_col.data(), a, x, res, col_begin, factor);
+        });
+  }
+
+  // Computes res = alpha * matrix * vector + beta * res, res is not read if beta is zero
   template<
       class Scalar,
       class Storage,
       template<class Sc, class St> class SparseMatrix>
-  dense_vector<Scalar, Storage> mv_sparse_prod(SparseMatrix<Scalar, Storage> const & matrix,
-        dense_vector<Scalar, Storage> const & vector) {
-    assert(matrix.dim2() == vector.dim1());
+  void mv_sparse_prod_into(SparseMatrix<Scalar, Storage> const & matrix,
+        dense_vector<Scalar, Storage> const & vector,
+        dense_vector<Scalar, Storage> & res,
+        Scalar alpha,
+        Scalar beta) {
+    assert(matrix.dim2() == vector.dim());
+    assert(matrix.dim1() == res.dim());
 
-    dense_vector<Scalar, Storage> res{vector.dim()};
     for (size_t i = 0; i < res.dim(); ++i) {
+      Scalar sum = Scalar();
       {
         auto iter_end = matrix.nnrow_cend(i);
         for (auto iter = matrix.nnrow_cbegin(i); iter != iter_end; ++iter) {
-          res(i) += vector(iter.index()) * (*iter);
+          sum += vector(iter.index()) * (*iter);
         }
       }
+      res(i) = (beta == Scalar()) ? alpha * sum : alpha * sum + beta * res(i);
     }
-
-    return res;
   }
 
+  // Computes res = alpha * vector * matrix + beta * res, res is not read if beta is zero
   template<
       class Scalar,
       class Storage,
       template<class Sc, class St> class SparseMatrix>
-  dense_vector<Scalar, Storage> mv_sparse_prod(dense_vector<Scalar, Storage> const & vector,
-      SparseMatrix<Scalar, Storage> const & matrix) {
-    assert(vector.dim2() == matrix.dim1());
+  void mv_sparse_prod_into(dense_vector<Scalar, Storage> const & vector,
+        SparseMatrix<Scalar, Storage> const & matrix,
+        dense_vector<Scalar, Storage> & res,
+        Scalar alpha,
+        Scalar beta) {
+    assert(vector.dim() == matrix.dim1());
+    assert(matrix.dim2() == res.dim());
 
-    dense_vector<Scalar, Storage> res{vector.dim(), vector_type::ROW_VECTOR};
     for (size_t i = 0; i < res.dim(); ++i) {
+      Scalar sum = Scalar();
       {
         auto iter_end = matrix.nncol_cend(i);
         for (auto iter = matrix.nncol_cbegin(i); iter != iter_end; ++iter) {
-          res(i) += vector(iter.index()) * (*iter);
+          sum += vector(iter.index()) * (*iter);
         }
       }
+      res(i) = (beta == Scalar()) ? alpha * sum : alpha * sum + beta * res(i);
     }
+  }
 
+  template<
+      class Scalar,
+      class Storage,
+      template<class Sc, class St> class SparseMatrix>
+  dense_vector<Scalar, Storage> mv_sparse_prod(SparseMatrix<Scalar, Storage> const & matrix,
+        dense_vector<Scalar, Storage> const & vector) {
+    dense_vector<Scalar, Storage> res{matrix.dim1()};
+    mv_sparse_prod_into(matrix, vector, res, Scalar(1), Scalar());
+    return res;
+  }
+
+  template<
+      class Scalar,
+      class Storage,
+      template<class Sc, class St> class SparseMatrix>
+  dense_vector<Scalar, Storage> mv_sparse_prod(dense_vector<Scalar, Storage> const & vector,
+      SparseMatrix<Scalar, Storage> const & matrix) {
+    dense_vector<Scalar, Storage> res{matrix.dim2(), vector_type::ROW_VECTOR};
+    mv_sparse_prod_into(vector, matrix, res, Scalar(1), Scalar());
     return res;
   }
 } } } // namespace fe::la::details
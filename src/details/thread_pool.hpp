@@ -0,0 +1,143 @@
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+namespace fe { namespace la { namespace details {
+  // Set for pool workers and for a thread that waits for a parallel loop,
+  // nested parallel loops are run serially by the calling thread.
+  inline bool & in_parallel_region() {
+    static thread_local bool flag = false;
+    return flag;
+  }
+
+  // A fixed set of worker threads running parallel loops.
+  // The thread calling run() takes part in the loop, so a pool of size n
+  // starts n - 1 threads.
+  class thread_pool {
+    public:
+      explicit thread_pool(size_t thread_count)
+          : stop_(false), generation_(0), invoke_(nullptr), task_(nullptr), task_count_(0),
+            next_(0), active_(0) {
+        for (size_t i = 1; i < thread_count; ++i) {
+          workers_.emplace_back([this] { worker_loop(); });
+        }
+      }
+
+      thread_pool(thread_pool const &) = delete;
+      thread_pool & operator = (thread_pool const &) = delete;
+
+      ~thread_pool() {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          stop_ = true;
+        }
+        wake_cv_.notify_all();
+        for (auto & worker : workers_) {
+          worker.join();
+        }
+      }
+
+      size_t size() const {
+        return workers_.size() + 1;
+      }
+
+      // Calls task(i) for each i in [0, count) and waits for all calls to finish.
+      // Tasks must not throw. Does not allocate memory.
+      template<class Task>
+      void run(size_t count, Task const & task) {
+        if (count == 0) {
+          return;
+        }
+
+        if (workers_.empty() || count == 1 || in_parallel_region()) {
+          for (size_t i = 0; i < count; ++i) {
+            task(i);
+          }
+          return;
+        }
+
+        // Only one loop at a time can use the workers
+        std::lock_guard<std::mutex> run_lock(run_mutex_);
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          invoke_ = &invoke_task<Task>;
+          task_ = &task;
+          task_count_ = count;
+          next_ = 0;
+          active_ = workers_.size();
+          ++generation_;
+        }
+        wake_cv_.notify_all();
+
+        in_parallel_region() = true;
+        do_work();
+        in_parallel_region() = false;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this] { return active_ == 0; });
+        invoke_ = nullptr;
+        task_ = nullptr;
+      }
+    private:
+      template<class Task>
+      static void invoke_task(void const * task, size_t i) {
+        (*static_cast<Task const *>(task))(i);
+      }
+
+      void do_work() {
+        for (size_t i = next_++; i < task_count_; i = next_++) {
+          invoke_(task_, i);
+        }
+      }
+
+      void worker_loop() {
+        in_parallel_region() = true;
+
+        size_t seen_generation = 0;
+        for (;;) {
+          {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_cv_.wait(lock, [&] { return stop_ || generation_ != seen_generation; });
+            if (stop_) {
+              return;
+            }
+            seen_generation = generation_;
+          }
+
+          do_work();
+
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--active_ == 0) {
+              done_cv_.notify_one();
+            }
+          }
+        }
+      }
+    private:
+      std::vector<std::thread> workers_;
+
+      std::mutex run_mutex_;
+      std::mutex mutex_;
+      std::condition_variable wake_cv_;
+      std::condition_variable done_cv_;
+
+      bool stop_;
+      size_t generation_;
+      // Type-erased task, std::function could allocate
+      void (*invoke_)(void const *, size_t);
+      void const * task_;
+      size_t task_count_;
+      std::atomic<size_t> next_;
+      size_t active_;
+  };
+} } } // namespace fe::la::details
+
+#endif // THREAD_POOL_HPP_
@@ -0,0 +1,235 @@
+#ifndef TRIANGULAR_SOLVE_HPP_
+#define TRIANGULAR_SOLVE_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+#include <vector>
+
+#include "blas1_kernels.hpp"
+#include "../threads.hpp"
+
+// Forward and back substitution with sparse factors in O(nnz) time.
+// LU factors are kept in one matrix: unit diagonal L below the diagonal, U on and above it.
+// Row-oriented solves (CSR, non-null row iterators) do a dot product per row,
+//   column-oriented solves (CSC) an axpy per column.
+// Block solves work on several right-hand sides at once: x is a row-major n x width
+//   block with rows ldx apart, and every factor element updates a whole row of it.
+
+namespace fe { namespace la { namespace details {
+  // Detects matrices with nnrow_cbegin/nnrow_cend
+  template<class Matrix>
+  class has_nnrow_iterators {
+    private:
+      template<class M>
+      static auto test(int) -> decltype(std::declval<M const &>().nnrow_cbegin(0),
+          std::declval<M const &>().nnrow_cend(0), std::true_type());
+
+      template<class M>
+      static std::false_type test(...);
+    public:
+      static bool const value = decltype(test<Matrix>(0))::value;
+  };
+
+  // Solves L U x = b in place with factors stored by rows, columns in every row sorted
+  template<class Scalar>
+  void csr_lu_solve(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      Scalar const * a, Scalar * x) {
+    for (size_t i = 0; i < n; ++i) {
+      Scalar sum = x[i];
+      for (size_t p = ia[i]; p < ia[i + 1] && ja[p] < i; ++p) {
+        sum -= a[p] * x[ja[p]];
+      }
+      x[i] = sum;
+    }
+
+    for (size_t i = n; i-- > 0;) {
+      Scalar sum = x[i];
+      size_t p = ia[i + 1];
+      for (; p > ia[i] && ja[p - 1] > i; --p) {
+        sum -= a[p - 1] * x[ja[p - 1]];
+      }
+      assert(p > ia[i] && ja[p - 1] == i);
+      x[i] = sum / a[p - 1];
+    }
+  }
+
+  // Solves L U x = b in place with any matrix that has non-null row iterators,
+  //   elements of a row may come in any order
+  template<class Matrix, class Scalar>
+  void nnrow_lu_solve(Matrix const & lu, Scalar * x) {
+    size_t n = lu.dim1();
+
+    for (size_t i = 0; i < n; ++i) {
+      Scalar sum = x[i];
+      auto iter_end = lu.nnrow_cend(i);
+      for (auto iter = lu.nnrow_cbegin(i); iter != iter_end; ++iter) {
+        if (iter.index() < i) {
+          sum -= *iter * x[iter.index()];
+        }
+      }
+      x[i] = sum;
+    }
+
+    for (size_t i = n; i-- > 0;) {
+      Scalar sum = x[i];
+      Scalar diag = Scalar();
+      auto iter_end = lu.nnrow_cend(i);
+      for (auto iter = lu.nnrow_cbegin(i); iter != iter_end; ++iter) {
+        if (iter.index() > i) {
+          sum -= *iter * x[iter.index()];
+        } else if (iter.index() == i) {
+          diag = *iter;
+        }
+      }
+      x[i] = sum / diag;
+    }
+  }
+
+  // Right-hand sides solved together by one thread
+  size_t const SOLVE_BLOCK_COLS = 64;
+
+  // Calls solve_block(first, last) for column blocks of an n x k right-hand side,
+  //   column blocks are split between threads
+  template<class SolveBlock>
+  void for_each_column_block(size_t k, SolveBlock const & solve_block) {
+    parallel_chunks(k, SOLVE_BLOCK_COLS, 8, [&](size_t first, size_t last) {
+      for (size_t c = first; c < last; c += SOLVE_BLOCK_COLS) {
+        solve_block(c, std::min(last, c + SOLVE_BLOCK_COLS));
+      }
+    });
+  }
+
+  template<class Scalar>
+  void divide_row(size_t width, Scalar d, Scalar * x) {
+    for (size_t c = 0; c < width; ++c) {
+      x[c] /= d;
+    }
+  }
+
+  // Block version of csr_lu_solve
+  template<class Scalar>
+  void csr_lu_solve_block(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      Scalar const * a, Scalar * x, size_t ldx, size_t width) {
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t p = ia[i]; p < ia[i + 1] && ja[p] < i; ++p) {
+        axpy_kernel(width, -a[p], x + ja[p] * ldx, x + i * ldx);
+      }
+    }
+
+    for (size_t i = n; i-- > 0;) {
+      size_t p = ia[i + 1];
+      for (; p > ia[i] && ja[p - 1] > i; --p) {
+        axpy_kernel(width, -a[p - 1], x + ja[p - 1] * ldx, x + i * ldx);
+      }
+      assert(p > ia[i] && ja[p - 1] == i);
+      divide_row(width, a[p - 1], x + i * ldx);
+    }
+  }
+
+  // Block version of nnrow_lu_solve
+  template<class Matrix, class Scalar>
+  void nnrow_lu_solve_block(Matrix const & lu, Scalar * x, size_t ldx, size_t width) {
+    size_t n = lu.dim1();
+
+    for (size_t i = 0; i < n; ++i) {
+      auto iter_end = lu.nnrow_cend(i);
+      for (auto iter = lu.nnrow_cbegin(i); iter != iter_end; ++iter) {
+        if (iter.index() < i) {
+          axpy_kernel(width, -Scalar(*iter), x + iter.index() * ldx, x + i * ldx);
+        }
+      }
+    }
+
+    for (size_t i = n; i-- > 0;) {
+      Scalar diag = Scalar();
+      auto iter_end = lu.nnrow_cend(i);
+      for (auto iter = lu.nnrow_cbegin(i); iter != iter_end; ++iter) {
+        if (iter.index() > i) {
+          axpy_kernel(width, -Scalar(*iter), x + iter.index() * ldx, x + i * ldx);
+        } else if (iter.index() == i) {
+          diag = *iter;
+        }
+      }
+      divide_row(width, diag, x + i * ldx);
+    }
+  }
+
+  // Block solve with dense factors, which are read once per block
+  template<class Matrix, class Scalar>
+  void dense_lu_solve_block(Matrix const & lu, Scalar * x, size_t ldx, size_t width) {
+    size_t n = lu.dim1();
+
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < i; ++j) {
+        axpy_kernel(width, -Scalar(lu(i, j)), x + j * ldx, x + i * ldx);
+      }
+    }
+
+    for (size_t i = n; i-- > 0;) {
+      for (size_t j = i + 1; j < n; ++j) {
+        axpy_kernel(width, -Scalar(lu(i, j)), x + j * ldx, x + i * ldx);
+      }
+      divide_row(width, Scalar(lu(i, i)), x + i * ldx);
+    }
+  }
+
+  // Solves L y = b in place, L stored by rows with the diagonal last in every row
+  template<class Scalar>
+  void csr_lower_solve(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      Scalar const * a, Scalar * x) {
+    for (size_t i = 0; i < n; ++i) {
+      size_t last = ia[i + 1] - 1;
+      Scalar sum = x[i];
+      for (size_t p = ia[i]; p < last; ++p) {
+        sum -= a[p] * x[ja[p]];
+      }
+      x[i] = sum / a[last];
+    }
+  }
+
+  // Solves L^T x = y in place for the same L, rows of L are the columns of L^T
+  template<class Scalar>
+  void csr_lower_transpose_solve(size_t n, std::vector<size_t> const & ia, std::vector<size_t> const & ja,
+      Scalar const * a, Scalar * x) {
+    for (size_t i = n; i-- > 0;) {
+      size_t last = ia[i + 1] - 1;
+      x[i] /= a[last];
+      Scalar x_i = x[i];
+      for (size_t p = ia[i]; p < last; ++p) {
+        x[ja[p]] -= a[p] * x_i;
+      }
+    }
+  }
+
+  // Solves L y = b in place, L stored by columns with the diagonal first in every column
+  template<class Scalar>
+  void csc_lower_solve(size_t n, std::vector<size_t> const & cp, std::vector<size_t> const & ri,
+      Scalar const * a, Scalar * x, bool unit_diagonal) {
+    for (size_t j = 0; j < n; ++j) {
+      if (!unit_diagonal) {
+        x[j] /= a[cp[j]];
+      }
+      Scalar x_j = x[j];
+      for (size_t p = cp[j] + 1; p < cp[j + 1]; ++p) {
+        x[ri[p]] -= a[p] * x_j;
+      }
+    }
+  }
+
+  // Solves L^T x = y in place for the same L, columns of L are the rows of L^T
+  template<class Scalar>
+  void csc_lower_transpose_solve(size_t n, std::vector<size_t> const & cp, std::vector<size_t> const & ri,
+      Scalar const * a, Scalar * x, bool unit_diagonal) {
+    for (size_t j = n; j-- > 0;) {
+      Scalar sum = x[j];
+      for (size_t p = cp[j] + 1; p < cp[j + 1]; ++p) {
+        sum -= a[p] * x[ri[p]];
+      }
+      x[j] = unit_diagonal ? sum : sum / a[cp[j]];
+    }
+  }
+} } } // namespace fe::la::details
+
+#endif // TRIANGULAR_SOLVE_HPP_
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <utility>
+
+#include "permutation.hpp"
+#include "sparsity_pattern.hpp"
+#include "reordering.hpp"
+
+// Orderings that reduce fill-in of sparse LU (and Cholesky) factors.
+// Factor the reordered matrix and solve through the permutation:
+//   auto perm = approximate_minimum_degree(sparsity_pattern(a));
+//   auto lu = convert_matrix<compressed_row_matrix>(a, perm);
+//   sparse_lu_decomposition(lu);
+//   solve_lu_inplace(lu, perm, b);
+
+namespace fe { namespace la {
+  /**
+   * Approximate minimum degree ordering. Elimination is simulated on the quotient
+   * graph: eliminated vertices become elements (cliques) instead of adding fill edges,
+   * so memory stays O(nnz). Degrees are replaced by the upper bound of Amestoy,
+   * Davis and Duff, which is updated in time proportional to the size of the pivot element.
+   */
+  inline permutation approximate_minimum_degree(sparsity_pattern const & pattern) {
+    size_t const NONE = size_t(-1);
+    size_t n = pattern.size();
+
+    // Adjacent live variables and adjacent elements of every variable,
+    //   variables of every element (an element is named after its pivot)
+    std::vector<std::vector<size_t>> var_adj(n);
+    std::vector<std::vector<size_t>> var_elems(n);
+    std::vector<std::vector<size_t>> elem_vars(n);
+    std::vector<bool> absorbed(n, false);
+    std::vector<size_t> degree(n);
+
+    // Variables by (approximate degree, index)
+    std::set<std::pair<size_t, size_t>> queue;
+    for (size_t v = 0; v < n; ++v) {
+      var_adj[v].assign(pattern.adjacent_begin(v), pattern.adjacent_end(v));
+      degree[v] = pattern.degree(v);
+      queue.emplace(degree[v], v);
+    }
+
+    // in_pivot[v] == p means v is in the pivot element p
+    std::vector<size_t> in_pivot(n, NONE);
+    // external[e] = |L_e \ L_p| for elements adjacent to the pivot element, NONE otherwise
+    std::vector<size_t> external(n, NONE);
+    std::vector<size_t> touched;
+
+    std::vector<size_t> new_to_old;
+    new_to_old.reserve(n);
+
+    for (size_t k = 0; k < n; ++k) {
+      size_t p = queue.begin()->second;
+      queue.erase(queue.begin());
+      new_to_old.push_back(p);
+
+      // The pivot element is the union of adjacent variables and adjacent elements,
+      //   which are absorbed by it
+      std::vector<size_t> pivot_vars;
+      in_pivot[p] = p;
+      for (size_t v : var_adj[p]) {
+        if (in_pivot[v] != p) {
+          in_pivot[v] = p;
+          pivot_vars.push_back(v);
+        }
+      }
+      for (size_t e : var_elems[p]) {
+        if (absorbed[e]) {
+          continue;
+        }
+        for (size_t v : elem_vars[e]) {
+          if (in_pivot[v] != p) {
+            in_pivot[v] = p;
+            pivot_vars.push_back(v);
+          }
+        }
+        absorbed[e] = true;
+        std::vector<size_t>().swap(elem_vars[e]);
+      }
+      std::vector<size_t>().swap(var_adj[p]);
+      std::vector<size_t>().swap(var_elems[p]);
+
+      // |L_e \ L_p| of other elements, elements inside L_p are absorbed too
+      touched.clear();
+      for (size_t i : pivot_vars) {
+        for (size_t e : var_elems[i]) {
+          if (absorbed[e]) {
+            continue;
+          }
+          if (external[e] == NONE) {
+            external[e] = elem_vars[e].size();
+            touched.push_back(e);
+          }
+          --external[e];
+        }
+      }
+      for (size_t e : touched) {
+        if (external[e] == 0) {
+          absorbed[e] = true;
+          std::vector<size_t>().swap(elem_vars[e]);
+        }
+      }
+
+      size_t pivot_ext = pivot_vars.empty() ? 0 : pivot_vars.size() - 1;
+      for (size_t i : pivot_vars) {
+        queue.erase(std::make_pair(degree[i], i));
+
+        // Edges to variables of the pivot element are covered by it
+        var_adj[i].erase(std::remove_if(var_adj[i].begin(), var_adj[i].end(),
+            [&](size_t v) { return in_pivot[v] == p; }), var_adj[i].end());
+
+        size_t elems_ext = 0;
+        var_elems[i].erase(std::remove_if(var_elems[i].begin(), var_elems[i].end(),
+            [&](size_t e) { return absorbed[e]; }), var_elems[i].end());
+        for (size_t e : var_elems[i]) {
+          elems_ext += external[e];
+        }
+        var_elems[i].push_back(p);
+
+        size_t bound = var_adj[i].size() + pivot_ext + elems_ext;
+        bound = std::min(bound, degree[i] + pivot_ext);
+        bound = std::min(bound, n - k - 2);
+
+        degree[i] = bound;
+        queue.emplace(degree[i], i);
+      }
+
+      for (size_t e : touched) {
+        external[e] = NONE;
+      }
+      elem_vars[p] = std::move(pivot_vars);
+    }
+
+    return permutation(std::move(new_to_old));
+  }
+
+  namespace details {
+    // Appends the nested dissection ordering of the connected set of vertices
+    //   to new_to_old. Separators are excluded from the graph as they are found
+    //   and numbered after both parts they separate.
+    inline void dissect(sparsity_pattern const & pattern, std::vector<size_t> vertices, size_t leaf_size,
+        std::vector<bool> & excluded, std::vector<size_t> & level, std::vector<size_t> & order,
+        std::vector<size_t> & new_to_old) {
+      size_t height = 0;
+      if (vertices.size() > leaf_size) {
+        pseudo_peripheral_pair(pattern, vertices.front(), excluded, level, order);
+        height = level[order.back()] + 1;
+      }
+
+      // Small sets and sets without a separating level are numbered as they are
+      if (height < 3) {
+        for (size_t v : vertices) {
+          excluded[v] = true;
+        }
+        new_to_old.insert(new_to_old.end(), vertices.begin(), vertices.end());
+        return;
+      }
+
+      // The smallest level in the middle half of the level structure separates it
+      std::vector<size_t> level_sizes(height, 0);
+      for (size_t v : order) {
+        ++level_sizes[level[v]];
+      }
+      size_t separator_level = height / 2;
+      for (size_t l = std::max<size_t>(1, height / 4); l <= std::min(height - 2, 3 * height / 4); ++l) {
+        if (level_sizes[l] < level_sizes[separator_level]) {
+          separator_level = l;
+        }
+      }
+
+      std::vector<size_t> separator;
+      std::vector<size_t> parts;
+      for (size_t v : order) {
+        if (level[v] == separator_level) {
+          separator.push_back(v);
+          excluded[v] = true;
+        } else {
+          parts.push_back(v);
+        }
+      }
+
+      // Both sides may fall apart into several components
+      for (size_t v : parts) {
+        if (excluded[v]) {
+          continue;
+        }
+        level_structure(pattern, v, excluded, level, order);
+        dissect(pattern, order, leaf_size, excluded, level, order, new_to_old);
+      }
+
+      new_to_old.insert(new_to_old.end(), separator.begin(), separator.end());
+    }
+  } // namespace details
+
+  /**
+   * Nested dissection ordering: recursively splits the graph by a level of a
+   * breadth-first level structure and numbers the separator last.
+   * Sets of at most leaf_size vertices are not split further.
+   * It is much cheaper to compute than minimum degree and keeps the fill of
+   * large 2D and 3D meshes within a small factor of it.
+   */
+  inline permutation nested_dissection(sparsity_pattern const & pattern, size_t leaf_size = 16) {
+    size_t n = pattern.size();
+
+    std::vector<size_t> new_to_old;
+    new_to_old.reserve(n);
+
+    std::vector<bool> excluded(n, false);
+    std::vector<size_t> level(n, details::NO_LEVEL);
+    std::vector<size_t> order;
+
+    for (size_t v = 0; v < n; ++v) {
+      if (excluded[v]) {
+        continue;
+      }
+      details::level_structure(pattern, v, excluded, level, order);
+      details::dissect(pattern, order, leaf_size, excluded, level, order, new_to_old);
+    }
+
+    return permutation(std::move(new_to_old));
+  }
+} } // namespace fe::la
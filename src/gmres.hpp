@@ -0,0 +1,288 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <complex>
+
+#include "dense_matrix.hpp"
+#include "dense_vector.hpp"
+#include "blas1.hpp"
+#include "iterative.hpp"
+#include "details/blas1_kernels.hpp"
+
+namespace fe { namespace la {
+  namespace details {
+    // Complex Givens rotation [c s; -conj(s) c] that maps (a, b) to (r, 0), c is real
+    template<class Scalar>
+    void givens_rotation(Scalar a, Scalar b, typename real_type<Scalar>::type & c, Scalar & s, Scalar & r) {
+      typedef typename real_type<Scalar>::type real_t;
+
+      if (b == Scalar()) {
+        c = 1;
+        s = Scalar();
+        r = a;
+      } else if (a == Scalar()) {
+        c = 0;
+        s = Scalar(1);
+        r = b;
+      } else {
+        real_t abs_a = std::abs(a);
+        real_t norm = std::sqrt(abs_squared(a) + abs_squared(b));
+        Scalar phase = a / abs_a;
+        c = abs_a / norm;
+        s = phase * conj_if_complex(b) / norm;
+        r = phase * norm;
+      }
+    }
+
+    template<class Scalar>
+    void apply_givens_rotation(typename real_type<Scalar>::type c, Scalar s, Scalar & x, Scalar & y) {
+      Scalar t = c * x + s * y;
+      y = c * y - conj_if_complex(s) * x;
+      x = t;
+    }
+  } // namespace details
+
+  /**
+   * Restarted GMRES(m) for general nonsingular systems:
+   *
+   *   gmres_solver_real gmres{iterative_control(1000, 1e-10), 30};
+   *   iterative_result res = gmres.solve(a, b, x, preconditioner);
+   *
+   * The Krylov basis is kept in the rows of one (m + 1) x n dense_matrix and
+   * orthogonalized by modified Gram-Schmidt over those contiguous rows.
+   * The workspace is allocated by the first solve of a given dimension.
+   */
+  template<class Scalar, class Storage>
+  class gmres_solver {
+    public:
+      typedef Scalar scalar_t;
+      typedef Storage storage_t;
+      typedef typename details::real_type<Scalar>::type real_t;
+
+      explicit gmres_solver(iterative_control const & control = iterative_control(), size_t restart = 30,
+          preconditioning_side side = preconditioning_side::RIGHT)
+          : control_(control), restart_(restart), side_(side),
+            basis_(0, 0), hessenberg_(0, 0), r_(0), w_(0), t_(0) {
+        assert(restart > 0);
+      }
+
+      iterative_control & control() {
+        return control_;
+      }
+
+      iterative_control const & control() const {
+        return control_;
+      }
+
+      size_t restart() const {
+        return restart_;
+      }
+
+      // Called with the residual norm of the initial guess and of every iteration,
+      //   the residual is preconditioned for left preconditioning
+      void set_residual_callback(residual_callback_t callback) {
+        callback_ = std::move(callback);
+      }
+
+      template<class Operator>
+      iterative_result solve(Operator const & A, dense_vector<Scalar, Storage> const & b,
+          dense_vector<Scalar, Storage> & x) {
+        return solve(A, b, x, identity_preconditioner());
+      }
+
+      template<class Operator, class Preconditioner>
+      iterative_result solve(Operator const & A, dense_vector<Scalar, Storage> const & b,
+          dense_vector<Scalar, Storage> & x, Preconditioner const & M) {
+        assert(b.dim() == x.dim());
+
+        size_t n = b.dim();
+        size_t m = restart_;
+        allocate(n);
+
+        bool left = side_ == preconditioning_side::LEFT;
+        Scalar * v = basis_.data().data();
+        Scalar * w = w_.data().data();
+
+        // The stopping norm of left preconditioning is relative to M^-1 b
+        double b_norm = nrm2(b);
+        if (left) {
+          M.apply(b, t_);
+          b_norm = nrm2(t_);
+        }
+        double stop_norm = details::stopping_norm(control_, b_norm);
+
+        iterative_result res{0, 0., false};
+        for (;;) {
+          residual(A, b, x, M);
+          real_t beta = nrm2(r_);
+          res.residual_norm = beta;
+          if (res.iterations == 0) {
+            report(res);
+          }
+          if (beta <= stop_norm) {
+            res.converged = true;
+            break;
+          }
+          if (res.iterations >= control_.max_iterations) {
+            break;
+          }
+
+          // v_0 = r / beta, g = beta * e_0
+          std::copy(r_.data().begin(), r_.data().end(), v);
+          details::scal_kernel(n, Scalar(1 / beta), v);
+          std::fill(g_.begin(), g_.end(), Scalar());
+          g_[0] = beta;
+
+          size_t k = 0;
+          bool breakdown = false;
+          while (k < m && res.iterations < control_.max_iterations) {
+            // w = A M^-1 v_k or M^-1 A v_k
+            std::copy(v + k * n, v + (k + 1) * n, t_.data().begin());
+            if (left) {
+              details::apply_operator(A, t_, r_);
+              M.apply(r_, w_);
+            } else {
+              M.apply(t_, r_);
+              details::apply_operator(A, r_, w_);
+            }
+
+            for (size_t i = 0; i <= k; ++i) {
+              Scalar h = details::dotc_kernel(n, v + i * n, w);
+              details::axpy_kernel(n, -h, v + i * n, w);
+              hessenberg_(i, k) = h;
+            }
+            real_t h_next = std::sqrt(details::sumsq_kernel(n, w));
+            hessenberg_(k + 1, k) = h_next;
+            if (h_next != real_t()) {
+              std::copy(w, w + n, v + (k + 1) * n);
+              details::scal_kernel(n, Scalar(1 / h_next), v + (k + 1) * n);
+            } else {
+              breakdown = true;
+            }
+
+            // Least squares problem min ||g - H y|| by Givens rotations
+            for (size_t i = 0; i < k; ++i) {
+              details::apply_givens_rotation(cs_[i], sn_[i], hessenberg_(i, k), hessenberg_(i + 1, k));
+            }
+            Scalar r;
+            details::givens_rotation(hessenberg_(k, k), hessenberg_(k + 1, k), cs_[k], sn_[k], r);
+            hessenberg_(k, k) = r;
+            hessenberg_(k + 1, k) = Scalar();
+            details::apply_givens_rotation(cs_[k], sn_[k], g_[k], g_[k + 1]);
+
+            ++k;
+            ++res.iterations;
+            res.residual_norm = std::abs(g_[k]);
+            report(res);
+            if (res.residual_norm <= stop_norm || breakdown) {
+              break;
+            }
+          }
+
+          update_solution(k, x, M);
+          if (breakdown && res.residual_norm > stop_norm) {
+            residual(A, b, x, M);
+            res.residual_norm = nrm2(r_);
+            break;
+          }
+        }
+
+        if (left) {
+          // The result reports the true residual
+          details::apply_operator(A, x, r_);
+          scal(Scalar(-1), r_);
+          axpy(Scalar(1), b, r_);
+          res.residual_norm = nrm2(r_);
+        }
+
+        return res;
+      }
+    private:
+      void allocate(size_t n) {
+        size_t m = restart_;
+        if (basis_.dim1() != m + 1 || basis_.dim2() != n) {
+          basis_ = dense_matrix<Scalar, Storage>(m + 1, n);
+        }
+        if (hessenberg_.dim1() != m + 1) {
+          hessenberg_ = dense_matrix<Scalar, Storage>(m + 1, m);
+          cs_.resize(m);
+          sn_.resize(m);
+          g_.resize(m + 1);
+        }
+        details::resize_workspace(r_, n);
+        details::resize_workspace(w_, n);
+        details::resize_workspace(t_, n);
+      }
+
+      // r = b - A x, preconditioned for left preconditioning
+      template<class Operator, class Preconditioner>
+      void residual(Operator const & A, dense_vector<Scalar, Storage> const & b,
+          dense_vector<Scalar, Storage> const & x, Preconditioner const & M) {
+        details::apply_operator(A, x, w_);
+        scal(Scalar(-1), w_);
+        axpy(Scalar(1), b, w_);
+        if (side_ == preconditioning_side::LEFT) {
+          M.apply(w_, r_);
+        } else {
+          r_ = w_;
+        }
+      }
+
+      // x += V y (or M^-1 V y) for the solution y of the k x k triangular system H y = g
+      template<class Preconditioner>
+      void update_solution(size_t k, dense_vector<Scalar, Storage> & x, Preconditioner const & M) {
+        for (size_t i = k; i-- > 0;) {
+          Scalar sum = g_[i];
+          for (size_t j = i + 1; j < k; ++j) {
+            sum -= hessenberg_(i, j) * g_[j];
+          }
+          g_[i] = sum / hessenberg_(i, i);
+        }
+
+        size_t n = x.dim();
+        Scalar const * v = basis_.data().data();
+        std::fill(t_.data().begin(), t_.data().end(), Scalar());
+        for (size_t i = 0; i < k; ++i) {
+          details::axpy_kernel(n, g_[i], v + i * n, t_.data().data());
+        }
+
+        if (side_ == preconditioning_side::LEFT) {
+          axpy(Scalar(1), t_, x);
+        } else {
+          M.apply(t_, w_);
+          axpy(Scalar(1), w_, x);
+        }
+      }
+
+      void report(iterative_result const & res) const {
+        if (callback_) {
+          callback_(res.iterations, res.residual_norm);
+        }
+      }
+    private:
+      iterative_control control_;
+      size_t restart_;
+      preconditioning_side side_;
+      residual_callback_t callback_;
+
+      // Row i is the Krylov basis vector v_i
+      dense_matrix<Scalar, Storage> basis_;
+      // Upper Hessenberg matrix, reduced to triangular by the rotations cs_, sn_
+      dense_matrix<Scalar, Storage> hessenberg_;
+      std::vector<real_t> cs_;
+      std::vector<Scalar> sn_;
+      // Right-hand side of the least squares problem
+      std::vector<Scalar> g_;
+
+      dense_vector<Scalar, Storage> r_;
+      dense_vector<Scalar, Storage> w_;
+      dense_vector<Scalar, Storage> t_;
+  };
+
+  typedef gmres_solver<double, std::vector<double>> gmres_solver_real;
+  typedef gmres_solver<std::complex<double>, std::vector<std::complex<double>>> gmres_solver_complex;
+} } // namespace fe::la
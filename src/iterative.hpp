@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <algorithm>
+
+#include "dense_vector.hpp"
+#include "products.hpp"
+#include "blas1.hpp"
+
+// Common parts of the iterative solvers (cg.hpp and others).
+// The system operator is either a matrix of any format with mvprod_into
+//   or a callable op(x, y) that computes y = A x.
+// Preconditioners have apply(r, z) const that computes z = M^-1 r.
+
+namespace fe { namespace la {
+  /**
+   * Stopping rules of an iterative solver: iterations stop when
+   *   ||r|| <= max(relative_tolerance * ||b||, absolute_tolerance)
+   * for the residual r = b - A x, or after max_iterations.
+   */
+  struct iterative_control {
+    size_t max_iterations;
+    double relative_tolerance;
+    double absolute_tolerance;
+
+    explicit iterative_control(size_t max_iterations = 1000, double relative_tolerance = 1e-8,
+        double absolute_tolerance = 0)
+        : max_iterations(max_iterations), relative_tolerance(relative_tolerance),
+          absolute_tolerance(absolute_tolerance) {
+    }
+  };
+
+  struct iterative_result {
+    size_t iterations;
+    // Norm of the residual b - A x of the returned solution
+    double residual_norm;
+    bool converged;
+  };
+
+  // Called with the iteration number (0 for the initial guess) and the residual norm
+  typedef std::function<void(size_t, double)> residual_callback_t;
+
+  // M = I
+  struct identity_preconditioner {
+    template<class Scalar, class Storage>
+    void apply(dense_vector<Scalar, Storage> const & r, dense_vector<Scalar, Storage> & z) const {
+      z = r;
+    }
+  };
+
+  // Which side of A the preconditioner is applied to
+  enum class preconditioning_side {
+    LEFT,  // solves M^-1 A x = M^-1 b, the tolerance applies to the preconditioned residual
+    RIGHT  // solves A M^-1 u = b with x = M^-1 u, the tolerance applies to the true residual
+  };
+
+  namespace details {
+    // y = A x for a matrix, any type with an mvprod_into overload
+    template<class Matrix, class Scalar, class Storage>
+    auto apply_operator(Matrix const & A, dense_vector<Scalar, Storage> const & x,
+        dense_vector<Scalar, Storage> & y) -> decltype(mvprod_into(A, x, y)) {
+      mvprod_into(A, x, y);
+    }
+
+    // y = A x for a user operator
+    template<class Operator, class Scalar, class Storage>
+    auto apply_operator(Operator const & A, dense_vector<Scalar, Storage> const & x,
+        dense_vector<Scalar, Storage> & y) -> decltype(A(x, y), void()) {
+      A(x, y);
+    }
+
+    // Makes v a zero vector of dimension n, allocates only if the dimension changes
+    template<class Scalar, class Storage>
+    void resize_workspace(dense_vector<Scalar, Storage> & v, size_t n) {
+      if (v.dim() != n) {
+        v = dense_vector<Scalar, Storage>(n);
+      }
+    }
+
+    inline double stopping_norm(iterative_control const & control, double b_norm) {
+      return std::max(control.relative_tolerance * b_norm, control.absolute_tolerance);
+    }
+  } // namespace details
+} } // namespace fe::la
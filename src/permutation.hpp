@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <utility>
+
+#include "dense_vector.hpp"
+
+namespace fe { namespace la {
+  /**
+   * Symmetric reordering of rows and columns of a square matrix.
+   * Row and column i of the reordered matrix P A P^T are row and column
+   * old_index(i) of A, new_index is the inverse mapping.
+   */
+  class permutation {
+    public:
+      // Identity permutation
+      explicit permutation(size_t size)
+          : new_to_old_(size), old_to_new_(size) {
+        for (size_t i = 0; i < size; ++i) {
+          new_to_old_[i] = i;
+          old_to_new_[i] = i;
+        }
+      }
+
+      // new_to_old[i] is the old index of the element that gets index i
+      explicit permutation(std::vector<size_t> new_to_old)
+          : new_to_old_(std::move(new_to_old)), old_to_new_(new_to_old_.size(), new_to_old_.size()) {
+        for (size_t i = 0; i < size(); ++i) {
+          assert(new_to_old_[i] < size());
+          assert(old_to_new_[new_to_old_[i]] == size());
+
+          old_to_new_[new_to_old_[i]] = i;
+        }
+      }
+
+      size_t size() const {
+        return new_to_old_.size();
+      }
+
+      size_t old_index(size_t new_index) const {
+        assert(new_index < size());
+
+        return new_to_old_[new_index];
+      }
+
+      size_t new_index(size_t old_index) const {
+        assert(old_index < size());
+
+        return old_to_new_[old_index];
+      }
+
+      permutation inverse() const {
+        return permutation(old_to_new_);
+      }
+
+      std::vector<size_t> const & new_to_old() const {
+        return new_to_old_;
+      }
+
+      std::vector<size_t> const & old_to_new() const {
+        return old_to_new_;
+      }
+    private:
+      std::vector<size_t> new_to_old_;
+      std::vector<size_t> old_to_new_;
+  };
+
+  // Reorders a vector (e.g. the right-hand side) to the numbering of P A P^T
+  template<class Scalar, class Storage>
+  dense_vector<Scalar, Storage> permute(permutation const & perm, dense_vector<Scalar, Storage> const & vector) {
+    assert(perm.size() == vector.dim());
+
+    dense_vector<Scalar, Storage> res{vector};
+    for (size_t i = 0; i < vector.dim(); ++i) {
+      res(i) = vector(perm.old_index(i));
+    }
+
+    return res;
+  }
+
+  // Brings a vector (e.g. the solution) from the numbering of P A P^T back to the original one
+  template<class Scalar, class Storage>
+  dense_vector<Scalar, Storage> unpermute(permutation const & perm, dense_vector<Scalar, Storage> const & vector) {
+    assert(perm.size() == vector.dim());
+
+    dense_vector<Scalar, Storage> res{vector};
+    for (size_t i = 0; i < vector.dim(); ++i) {
+      res(perm.old_index(i)) = vector(i);
+    }
+
+    return res;
+  }
+} } // namespace fe::la
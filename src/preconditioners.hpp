@@ -0,0 +1,436 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <complex>
+
+#include "compressed_row_matrix.hpp"
+#include "symmetric_compressed_row_matrix.hpp"
+#include "block_compressed_row_matrix.hpp"
+#include "dense_vector.hpp"
+#include "details/nonnull_elements.hpp"
+#include "details/sparse_lu_kernels.hpp"
+#include "details/incomplete_factorization_kernels.hpp"
+#include "details/triangular_solve.hpp"
+
+// Preconditioners for the iterative solvers (cg.hpp, gmres.hpp, bicgstab.hpp).
+// compute(A) does the setup and apply(r, z) computes z = M^-1 r, so both can be
+//   timed separately; constructing from a matrix calls compute.
+// compute may be called again for a matrix with new values, buffers are reused.
+
+namespace fe { namespace la {
+  // M = diag(A)
+  template<class Scalar, class Storage>
+  class jacobi_preconditioner {
+    public:
+      jacobi_preconditioner() = default;
+
+      template<class Matrix>
+      explicit jacobi_preconditioner(Matrix const & A) {
+        compute(A);
+      }
+
+      template<class Matrix>
+      void compute(Matrix const & A) {
+        assert(A.dim1() == A.dim2());
+
+        inv_diag_.assign(A.dim1(), Scalar());
+        details::for_each_nonnull(A, [&](size_t i, size_t j, Scalar const & value) {
+          if (i == j) {
+            inv_diag_[i] = value;
+          }
+        });
+        for (auto & d : inv_diag_) {
+          assert(d != Scalar());
+          d = Scalar(1) / d;
+        }
+      }
+
+      void apply(dense_vector<Scalar, Storage> const & r, dense_vector<Scalar, Storage> & z) const {
+        assert(r.dim() == inv_diag_.size() && z.dim() == r.dim());
+
+        for (size_t i = 0; i < inv_diag_.size(); ++i) {
+          z(i) = inv_diag_[i] * r(i);
+        }
+      }
+    private:
+      std::vector<Scalar> inv_diag_;
+  };
+
+  // M = the block diagonal of A with square blocks of block_size rows (the last one may be smaller),
+  //   every block is factored by dense LU with partial pivoting
+  template<class Scalar, class Storage>
+  class block_jacobi_preconditioner {
+    public:
+      explicit block_jacobi_preconditioner(size_t block_size = 4)
+          : block_size_(block_size), n_(0) {
+        assert(block_size > 0);
+      }
+
+      template<class Matrix>
+      block_jacobi_preconditioner(Matrix const & A, size_t block_size)
+          : block_jacobi_preconditioner(block_size) {
+        compute(A);
+      }
+
+      // Uses the blocks of a block matrix
+      template<size_t B>
+      explicit block_jacobi_preconditioner(block_compressed_row_matrix<Scalar, Storage, B> const & A)
+          : block_jacobi_preconditioner(B) {
+        compute(A);
+      }
+
+      template<class Matrix>
+      void compute(Matrix const & A) {
+        assert(A.dim1() == A.dim2());
+
+        n_ = A.dim1();
+        size_t bs = block_size_;
+        blocks_.assign(block_count() * bs * bs, Scalar());
+        pivots_.resize(n_);
+
+        details::for_each_nonnull(A, [&](size_t i, size_t j, Scalar const & value) {
+          if (i / bs == j / bs) {
+            block(i / bs)[(i % bs) * bs + j % bs] = value;
+          }
+        });
+
+        for (size_t b = 0; b < block_count(); ++b) {
+          factor_block(b);
+        }
+      }
+
+      // Takes the diagonal blocks of A directly, the block size becomes B
+      template<size_t B>
+      void compute(block_compressed_row_matrix<Scalar, Storage, B> const & A) {
+        assert(A.dim1() == A.dim2());
+
+        block_size_ = B;
+        n_ = A.dim1();
+        blocks_.assign(block_count() * B * B, Scalar());
+        pivots_.resize(n_);
+
+        auto const & ia = A.row_offsets();
+        auto const & ja = A.column_indices();
+        for (size_t b = 0; b < block_count(); ++b) {
+          auto pos = std::lower_bound(ja.begin() + ia[b], ja.begin() + ia[b + 1], b);
+          if (pos != ja.begin() + ia[b + 1] && *pos == b) {
+            auto first = A.data().begin() + (pos - ja.begin()) * B * B;
+            std::copy(first, first + B * B, block(b));
+          }
+          factor_block(b);
+        }
+      }
+
+      void apply(dense_vector<Scalar, Storage> const & r, dense_vector<Scalar, Storage> & z) const {
+        assert(r.dim() == n_ && z.dim() == n_);
+
+        size_t bs = block_size_;
+        Scalar * x = z.data().data();
+        std::copy(r.data().begin(), r.data().end(), z.data().begin());
+
+        for (size_t b = 0; b < block_count(); ++b) {
+          size_t first = b * bs;
+          size_t m = std::min(bs, n_ - first);
+          Scalar const * lu = block(b);
+          size_t const * piv = pivots_.data() + first;
+          Scalar * xb = x + first;
+
+          // Rows of the factors were swapped whole, multipliers included, so P is applied first
+          for (size_t k = 0; k < m; ++k) {
+            std::swap(xb[k], xb[piv[k]]);
+          }
+          for (size_t k = 0; k < m; ++k) {
+            for (size_t i = k + 1; i < m; ++i) {
+              xb[i] -= lu[i * bs + k] * xb[k];
+            }
+          }
+          for (size_t k = m; k-- > 0;) {
+            xb[k] /= lu[k * bs + k];
+            for (size_t i = 0; i < k; ++i) {
+              xb[i] -= lu[i * bs + k] * xb[k];
+            }
+          }
+        }
+      }
+
+      size_t block_size() const {
+        return block_size_;
+      }
+    private:
+      size_t block_count() const {
+        return (n_ + block_size_ - 1) / block_size_;
+      }
+
+      Scalar * block(size_t b) {
+        return blocks_.data() + b * block_size_ * block_size_;
+      }
+
+      Scalar const * block(size_t b) const {
+        return blocks_.data() + b * block_size_ * block_size_;
+      }
+
+      void factor_block(size_t b) {
+        size_t bs = block_size_;
+        size_t m = std::min(bs, n_ - b * bs);
+        Scalar * lu = block(b);
+        size_t * piv = pivots_.data() + b * bs;
+
+        for (size_t k = 0; k < m; ++k) {
+          size_t p = k;
+          for (size_t i = k + 1; i < m; ++i) {
+            if (std::abs(lu[i * bs + k]) > std::abs(lu[p * bs + k])) {
+              p = i;
+            }
+          }
+          piv[k] = p;
+          if (p != k) {
+            std::swap_ranges(lu + k * bs, lu + k * bs + m, lu + p * bs);
+          }
+          assert(lu[k * bs + k] != Scalar());
+
+          for (size_t i = k + 1; i < m; ++i) {
+            Scalar l_ik = lu[i * bs + k] / lu[k * bs + k];
+            lu[i * bs + k] = l_ik;
+            for (size_t j = k + 1; j < m; ++j) {
+              lu[i * bs + j] -= l_ik * lu[k * bs + j];
+            }
+          }
+        }
+      }
+    private:
+      size_t block_size_;
+      size_t n_;
+
+      // Row-major block_size x block_size LU factors of the blocks, one after another
+      std::vector<Scalar> blocks_;
+      // Row interchanged with row k of its block at step k
+      std::vector<size_t> pivots_;
+  };
+
+  // ILU(0): L U with exactly the pattern of A, every row must have a diagonal element
+  template<class Scalar, class Storage>
+  class ilu0_preconditioner {
+    public:
+      ilu0_preconditioner()
+          : n_(0) {
+      }
+
+      explicit ilu0_preconditioner(compressed_row_matrix<Scalar, Storage> const & A) {
+        compute(A);
+      }
+
+      void compute(compressed_row_matrix<Scalar, Storage> const & A) {
+        assert(A.dim1() == A.dim2());
+
+        n_ = A.dim1();
+        ia_ = A.row_offsets();
+        ja_ = A.column_indices();
+        lu_ = A.data();
+        details::diagonal_positions(n_, ia_, ja_, diag_);
+
+        pos_.assign(n_, details::NOT_IN_ROW);
+        details::ilu0(n_, ia_, ja_, diag_, lu_.data(), pos_);
+      }
+
+      void apply(dense_vector<Scalar, Storage> const & r, dense_vector<Scalar, Storage> & z) const {
+        assert(r.dim() == n_ && z.dim() == n_);
+
+        z = r;
+        details::lu_solve_inplace(n_, ia_, ja_, diag_, lu_.data(), z.data().data());
+      }
+    private:
+      size_t n_;
+
+      std::vector<size_t> ia_;
+      std::vector<size_t> ja_;
+      std::vector<size_t> diag_;
+      Storage lu_;
+      std::vector<size_t> pos_;
+  };
+
+  // ILU(0) of a block matrix: L U with the block pattern of A, where every block
+  //   row must have a nonsingular diagonal block
+  template<class Scalar, class Storage, size_t B>
+  class block_ilu0_preconditioner {
+    public:
+      block_ilu0_preconditioner()
+          : n_(0) {
+      }
+
+      explicit block_ilu0_preconditioner(block_compressed_row_matrix<Scalar, Storage, B> const & A) {
+        compute(A);
+      }
+
+      void compute(block_compressed_row_matrix<Scalar, Storage, B> const & A) {
+        assert(A.dim1() == A.dim2());
+
+        n_ = A.block_rows();
+        ia_ = A.row_offsets();
+        ja_ = A.column_indices();
+        lu_ = A.data();
+        inv_diag_.resize(n_ * B * B);
+        details::diagonal_positions(n_, ia_, ja_, diag_);
+
+        pos_.assign(n_, details::NOT_IN_ROW);
+        details::block_ilu0<B>(n_, ia_, ja_, diag_, lu_.data(), inv_diag_.data(), pos_);
+      }
+
+      void apply(dense_vector<Scalar, Storage> const & r, dense_vector<Scalar, Storage> & z) const {
+        assert(r.dim() == n_ * B && z.dim() == r.dim());
+
+        z = r;
+        details::block_lu_solve_inplace<B>(n_, ia_, ja_, diag_, lu_.data(), inv_diag_.data(), z.data().data());
+      }
+    private:
+      // Number of block rows
+      size_t n_;
+
+      std::vector<size_t> ia_;
+      std::vector<size_t> ja_;
+      std::vector<size_t> diag_;
+      Storage lu_;
+      // Inverted diagonal blocks of U
+      Storage inv_diag_;
+      std::vector<size_t> pos_;
+  };
+
+  /**
+   * IC(0): L L^T with the pattern of the lower triangle of a symmetric matrix,
+   * for symmetric positive definite matrices (it may break down for others,
+   * which shows as a non-positive value under the square root).
+   */
+  template<class Scalar, class Storage>
+  class ic0_preconditioner {
+    public:
+      ic0_preconditioner()
+          : n_(0) {
+      }
+
+      explicit ic0_preconditioner(compressed_row_matrix<Scalar, Storage> const & A) {
+        compute(A);
+      }
+
+      explicit ic0_preconditioner(symmetric_compressed_row_matrix<Scalar, Storage> const & A) {
+        compute(A);
+      }
+
+      // Uses the lower triangle of A
+      void compute(compressed_row_matrix<Scalar, Storage> const & A) {
+        assert(A.dim1() == A.dim2());
+
+        n_ = A.dim1();
+        auto const & ia = A.row_offsets();
+        auto const & ja = A.column_indices();
+        auto const & a = A.data();
+
+        ia_.assign(1, 0);
+        ja_.clear();
+        l_.clear();
+        for (size_t i = 0; i < n_; ++i) {
+          for (size_t p = ia[i]; p < ia[i + 1] && ja[p] <= i; ++p) {
+            ja_.push_back(ja[p]);
+            l_.push_back(a[p]);
+          }
+          ia_.push_back(ja_.size());
+        }
+
+        details::ic0(n_, ia_, ja_, l_.data());
+      }
+
+      void compute(symmetric_compressed_row_matrix<Scalar, Storage> const & A) {
+        n_ = A.dim1();
+        ia_ = A.row_offsets();
+        ja_ = A.column_indices();
+        l_ = A.data();
+
+        details::ic0(n_, ia_, ja_, l_.data());
+      }
+
+      void apply(dense_vector<Scalar, Storage> const & r, dense_vector<Scalar, Storage> & z) const {
+        assert(r.dim() == n_ && z.dim() == n_);
+
+        z = r;
+        details::csr_lower_solve(n_, ia_, ja_, l_.data(), z.data().data());
+        details::csr_lower_transpose_solve(n_, ia_, ja_, l_.data(), z.data().data());
+      }
+    private:
+      size_t n_;
+
+      // L by rows, the diagonal is the last element of every row
+      std::vector<size_t> ia_;
+      std::vector<size_t> ja_;
+      Storage l_;
+  };
+
+  /**
+   * ILUT(tolerance, fill): elements of L and U smaller than tolerance times the norm
+   * of their row of A are dropped, and at most fill elements are kept in each of the
+   * L and U parts of a row. Larger fill and smaller tolerance give a better
+   * preconditioner for a higher setup and apply cost (see factor_size).
+   */
+  template<class Scalar, class Storage>
+  class ilut_preconditioner {
+    public:
+      explicit ilut_preconditioner(double tolerance = 1e-3, size_t fill = 10)
+          : tolerance_(tolerance), fill_(fill), n_(0) {
+      }
+
+      ilut_preconditioner(compressed_row_matrix<Scalar, Storage> const & A, double tolerance, size_t fill)
+          : ilut_preconditioner(tolerance, fill) {
+        compute(A);
+      }
+
+      void compute(compressed_row_matrix<Scalar, Storage> const & A) {
+        assert(A.dim1() == A.dim2());
+
+        n_ = A.dim1();
+        details::ilut(n_, A.row_offsets(), A.column_indices(), A.data().data(), tolerance_, fill_,
+            ia_, ja_, lu_, diag_);
+      }
+
+      void apply(dense_vector<Scalar, Storage> const & r, dense_vector<Scalar, Storage> & z) const {
+        assert(r.dim() == n_ && z.dim() == n_);
+
+        z = r;
+        details::lu_solve_inplace(n_, ia_, ja_, diag_, lu_.data(), z.data().data());
+      }
+
+      // Number of elements stored in L + U
+      size_t factor_size() const {
+        return ja_.size();
+      }
+    private:
+      double tolerance_;
+      size_t fill_;
+      size_t n_;
+
+      std::vector<size_t> ia_;
+      std::vector<size_t> ja_;
+      std::vector<size_t> diag_;
+      Storage lu_;
+  };
+
+  typedef jacobi_preconditioner<double, std::vector<double>> jacobi_preconditioner_real;
+  typedef jacobi_preconditioner<std::complex<double>, std::vector<std::complex<double>>>
+      jacobi_preconditioner_complex;
+  typedef block_jacobi_preconditioner<double, std::vector<double>> block_jacobi_preconditioner_real;
+  typedef block_jacobi_preconditioner<std::complex<double>, std::vector<std::complex<double>>>
+      block_jacobi_preconditioner_complex;
+  typedef ilu0_preconditioner<double, std::vector<double>> ilu0_preconditioner_real;
+  typedef ilu0_preconditioner<std::complex<double>, std::vector<std::complex<double>>>
+      ilu0_preconditioner_complex;
+  template<size_t B>
+  using block_ilu0_preconditioner_real = block_ilu0_preconditioner<double, std::vector<double>, B>;
+  template<size_t B>
+  using block_ilu0_preconditioner_complex =
+      block_ilu0_preconditioner<std::complex<double>, std::vector<std::complex<double>>, B>;
+  typedef ic0_preconditioner<double, std::vector<double>> ic0_preconditioner_real;
+  typedef ic0_preconditioner<std::complex<double>, std::vector<std::complex<double>>>
+      ic0_preconditioner_complex;
+  typedef ilut_preconditioner<double, std::vector<double>> ilut_preconditioner_real;
+  typedef ilut_preconditioner<std::complex<double>, std::vector<std::complex<double>>>
+      ilut_preconditioner_complex;
+} } // namespace fe::la
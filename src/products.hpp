@@ -1,27 +1,38 @@
 #pragma once
 
 #include "dense_vector.hpp"
+#include "threads.hpp"
 
 namespace fe { namespace la {
   namespace details {
-    // General implementation, sparse matrices have explicit template specializations
+    // General implementation, sparse matrices have explicit template specializations.
+    // Every implementation computes res = alpha * lhs * rhs + beta * res,
+    //   res is not read if beta is zero.
     template<
         template<class Sc, class St> class Matrix
         ,class Scalar
         ,class Storage>
     struct mat_rowvec_prod_impl_f {
-      dense_vector<Scalar, Storage> operator()(dense_vector<Scalar, Storage> lhs
-          ,Matrix<Scalar, Storage> rhs) const {
-        assert(lhs.dim2() == rhs.dim1());
+      void operator()(dense_vector<Scalar, Storage> const & lhs
+          ,Matrix<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        assert(lhs.dim() == rhs.dim1());
+        assert(res.dim() == rhs.dim2());
 
-        typedef dense_vector<Scalar, Storage> vec;
-        typedef dense_matrix<Scalar, Storage> mat;
-
-        vec res{rhs.dim2(), vector_type::ROW_VECTOR};
-
-        details::mprod_inplace(lhs, rhs, res);
-
-        return res;
+        // Columns of the result are split between threads
+        size_t rows = rhs.dim1();
+        parallel_chunks(res.dim(), PARALLEL_MIN_WORK / std::max<size_t>(rows, 1) + 1, 1,
+            [&](size_t first, size_t last) {
+              for (size_t j = first; j < last; ++j) {
+                Scalar sum = Scalar();
+                for (size_t k = 0; k < rows; ++k) {
+                  sum += lhs(k) * rhs(k, j);
+                }
+                res(j) = (beta == Scalar()) ? alpha * sum : alpha * sum + beta * res(j);
+              }
+            });
       }
     };
 
@@ -36,32 +47,103 @@ namespace fe { namespace la {
         ,class Scalar
         ,class Storage>
     struct mat_colvec_prod_impl_f {
-      dense_vector<Scalar, Storage> operator()(Matrix<Scalar, Storage> lhs
-          , dense_vector<Scalar, Storage> rhs) const {
-        assert(lhs.dim2() == rhs.dim1());
+      void operator()(Matrix<Scalar, Storage> const & lhs
+          ,dense_vector<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        assert(lhs.dim2() == rhs.dim());
+        assert(res.dim() == lhs.dim1());
+
+        // Rows of the result are split between threads
+        size_t cols = lhs.dim2();
+        parallel_chunks(res.dim(), PARALLEL_MIN_WORK / std::max<size_t>(cols, 1) + 1, 1,
+            [&](size_t first, size_t last) {
+              for (size_t i = first; i < last; ++i) {
+                Scalar sum = Scalar();
+                for (size_t k = 0; k < cols; ++k) {
+                  sum += lhs(i, k) * rhs(k);
+                }
+                res(i) = (beta == Scalar()) ? alpha * sum : alpha * sum + beta * res(i);
+              }
+            });
+      }
+    };
 
-        typedef dense_vector<Scalar, Storage> vec;
-        typedef dense_matrix<Scalar, Storage> mat;
+    // Dense matrices use gemv kernels working directly on the storage
+    template<class Scalar, class Storage>
+    struct mat_rowvec_prod_impl_f<dense_matrix, Scalar, Storage> {
+      void operator()(dense_vector<Scalar, Storage> const & lhs
+          ,dense_matrix<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        assert(lhs.dim() == rhs.dim1());
+        assert(res.dim() == rhs.dim2());
 
-        vec res{lhs.dim1()};
+        gevm_parallel(rhs.dim1(), rhs.dim2(), alpha, lhs.data().data(),
+            rhs.data().data(), rhs.dim2(), beta, res.data().data());
+      }
+    };
 
-        details::mprod_inplace(lhs, rhs, res);
+    template<class Scalar, class Storage>
+    struct mat_colvec_prod_impl_f<dense_matrix, Scalar, Storage> {
+      void operator()(dense_matrix<Scalar, Storage> const & lhs
+          ,dense_vector<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        assert(lhs.dim2() == rhs.dim());
+        assert(res.dim() == lhs.dim1());
 
-        return res;
+        gemv_parallel(lhs.dim1(), lhs.dim2(), alpha, lhs.data().data(), lhs.dim2(),
+            rhs.data().data(), beta, res.data().data());
       }
     };
   } // namespace details
 
+  // Computes res = alpha * lhs * rhs + beta * res without allocating memory,
+  //   res must not be the same vector as lhs.
+  // If beta is zero, res is overwritten and its old values are not read.
+  template<template<class Sc, class St> class Matrix, class Scalar, class Storage>
+  void mvprod_into(dense_vector<Scalar, Storage> const & lhs
+      ,Matrix<Scalar, Storage> const & rhs
+      ,dense_vector<Scalar, Storage> & res
+      ,typename dense_vector<Scalar, Storage>::scalar_t alpha = 1
+      ,typename dense_vector<Scalar, Storage>::scalar_t beta = 0) {
+    assert(&lhs != &res);
+
+    details::mat_rowvec_prod_impl_f<Matrix, Scalar, Storage>{}(lhs, rhs, res, alpha, beta);
+  }
+
+  // Computes res = alpha * lhs * rhs + beta * res without allocating memory,
+  //   res must not be the same vector as rhs.
+  // If beta is zero, res is overwritten and its old values are not read.
+  template<template<class Sc, class St> class Matrix, class Scalar, class Storage>
+  void mvprod_into(Matrix<Scalar, Storage> const & lhs
+      ,dense_vector<Scalar, Storage> const & rhs
+      ,dense_vector<Scalar, Storage> & res
+      ,typename dense_vector<Scalar, Storage>::scalar_t alpha = 1
+      ,typename dense_vector<Scalar, Storage>::scalar_t beta = 0) {
+    assert(&rhs != &res);
+
+    details::mat_colvec_prod_impl_f<Matrix, Scalar, Storage>{}(lhs, rhs, res, alpha, beta);
+  }
+
   template<template<class Sc, class St> class Matrix, class Scalar, class Storage>
-  dense_vector<Scalar, Storage> mvprod(dense_vector<Scalar, Storage> lhs
-      ,Matrix<Scalar, Storage> rhs) {
-    return details::mat_rowvec_prod_impl_f<Matrix, Scalar, Storage>{}(lhs, rhs);
+  dense_vector<Scalar, Storage> mvprod(dense_vector<Scalar, Storage> const & lhs
+      ,Matrix<Scalar, Storage> const & rhs) {
+    dense_vector<Scalar, Storage> res{rhs.dim2(), vector_type::ROW_VECTOR};
+    mvprod_into(lhs, rhs, res);
+    return res;
   }
 
   template<template<class Sc, class St> class Matrix, class Scalar, class Storage>
-  dense_vector<Scalar, Storage> mvprod(Matrix<Scalar, Storage> lhs
-      , dense_vector<Scalar, Storage> rhs) {
-    return details::mat_colvec_prod_impl_f<Matrix, Scalar, Storage>{}(lhs, rhs);
+  dense_vector<Scalar, Storage> mvprod(Matrix<Scalar, Storage> const & lhs
+      , dense_vector<Scalar, Storage> const & rhs) {
+    dense_vector<Scalar, Storage> res{lhs.dim1()};
+    mvprod_into(lhs, rhs, res);
+    return res;
   }
 
 } } // namespace fe::la
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <utility>
+
+#include "permutation.hpp"
+#include "sparsity_pattern.hpp"
+
+// Orderings that reduce the bandwidth and the profile of a matrix.
+// Factorization of band and row-profile matrices costs about
+//   n * width^2 operations, so a narrower ordering pays off quadratically.
+// Use them as
+//   auto perm = reverse_cuthill_mckee(sparsity_pattern(a));
+//   auto band = convert_matrix<band_matrix>(a, perm);
+//   ... solve band * y = permute(perm, b), then x = unpermute(perm, y)
+
+namespace fe { namespace la {
+  namespace details {
+    size_t const NO_LEVEL = size_t(-1);
+
+    // Breadth-first search from root over vertices that are not numbered yet.
+    // Fills order with the reached vertices level by level and level[v] with
+    //   their distance from root, returns the number of levels.
+    // level must be NO_LEVEL everywhere except at the vertices in order,
+    //   which is how this function leaves it too.
+    inline size_t level_structure(sparsity_pattern const & pattern, size_t root,
+        std::vector<bool> const & numbered, std::vector<size_t> & level, std::vector<size_t> & order) {
+      for (size_t v : order) {
+        level[v] = NO_LEVEL;
+      }
+      order.clear();
+
+      level[root] = 0;
+      order.push_back(root);
+      for (size_t head = 0; head < order.size(); ++head) {
+        size_t v = order[head];
+        for (auto adj = pattern.adjacent_begin(v); adj != pattern.adjacent_end(v); ++adj) {
+          if (!numbered[*adj] && level[*adj] == NO_LEVEL) {
+            level[*adj] = level[v] + 1;
+            order.push_back(*adj);
+          }
+        }
+      }
+
+      return level[order.back()] + 1;
+    }
+
+    // Finds two vertices far away from each other in the component of start
+    //   (George and Liu). On return level and order hold the level structure
+    //   rooted at the second vertex.
+    inline std::pair<size_t, size_t> pseudo_peripheral_pair(sparsity_pattern const & pattern, size_t start,
+        std::vector<bool> const & numbered, std::vector<size_t> & level, std::vector<size_t> & order) {
+      size_t height = level_structure(pattern, start, numbered, level, order);
+
+      while (true) {
+        // Vertex of minimal degree in the last level
+        size_t end = order.back();
+        for (auto iter = order.rbegin(); iter != order.rend() && level[*iter] == height - 1; ++iter) {
+          if (pattern.degree(*iter) < pattern.degree(end)) {
+            end = *iter;
+          }
+        }
+
+        size_t end_height = level_structure(pattern, end, numbered, level, order);
+        if (end_height <= height) {
+          return {start, end};
+        }
+
+        start = end;
+        height = end_height;
+      }
+    }
+
+    // Vertices sorted by degree, components are started from the one of minimal degree
+    inline std::vector<size_t> vertices_by_degree(sparsity_pattern const & pattern) {
+      std::vector<size_t> res(pattern.size());
+      for (size_t v = 0; v < res.size(); ++v) {
+        res[v] = v;
+      }
+      std::stable_sort(res.begin(), res.end(), [&pattern](size_t l, size_t r) {
+        return pattern.degree(l) < pattern.degree(r);
+      });
+      return res;
+    }
+  } // namespace details
+
+  /**
+   * Reverse Cuthill-McKee ordering: breadth-first numbering from a pseudo-peripheral
+   * vertex of every component, neighbours taken by increasing degree, then reversed.
+   * Gives small bandwidth, use it for band_matrix.
+   */
+  inline permutation reverse_cuthill_mckee(sparsity_pattern const & pattern) {
+    size_t n = pattern.size();
+
+    std::vector<size_t> new_to_old;
+    new_to_old.reserve(n);
+
+    std::vector<bool> numbered(n, false);
+    std::vector<size_t> level(n, details::NO_LEVEL);
+    std::vector<size_t> order;
+    std::vector<size_t> neighbours;
+
+    for (size_t candidate : details::vertices_by_degree(pattern)) {
+      if (numbered[candidate]) {
+        continue;
+      }
+
+      size_t start = details::pseudo_peripheral_pair(pattern, candidate, numbered, level, order).first;
+
+      size_t head = new_to_old.size();
+      numbered[start] = true;
+      new_to_old.push_back(start);
+      for (; head < new_to_old.size(); ++head) {
+        size_t v = new_to_old[head];
+
+        neighbours.clear();
+        for (auto adj = pattern.adjacent_begin(v); adj != pattern.adjacent_end(v); ++adj) {
+          if (!numbered[*adj]) {
+            numbered[*adj] = true;
+            neighbours.push_back(*adj);
+          }
+        }
+        std::stable_sort(neighbours.begin(), neighbours.end(), [&pattern](size_t l, size_t r) {
+          return pattern.degree(l) < pattern.degree(r);
+        });
+        new_to_old.insert(new_to_old.end(), neighbours.begin(), neighbours.end());
+      }
+    }
+
+    std::reverse(new_to_old.begin(), new_to_old.end());
+
+    return permutation(std::move(new_to_old));
+  }
+
+  /**
+   * Sloan ordering: numbers vertices from one end of a pseudo-diameter to the other,
+   * preferring vertices that are far from the end (weight distance_weight) and that
+   * add few new vertices to the front (weight degree_weight).
+   * Usually gives a smaller profile than RCM, use it for rowprof_matrix.
+   */
+  inline permutation sloan(sparsity_pattern const & pattern, long distance_weight = 2, long degree_weight = 1) {
+    enum vertex_status { INACTIVE, PREACTIVE, ACTIVE, POSTACTIVE };
+
+    size_t n = pattern.size();
+
+    std::vector<size_t> new_to_old;
+    new_to_old.reserve(n);
+
+    std::vector<bool> numbered(n, false);
+    std::vector<size_t> level(n, details::NO_LEVEL);
+    std::vector<size_t> order;
+    std::vector<vertex_status> status(n, INACTIVE);
+    std::vector<long> priority(n, 0);
+
+    // Max-heap of (priority, vertex), entries with outdated priority are skipped
+    std::priority_queue<std::pair<long, size_t>> queue;
+    auto raise = [&](size_t v) {
+      priority[v] += degree_weight;
+      if (status[v] == PREACTIVE || status[v] == ACTIVE) {
+        queue.emplace(priority[v], v);
+      }
+    };
+    auto activate = [&](size_t v) {
+      status[v] = PREACTIVE;
+      queue.emplace(priority[v], v);
+    };
+
+    for (size_t candidate : details::vertices_by_degree(pattern)) {
+      if (numbered[candidate]) {
+        continue;
+      }
+
+      size_t start = details::pseudo_peripheral_pair(pattern, candidate, numbered, level, order).first;
+
+      // level holds distances from the end vertex for the whole component
+      for (size_t v : order) {
+        priority[v] = distance_weight * static_cast<long>(level[v])
+            - degree_weight * static_cast<long>(pattern.degree(v) + 1);
+      }
+
+      activate(start);
+      while (!queue.empty()) {
+        size_t v = queue.top().second;
+        long v_priority = queue.top().first;
+        queue.pop();
+        if (status[v] == POSTACTIVE || v_priority != priority[v]) {
+          continue;
+        }
+
+        if (status[v] == PREACTIVE) {
+          for (auto adj = pattern.adjacent_begin(v); adj != pattern.adjacent_end(v); ++adj) {
+            raise(*adj);
+            if (status[*adj] == INACTIVE) {
+              activate(*adj);
+            }
+          }
+        }
+
+        status[v] = POSTACTIVE;
+        numbered[v] = true;
+        new_to_old.push_back(v);
+
+        for (auto adj = pattern.adjacent_begin(v); adj != pattern.adjacent_end(v); ++adj) {
+          size_t u = *adj;
+          if (status[u] != PREACTIVE) {
+            continue;
+          }
+
+          status[u] = ACTIVE;
+          raise(u);
+          for (auto next = pattern.adjacent_begin(u); next != pattern.adjacent_end(u); ++next) {
+            if (status[*next] == POSTACTIVE) {
+              continue;
+            }
+            raise(*next);
+            if (status[*next] == INACTIVE) {
+              activate(*next);
+            }
+          }
+        }
+      }
+    }
+
+    return permutation(std::move(new_to_old));
+  }
+} } // namespace fe::la
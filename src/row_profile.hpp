@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+namespace fe { namespace la {
+  /**
+   * Shape of a matrix given by the range of stored columns in every row:
+   * row i stores columns [first_col(i), end_col(i)), empty rows have first_col(i) == end_col(i).
+   *
+   * It is collected in one streaming pass over the non-null positions (e.g. while
+   * reading triplets or walking a mesh) and then used to allocate a band_matrix or
+   * rowprof_matrix directly, without a dense copy of the matrix.
+   */
+  class row_profile {
+    public:
+      row_profile(size_t dim1, size_t dim2)
+          : dim1_(dim1), dim2_(dim2), first_cols_(dim1, 0), end_cols_(dim1, 0) {
+      }
+
+      // Row i stores columns [first_cols[i], end_cols[i])
+      row_profile(size_t dim1, size_t dim2,
+          std::vector<size_t> first_cols, std::vector<size_t> end_cols)
+          : dim1_(dim1), dim2_(dim2),
+            first_cols_(std::move(first_cols)), end_cols_(std::move(end_cols)) {
+        assert(first_cols_.size() == dim1 && end_cols_.size() == dim1);
+        for (size_t i = 0; i < dim1; ++i) {
+          assert(first_cols_[i] <= end_cols_[i] && end_cols_[i] <= dim2);
+        }
+      }
+
+      // Collects the profile of any matrix with non-null row iterators
+      template<class Matrix>
+      explicit row_profile(Matrix const & matrix)
+          : dim1_(matrix.dim1()), dim2_(matrix.dim2()),
+            first_cols_(matrix.dim1(), 0), end_cols_(matrix.dim1(), 0) {
+        for (size_t i = 0; i < dim1_; ++i) {
+          auto iter_end = matrix.nnrow_cend(i);
+          for (auto iter = matrix.nnrow_cbegin(i); iter != iter_end; ++iter) {
+            add(i, iter.index());
+          }
+        }
+      }
+
+      size_t dim1() const {
+        return dim1_;
+      }
+
+      size_t dim2() const {
+        return dim2_;
+      }
+
+      // Extends the profile of row i to contain column j
+      void add(size_t i, size_t j) {
+        assert(i < dim1());
+        assert(j < dim2());
+
+        if (first_cols_[i] == end_cols_[i]) {
+          first_cols_[i] = j;
+          end_cols_[i] = j + 1;
+        } else {
+          first_cols_[i] = std::min(first_cols_[i], j);
+          end_cols_[i] = std::max(end_cols_[i], j + 1);
+        }
+      }
+
+      size_t first_col(size_t i) const {
+        assert(i < dim1());
+
+        return first_cols_[i];
+      }
+
+      size_t end_col(size_t i) const {
+        assert(i < dim1());
+
+        return end_cols_[i];
+      }
+
+      // Number of elements stored in row-profile form
+      size_t size() const {
+        size_t res = 0;
+        for (size_t i = 0; i < dim1_; ++i) {
+          res += end_cols_[i] - first_cols_[i];
+        }
+        return res;
+      }
+
+      // Number of bands below the diagonal needed to store the profile
+      size_t bands_left() const {
+        size_t res = 0;
+        for (size_t i = 0; i < dim1_; ++i) {
+          if (first_cols_[i] < end_cols_[i] && first_cols_[i] < i) {
+            res = std::max(res, i - first_cols_[i]);
+          }
+        }
+        return res;
+      }
+
+      // Number of bands above the diagonal needed to store the profile
+      size_t bands_right() const {
+        size_t res = 0;
+        for (size_t i = 0; i < dim1_; ++i) {
+          if (first_cols_[i] < end_cols_[i] && end_cols_[i] > i + 1) {
+            res = std::max(res, end_cols_[i] - 1 - i);
+          }
+        }
+        return res;
+      }
+    private:
+      size_t dim1_;
+      size_t dim2_;
+
+      std::vector<size_t> first_cols_;
+      std::vector<size_t> end_cols_;
+  };
+} } // namespace fe::la
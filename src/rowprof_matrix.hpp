@@ -6,6 +6,7 @@
 
 #include "dense_matrix.hpp"
 #include "products.hpp"
+#include "row_profile.hpp"
 #include "details/sparse_element_proxy.hpp"
 #include "details/sparse_matrix_vector_product.hpp"
 
@@ -90,6 +91,19 @@ namespace fe { namespace la {
       };
     public:
       rowprof_matrix() = delete;
+
+      // Makes a zero matrix storing exactly the given profile
+      explicit rowprof_matrix(row_profile const & profile)
+          : dim1_(profile.dim1()), dim2_(profile.dim2()),
+            ia_(profile.dim1() + 1), ja_(profile.dim1()) {
+        for (size_t i = 0; i < dim1_; ++i) {
+          ia_[i + 1] = ia_[i] + profile.end_col(i) - profile.first_col(i);
+          ja_[i] = profile.first_col(i);
+        }
+        a_.resize(ia_[dim1_]);
+        details::csr_row_partition(dim1_, ia_, partition_);
+      }
+
       rowprof_matrix(rowprof_matrix const &) = default;
       rowprof_matrix(rowprof_matrix &&) = default;
       ~rowprof_matrix() = default;
@@ -130,6 +144,21 @@ namespace fe { namespace la {
         return (*const_cast<rowprof_matrix*>(this))(i, j);
       }
 
+      // Elements of row i are data()[row_offsets()[i]] ... data()[row_offsets()[i + 1] - 1]
+      index_storage_t const & row_offsets() const {
+        return ia_;
+      }
+
+      // Column of the first element of every row, the others follow without gaps
+      index_storage_t const & first_columns() const {
+        return ja_;
+      }
+
+      // Row bounds of the parts of about equal element counts that products split between threads
+      index_storage_t const & row_partition() const {
+        return partition_;
+      }
+
       // Non-null row iterators
       nn_row_iterator_t nnrow_begin(size_t row) {
         assert(row < dim1());
@@ -176,6 +205,8 @@ namespace fe { namespace la {
 
       index_storage_t ia_;
       index_storage_t ja_;
+      // Depends only on the profile, which does not change after construction
+      index_storage_t partition_;
 
       storage_t a_;
     private:
@@ -218,19 +249,59 @@ namespace fe { namespace la {
       }
 
       res.ia_[res.dim1()] = res.a_.size();
+      csr_row_partition(res.dim1(), res.ia_, res.partition_);
 
       return res;
     }
 
     template<class Scalar, class Storage>
     struct mat_colvec_prod_impl_f<rowprof_matrix, Scalar, Storage> {
-      dense_vector<Scalar, Storage> operator()(rowprof_matrix<Scalar, Storage> lhs
-          , dense_vector<Scalar, Storage> rhs) const {
-        return mv_sparse_prod(lhs, rhs);
+      void operator()(rowprof_matrix<Scalar, Storage> const & lhs
+          ,dense_vector<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        mv_sparse_prod_into(lhs, rhs, res, alpha, beta);
+      }
+    };
+
+    // x^T A = (A^T x)^T, rows of A are scattered into the result.
+    //   A multithreaded product allocates buffers for its threads, mvprod_into with a workspace reuses them
+    template<class Scalar, class Storage>
+    struct mat_rowvec_prod_impl_f<rowprof_matrix, Scalar, Storage> {
+      void operator()(dense_vector<Scalar, Storage> const & lhs
+          ,rowprof_matrix<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        assert(lhs.dim() == rhs.dim1());
+        assert(res.dim() == rhs.dim2());
+
+        transposed_prod_workspace<Scalar> work;
+        rowprof_tmv_prod(rhs.row_partition(), rhs.dim2(), rhs.row_offsets(), rhs.first_columns(),
+            rhs.data().data(), lhs.data().data(), res.data().data(), alpha, beta, work);
       }
     };
   } // namespace details
 
+  // Computes res = alpha * lhs * rhs + beta * res with the thread buffers kept in work,
+  //   products reusing a workspace allocate memory only when the buffers grow.
+  // If beta is zero, res is overwritten and its old values are not read.
+  template<class Scalar, class Storage>
+  void mvprod_into(dense_vector<Scalar, Storage> const & lhs
+      ,rowprof_matrix<Scalar, Storage> const & rhs
+      ,dense_vector<Scalar, Storage> & res
+      ,transposed_prod_workspace<Scalar> & work
+      ,typename dense_vector<Scalar, Storage>::scalar_t alpha = 1
+      ,typename dense_vector<Scalar, Storage>::scalar_t beta = 0) {
+    assert(&lhs != &res);
+    assert(lhs.dim() == rhs.dim1());
+    assert(res.dim() == rhs.dim2());
+
+    details::rowprof_tmv_prod(rhs.row_partition(), rhs.dim2(), rhs.row_offsets(), rhs.first_columns(),
+        rhs.data().data(), lhs.data().data(), res.data().data(), alpha, beta, work);
+  }
+
   typedef rowprof_matrix<double, std::vector<double>> rowprof_matrix_real;
   typedef rowprof_matrix<std::complex<double>, std::vector<std::complex<double>>> rowprof_matrix_complex;
 } } // namespace fe::la
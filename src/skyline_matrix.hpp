@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <complex>
+
+#include "dense_matrix.hpp"
+#include "dense_vector.hpp"
+#include "products.hpp"
+#include "row_profile.hpp"
+#include "details/sparse_element_proxy.hpp"
+
+namespace fe { namespace la {
+  /**
+   * Symmetric matrix in skyline (envelope) form: only the lower triangle is stored,
+   * row i keeps columns first_col(i) ... i contiguously with the diagonal last.
+   * Element (i, j) above the diagonal is element (j, i), so assigning to it changes both.
+   *
+   * The envelope is closed under LDL^T and Cholesky decomposition, which are done
+   * in place (see decomposition.hpp), so factoring needs no extra memory.
+   */
+  template<class Scalar, class Storage>
+  class skyline_matrix {
+    private:
+      typedef details::sparse_element_proxy<Scalar> proxy_t;
+      typedef std::vector<size_t> index_storage_t;
+    public:
+      typedef Scalar scalar_t;
+      typedef Storage storage_t;
+      typedef proxy_t reference_t;
+      typedef Scalar const_reference_t;
+
+      skyline_matrix() = delete;
+
+      // Makes a zero matrix, row i stores columns first_cols[i] ... i
+      skyline_matrix(size_t dim, std::vector<size_t> const & first_cols)
+          : dim_(dim), ia_(dim + 1, 0) {
+        assert(first_cols.size() == dim);
+
+        for (size_t i = 0; i < dim; ++i) {
+          assert(first_cols[i] <= i);
+          ia_[i + 1] = ia_[i] + i - first_cols[i] + 1;
+        }
+        a_.resize(ia_[dim]);
+      }
+
+      // Makes a zero matrix with the envelope of the symmetrized profile
+      explicit skyline_matrix(row_profile const & profile)
+          : skyline_matrix(profile.dim1(), lower_envelope(profile)) {
+      }
+
+      skyline_matrix(skyline_matrix const &) = default;
+      skyline_matrix(skyline_matrix &&) = default;
+      ~skyline_matrix() = default;
+
+      skyline_matrix & operator = (skyline_matrix const &) = default;
+      skyline_matrix & operator = (skyline_matrix &&) = default;
+
+      size_t dim1() const {
+        return dim_;
+      }
+
+      size_t dim2() const {
+        return dim_;
+      }
+
+      storage_t & data() {
+        return a_;
+      }
+
+      storage_t const & data() const {
+        return a_;
+      }
+
+      // Elements of row i are data()[row_offsets()[i]] ... data()[row_offsets()[i + 1] - 1],
+      //   the last one is the diagonal
+      index_storage_t const & row_offsets() const {
+        return ia_;
+      }
+
+      size_t first_col(size_t i) const {
+        assert(i < dim1());
+
+        return i + ia_[i] + 1 - ia_[i + 1];
+      }
+
+      reference_t operator () (size_t i, size_t j) {
+        assert(i < dim1());
+        assert(j < dim2());
+
+        if (j > i) {
+          std::swap(i, j);
+        }
+
+        if (j < first_col(i)) {
+          return proxy_t();
+        } else {
+          return proxy_t(&a_[ia_[i + 1] - 1 - (i - j)]);
+        }
+      }
+
+      const_reference_t operator () (size_t i, size_t j) const {
+        return (*const_cast<skyline_matrix*>(this))(i, j);
+      }
+    private:
+      // First column of every row of the lower triangle of the profile and its transpose
+      static std::vector<size_t> lower_envelope(row_profile const & profile) {
+        assert(profile.dim1() == profile.dim2());
+
+        size_t n = profile.dim1();
+        std::vector<size_t> res(n);
+        for (size_t i = 0; i < n; ++i) {
+          res[i] = i;
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+          if (profile.first_col(i) == profile.end_col(i)) {
+            continue;
+          }
+          if (profile.first_col(i) < i) {
+            res[i] = std::min(res[i], profile.first_col(i));
+          }
+          // Element (i, j) above the diagonal is (j, i) of the lower triangle
+          for (size_t j = std::max(i + 1, profile.first_col(i)); j < profile.end_col(i); ++j) {
+            res[j] = std::min(res[j], i);
+          }
+        }
+
+        return res;
+      }
+    private:
+      size_t dim_;
+
+      index_storage_t ia_;
+
+      storage_t a_;
+  };
+
+  typedef skyline_matrix<double, std::vector<double>> skyline_matrix_real;
+  typedef skyline_matrix<std::complex<double>, std::vector<std::complex<double>>> skyline_matrix_complex;
+
+  namespace details {
+    // y = alpha * A * x + beta * y, every stored element below the diagonal
+    //   contributes to two rows
+    template<class Scalar, class Storage>
+    void skyline_prod_into(skyline_matrix<Scalar, Storage> const & matrix,
+        dense_vector<Scalar, Storage> const & vector,
+        dense_vector<Scalar, Storage> & res,
+        Scalar alpha,
+        Scalar beta) {
+      assert(matrix.dim2() == vector.dim());
+      assert(matrix.dim1() == res.dim());
+
+      size_t n = matrix.dim1();
+      Scalar const * a = matrix.data().data();
+      Scalar const * x = vector.data().data();
+      Scalar * y = res.data().data();
+      auto const & ia = matrix.row_offsets();
+
+      scale_output(n, beta, y);
+
+      for (size_t i = 0; i < n; ++i) {
+        size_t first = matrix.first_col(i);
+        Scalar const * row = a + ia[i];
+        Scalar alpha_x_i = alpha * x[i];
+
+        Scalar sum = Scalar();
+        for (size_t j = first; j < i; ++j) {
+          sum += row[j - first] * x[j];
+          y[j] += row[j - first] * alpha_x_i;
+        }
+        y[i] += alpha * sum + row[i - first] * alpha_x_i;
+      }
+    }
+
+    template<class Scalar, class Storage>
+    struct mat_colvec_prod_impl_f<skyline_matrix, Scalar, Storage> {
+      void operator()(skyline_matrix<Scalar, Storage> const & lhs
+          ,dense_vector<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        skyline_prod_into(lhs, rhs, res, alpha, beta);
+      }
+    };
+
+    // x^T A = (A x)^T for a symmetric matrix
+    template<class Scalar, class Storage>
+    struct mat_rowvec_prod_impl_f<skyline_matrix, Scalar, Storage> {
+      void operator()(dense_vector<Scalar, Storage> const & lhs
+          ,skyline_matrix<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        skyline_prod_into(rhs, lhs, res, alpha, beta);
+      }
+    };
+  } // namespace details
+} } // namespace fe::la
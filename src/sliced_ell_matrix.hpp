@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <complex>
+
+#include "compressed_row_matrix.hpp"
+#include "dense_vector.hpp"
+#include "products.hpp"
+#include "details/sparse_element_proxy.hpp"
+#include "details/sparse_matrix_vector_product.hpp"
+#include "details/sell_kernels.hpp"
+
+namespace fe { namespace la {
+  // Forward declarations
+  template<class Scalar, class Storage>
+  class sliced_ell_matrix;
+
+  namespace details {
+    template<class Scalar, class Storage>
+    sliced_ell_matrix<Scalar, Storage> sellmatrix_from_crmatrix(compressed_row_matrix<Scalar, Storage> const &,
+        size_t chunk_size, size_t sort_window);
+  } // namespace details
+
+  /**
+   * Sparse matrix in SELL-C-sigma (sliced ELLPACK) form for products by vectors.
+   * Rows are cut into chunks of C = chunk_size rows, every chunk is padded to its
+   * longest row and stored column by column, so a SIMD register holds one element
+   * of C rows and the product needs no horizontal sums. Inside windows of
+   * sigma = sort_window rows, rows are sorted by length to reduce the padding.
+   *
+   * Built from a compressed_row_matrix by convert_matrix<sliced_ell_matrix>(a) or, with
+   * other parameters, make_sliced_ell_matrix(a, chunk_size, sort_window).
+   * Only the values of stored elements can be changed.
+   */
+  template<class Scalar, class Storage>
+  class sliced_ell_matrix {
+    private:
+      typedef details::sparse_element_proxy<Scalar> proxy_t;
+    public:
+      typedef std::vector<size_t> index_storage_t;
+      typedef Scalar scalar_t;
+      typedef Storage storage_t;
+      typedef proxy_t reference_t;
+      typedef Scalar const_reference_t;
+
+      // The vector width of AVX-512 for double, two AVX2 registers
+      static size_t const DEFAULT_CHUNK_SIZE = 8;
+      static size_t const DEFAULT_SORT_WINDOW = 256;
+
+      sliced_ell_matrix() = delete;
+      sliced_ell_matrix(sliced_ell_matrix const &) = default;
+      sliced_ell_matrix(sliced_ell_matrix &&) = default;
+      ~sliced_ell_matrix() = default;
+
+      sliced_ell_matrix & operator = (sliced_ell_matrix const &) = default;
+      sliced_ell_matrix & operator = (sliced_ell_matrix &&) = default;
+
+      size_t dim1() const {
+        return dim1_;
+      }
+
+      size_t dim2() const {
+        return dim2_;
+      }
+
+      size_t chunk_size() const {
+        return chunk_size_;
+      }
+
+      size_t sort_window() const {
+        return sort_window_;
+      }
+
+      // Values of all chunks including the zero padding
+      storage_t & data() {
+        return a_;
+      }
+
+      storage_t const & data() const {
+        return a_;
+      }
+
+      // Chunk c is data()[chunk_offsets()[c]] ... data()[chunk_offsets()[c + 1] - 1]
+      index_storage_t const & chunk_offsets() const {
+        return chunk_ptr_;
+      }
+
+      // Column indices of elements in data(), padding repeats a column of its row
+      index_storage_t const & column_indices() const {
+        return col_;
+      }
+
+      // Row stored at every position, positions c * chunk_size() ... belong to chunk c
+      index_storage_t const & row_order() const {
+        return row_order_;
+      }
+
+      // Number of elements of the row stored at every position, without the padding
+      index_storage_t const & row_lengths() const {
+        return lengths_;
+      }
+
+      // Chunk bounds of the parts of about equal size that products split between threads
+      index_storage_t const & row_partition() const {
+        return partition_;
+      }
+
+      reference_t operator () (size_t i, size_t j) {
+        assert(i < dim1());
+        assert(j < dim2());
+
+        size_t pos = position_[i];
+        size_t first = chunk_ptr_[pos / chunk_size_] + pos % chunk_size_;
+        for (size_t k = 0; k < lengths_[pos]; ++k) {
+          size_t p = first + k * chunk_size_;
+          if (col_[p] == j) {
+            return proxy_t(&a_[p]);
+          }
+        }
+        return proxy_t();
+      }
+
+      const_reference_t operator () (size_t i, size_t j) const {
+        return (*const_cast<sliced_ell_matrix*>(this))(i, j);
+      }
+    private:
+      sliced_ell_matrix(size_t dim1, size_t dim2, size_t chunk_size, size_t sort_window)
+          : dim1_(dim1), dim2_(dim2), chunk_size_(chunk_size), sort_window_(sort_window) {
+      }
+    private:
+      size_t dim1_;
+      size_t dim2_;
+      size_t chunk_size_;
+      size_t sort_window_;
+
+      index_storage_t chunk_ptr_;
+      index_storage_t col_;
+      // Stored position to row and back
+      index_storage_t row_order_;
+      index_storage_t position_;
+      index_storage_t lengths_;
+      index_storage_t partition_;
+
+      storage_t a_;
+    private:
+      friend sliced_ell_matrix
+          details::sellmatrix_from_crmatrix<scalar_t, storage_t>(
+              compressed_row_matrix<scalar_t, storage_t> const &, size_t, size_t);
+  };
+
+  template<class Scalar, class Storage>
+  size_t const sliced_ell_matrix<Scalar, Storage>::DEFAULT_CHUNK_SIZE;
+
+  template<class Scalar, class Storage>
+  size_t const sliced_ell_matrix<Scalar, Storage>::DEFAULT_SORT_WINDOW;
+
+  // SELL-C-sigma form of a with C = chunk_size and sigma = sort_window,
+  //   chunk sizes 4 and 8 have SIMD kernels for double, sort_window 1 keeps the row order
+  template<class Scalar, class Storage>
+  sliced_ell_matrix<Scalar, Storage> make_sliced_ell_matrix(compressed_row_matrix<Scalar, Storage> const & a,
+      size_t chunk_size = sliced_ell_matrix<Scalar, Storage>::DEFAULT_CHUNK_SIZE,
+      size_t sort_window = sliced_ell_matrix<Scalar, Storage>::DEFAULT_SORT_WINDOW) {
+    return details::sellmatrix_from_crmatrix(a, chunk_size, sort_window);
+  }
+
+  typedef sliced_ell_matrix<double, std::vector<double>> sliced_ell_matrix_real;
+  typedef sliced_ell_matrix<std::complex<double>, std::vector<std::complex<double>>> sliced_ell_matrix_complex;
+
+  namespace details {
+    template<class Scalar, class Storage>
+    sliced_ell_matrix<Scalar, Storage> sellmatrix_from_crmatrix(compressed_row_matrix<Scalar, Storage> const & source,
+        size_t chunk_size, size_t sort_window) {
+      assert(chunk_size > 0 && chunk_size <= SELL_MAX_CHUNK);
+      assert(sort_window > 0);
+
+      size_t n = source.dim1();
+      size_t chunks = (n + chunk_size - 1) / chunk_size;
+      auto const & ia = source.row_offsets();
+      auto const & ja = source.column_indices();
+      auto const & a = source.data();
+
+      sliced_ell_matrix<Scalar, Storage> res{n, source.dim2(), chunk_size, sort_window};
+
+      // Longer rows first inside every window, the sort is stable so equal rows keep their order
+      res.row_order_.resize(n);
+      for (size_t i = 0; i < n; ++i) {
+        res.row_order_[i] = i;
+      }
+      for (size_t first = 0; first < n && sort_window > 1; first += sort_window) {
+        std::stable_sort(res.row_order_.begin() + first, res.row_order_.begin() + std::min(n, first + sort_window),
+            [&](size_t l, size_t r) {
+              return ia[l + 1] - ia[l] > ia[r + 1] - ia[r];
+            });
+      }
+
+      res.position_.resize(n);
+      res.lengths_.resize(n);
+      for (size_t pos = 0; pos < n; ++pos) {
+        size_t i = res.row_order_[pos];
+        res.position_[i] = pos;
+        res.lengths_[pos] = ia[i + 1] - ia[i];
+      }
+
+      res.chunk_ptr_.assign(chunks + 1, 0);
+      for (size_t c = 0; c < chunks; ++c) {
+        size_t width = 0;
+        for (size_t pos = c * chunk_size; pos < std::min(n, (c + 1) * chunk_size); ++pos) {
+          width = std::max(width, res.lengths_[pos]);
+        }
+        res.chunk_ptr_[c + 1] = res.chunk_ptr_[c] + width * chunk_size;
+      }
+
+      // Padding has zero values and the last column of its row, which is already in cache
+      res.col_.assign(res.chunk_ptr_[chunks], 0);
+      res.a_.assign(res.chunk_ptr_[chunks], Scalar());
+      for (size_t pos = 0; pos < n; ++pos) {
+        size_t i = res.row_order_[pos];
+        size_t c = pos / chunk_size;
+        size_t first = res.chunk_ptr_[c] + pos % chunk_size;
+        size_t width = (res.chunk_ptr_[c + 1] - res.chunk_ptr_[c]) / chunk_size;
+        for (size_t k = 0; k < width; ++k) {
+          size_t p = first + k * chunk_size;
+          if (k < res.lengths_[pos]) {
+            res.col_[p] = ja[ia[i] + k];
+            res.a_[p] = a[ia[i] + k];
+          } else if (k > 0) {
+            res.col_[p] = res.col_[p - chunk_size];
+          }
+        }
+      }
+
+      csr_row_partition(chunks, res.chunk_ptr_, res.partition_);
+
+      return res;
+    }
+
+    template<class Scalar, class Storage>
+    struct mat_colvec_prod_impl_f<sliced_ell_matrix, Scalar, Storage> {
+      void operator()(sliced_ell_matrix<Scalar, Storage> const & lhs
+          ,dense_vector<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        assert(lhs.dim2() == rhs.dim());
+        assert(lhs.dim1() == res.dim());
+
+        sell_prod(lhs.chunk_size(), lhs.dim1(), lhs.row_partition(), lhs.chunk_offsets(), lhs.column_indices(),
+            lhs.data().data(), lhs.row_order(), rhs.data().data(), res.data().data(), alpha, beta);
+      }
+    };
+  } // namespace details
+} } // namespace fe::la
@@ -1,12 +1,52 @@
 #pragma once
 
 #include <cassert>
+#include <vector>
+#include <type_traits>
+#include "dense_matrix.hpp"
 #include "dense_vector.hpp"
+#include "permutation.hpp"
+#include "band_matrix.hpp"
+#include "compressed_row_matrix.hpp"
+#include "skyline_matrix.hpp"
+#include "details/band_lu_kernels.hpp"
+#include "details/skyline_kernels.hpp"
+#include "details/triangular_solve.hpp"
 
 namespace fe { namespace la {
+  namespace details {
+    // Sparse factors: O(nnz) substitution along the non-null elements of every row
+    template<class Matrix, class Vector>
+    void solve_lu_dispatch(Matrix const & A, Vector & b, std::true_type) {
+      nnrow_lu_solve(A, b.data().data());
+    }
+
+    // Dense factors: row-wise substitution over the whole triangles
+    template<class Matrix, class Vector>
+    void solve_lu_dispatch(Matrix const & A, Vector & b, std::false_type) {
+      size_t n = b.dim();
+
+      // First solve Ly = b
+      for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < i; ++j) {
+          b(i) -= A(i, j) * b(j);
+        }
+      }
+
+      // Now solve Ux = y
+      for (size_t i = n; i-- > 0;) {
+        for (size_t j = i + 1; j < n; ++j) {
+          b(i) -= A(i, j) * b(j);
+        }
+        b(i) /= A(i, i);
+      }
+    }
+  } // namespace details
+
   /**
    * Solves the matrix system Ax = b inplace.
    * Matrix A must be a result of LU decomposition.
+   * Matrices with non-null row iterators are solved in O(nnz(A)) time.
    *
    * @tparam Matrix The class of a system matrix.
    * @tparam Vector The class of a right-hand side vector.
@@ -16,21 +56,124 @@ namespace fe { namespace la {
    */
   template<class Matrix, class Vector>
   void solve_lu_inplace(Matrix const & A, Vector & b) {
+    assert(A.dim1() == A.dim2());
     assert(A.dim2() == b.dim());
 
-    // First solve Ly = b
-    for (int i = 0; i < b.dim(); ++i) {
-      for (int j = i + 1; j < b.dim(); ++j) {
-        b(j) -= b(i) * A(j, i);
-      }
+    details::solve_lu_dispatch(A, b,
+        std::integral_constant<bool, details::has_nnrow_iterators<Matrix>::value>());
+  }
+
+  // Solves the system with compressed row LU factors directly on their arrays
+  template<class Scalar, class Storage>
+  void solve_lu_inplace(compressed_row_matrix<Scalar, Storage> const & A, dense_vector<Scalar, Storage> & b) {
+    assert(A.dim1() == A.dim2());
+    assert(A.dim2() == b.dim());
+
+    details::csr_lu_solve(A.dim1(), A.row_offsets(), A.column_indices(), A.data().data(), b.data().data());
+  }
+
+  namespace details {
+    template<class Matrix, class Scalar>
+    void solve_lu_block_dispatch(Matrix const & A, Scalar * x, size_t ldx, size_t width, std::true_type) {
+      nnrow_lu_solve_block(A, x, ldx, width);
     }
 
-    // Now solve Ux = y
-    for (int i = b.dim() - 1; i >= 0; --i) {
-      b(i) /= A(i ,i);
-      for (int j = i - 1; j >= 0; --j) {
-        b(j) -= b(i) * A(j, i);
-      }
+    template<class Matrix, class Scalar>
+    void solve_lu_block_dispatch(Matrix const & A, Scalar * x, size_t ldx, size_t width, std::false_type) {
+      dense_lu_solve_block(A, x, ldx, width);
+    }
+
+    // Solves a row-major n x width block of right-hand sides with rows ldx apart
+    template<class Matrix, class Scalar>
+    void solve_lu_block(Matrix const & A, Scalar * x, size_t ldx, size_t width) {
+      solve_lu_block_dispatch(A, x, ldx, width,
+          std::integral_constant<bool, has_nnrow_iterators<Matrix>::value>());
     }
+
+    template<class Scalar, class Storage>
+    void solve_lu_block(compressed_row_matrix<Scalar, Storage> const & A, Scalar * x, size_t ldx, size_t width) {
+      csr_lu_solve_block(A.dim1(), A.row_offsets(), A.column_indices(), A.data().data(), x, ldx, width);
+    }
+  } // namespace details
+
+  /**
+   * Solves A X = B inplace for all columns of B at once, A must be a result of LU decomposition.
+   * Every element of the factors is read once per block of SOLVE_BLOCK_COLS columns
+   * and applied to the whole block, blocks are split between threads.
+   */
+  template<class Matrix, class Scalar, class Storage>
+  void solve_lu_inplace(Matrix const & A, dense_matrix<Scalar, Storage> & B) {
+    assert(A.dim1() == A.dim2());
+    assert(A.dim2() == B.dim1());
+
+    Scalar * x = B.data().data();
+    size_t ldx = B.dim2();
+    details::for_each_column_block(B.dim2(), [&](size_t first, size_t last) {
+      details::solve_lu_block(A, x + first, ldx, last - first);
+    });
+  }
+
+  // Solves A x = b inplace for every vector of the list, a block of vectors at a time
+  template<class Matrix, class Scalar, class Storage>
+  void solve_lu_inplace(Matrix const & A, std::vector<dense_vector<Scalar, Storage>> & bs) {
+    assert(A.dim1() == A.dim2());
+
+    size_t n = A.dim1();
+    details::for_each_column_block(bs.size(), [&](size_t first, size_t last) {
+      size_t width = last - first;
+      std::vector<Scalar> block(n * width);
+      for (size_t j = 0; j < width; ++j) {
+        assert(bs[first + j].dim() == n);
+        for (size_t i = 0; i < n; ++i) {
+          block[i * width + j] = bs[first + j](i);
+        }
+      }
+
+      details::solve_lu_block(A, block.data(), width, width);
+
+      for (size_t j = 0; j < width; ++j) {
+        for (size_t i = 0; i < n; ++i) {
+          bs[first + j](i) = block[i * width + j];
+        }
+      }
+    });
+  }
+
+  // Solves the system with a band matrix after lu_decomposition in O(n * (bands_left + bands_right))
+  template<class Scalar, class Storage>
+  void solve_lu_inplace(band_matrix<Scalar, Storage> const & A, dense_vector<Scalar, Storage> & b) {
+    assert(A.dim1() == A.dim2());
+    assert(A.dim2() == b.dim());
+
+    details::band_lu_solve(A.dim1(), A.bands_left(), A.bands_right(), A.data().data(), b.data().data());
+  }
+
+  // Solves the system after ldlt_decomposition of a skyline matrix
+  template<class Scalar, class Storage>
+  void solve_ldlt_inplace(skyline_matrix<Scalar, Storage> const & A, dense_vector<Scalar, Storage> & b) {
+    assert(A.dim2() == b.dim());
+
+    details::skyline_ldlt_solve(A.dim1(), A.row_offsets(), A.data().data(), b.data().data());
+  }
+
+  // Solves the system after cholesky_decomposition of a skyline matrix
+  template<class Scalar, class Storage>
+  void solve_cholesky_inplace(skyline_matrix<Scalar, Storage> const & A, dense_vector<Scalar, Storage> & b) {
+    assert(A.dim2() == b.dim());
+
+    details::skyline_cholesky_solve(A.dim1(), A.row_offsets(), A.data().data(), b.data().data());
+  }
+
+  /**
+   * Solves Ax = b inplace, when LU is the LU decomposition of the reordered
+   * matrix P A P^T (see convert_matrix with a permutation).
+   */
+  template<class Matrix, class Scalar, class Storage>
+  void solve_lu_inplace(Matrix const & LU, permutation const & perm, dense_vector<Scalar, Storage> & b) {
+    assert(perm.size() == b.dim());
+
+    b = permute(perm, b);
+    solve_lu_inplace(LU, b);
+    b = unpermute(perm, b);
   }
 } } // namespace fe::la
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <complex>
+
+#include "symmetric_compressed_row_matrix.hpp"
+#include "dense_vector.hpp"
+#include "permutation.hpp"
+#include "details/sparse_cholesky_kernels.hpp"
+
+namespace fe { namespace la {
+  enum class factorization_type {
+    LLT,  // A = L L^T, needs a positive definite matrix
+    LDLT  // A = L D L^T with unit diagonal L, also for indefinite matrices with nonsingular leading minors
+  };
+
+  /**
+   * Cholesky decomposition of a symmetric_compressed_row_matrix that keeps its
+   * symbolic analysis (elimination tree and pattern of L), used like sparse_lu:
+   *
+   *   sparse_cholesky_real chol;
+   *   chol.analyze(a, approximate_minimum_degree(sparsity_pattern(a)));
+   *   chol.factorize(a);
+   *   chol.solve(b);
+   *
+   * Only L is computed and stored, which is half of the memory and flops of sparse_lu
+   * for the same ordering.
+   */
+  template<class Scalar, class Storage>
+  class sparse_cholesky {
+    public:
+      typedef Scalar scalar_t;
+      typedef Storage storage_t;
+
+      explicit sparse_cholesky(factorization_type type = factorization_type::LLT)
+          : type_(type), n_(0), nnz_(0), perm_(0) {
+      }
+
+      // Analyzes the pattern of matrix in its own ordering
+      void analyze(symmetric_compressed_row_matrix<Scalar, Storage> const & matrix) {
+        analyze(matrix, permutation(matrix.dim1()));
+      }
+
+      // Analyzes the pattern of the reordered matrix P A P^T
+      void analyze(symmetric_compressed_row_matrix<Scalar, Storage> const & matrix, permutation const & perm) {
+        assert(perm.size() == matrix.dim1());
+
+        n_ = matrix.dim1();
+        nnz_ = matrix.data().size();
+        perm_ = perm;
+
+        auto const & ia = matrix.row_offsets();
+        auto const & ja = matrix.column_indices();
+
+        // Lower triangle of P A P^T: element (i, j) goes to row max(i', j')
+        std::vector<size_t> perm_row(nnz_);
+        std::vector<size_t> perm_col(nnz_);
+        ia_.assign(n_ + 1, 0);
+        for (size_t i = 0; i < n_; ++i) {
+          for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+            size_t new_i = perm.new_index(i);
+            size_t new_j = perm.new_index(ja[p]);
+            perm_row[p] = std::max(new_i, new_j);
+            perm_col[p] = std::min(new_i, new_j);
+            ++ia_[perm_row[p] + 1];
+          }
+        }
+        for (size_t i = 0; i < n_; ++i) {
+          ia_[i + 1] += ia_[i];
+        }
+
+        std::vector<std::vector<std::pair<size_t, size_t>>> rows(n_);
+        for (size_t p = 0; p < nnz_; ++p) {
+          rows[perm_row[p]].emplace_back(perm_col[p], p);
+        }
+
+        ja_.resize(nnz_);
+        value_map_.resize(nnz_);
+        for (size_t i = 0; i < n_; ++i) {
+          std::sort(rows[i].begin(), rows[i].end());
+          for (size_t k = 0; k < rows[i].size(); ++k) {
+            ja_[ia_[i] + k] = rows[i][k].first;
+            value_map_[rows[i][k].second] = ia_[i] + k;
+          }
+        }
+
+        details::elimination_tree(n_, ia_, ja_, parent_);
+        details::cholesky_symbolic(n_, ia_, ja_, parent_, lp_);
+
+        li_.resize(lp_[n_]);
+        lx_.assign(lp_[n_], Scalar());
+        a_.assign(nnz_, Scalar());
+        work_.assign(n_, Scalar());
+        marker_.resize(n_);
+        stack_.resize(n_);
+        next_.resize(n_);
+      }
+
+      // Computes the factor of a matrix with the analyzed pattern
+      void factorize(symmetric_compressed_row_matrix<Scalar, Storage> const & matrix) {
+        assert(matrix.dim1() == n_);
+
+        factorize(matrix.data());
+      }
+
+      // Computes the factor from values of the analyzed pattern, in its order
+      void factorize(Storage const & values) {
+        assert(values.size() == nnz_);
+
+        for (size_t p = 0; p < nnz_; ++p) {
+          a_[value_map_[p]] = values[p];
+        }
+
+        details::cholesky_numeric(n_, ia_, ja_, a_.data(), parent_, lp_, li_, lx_.data(),
+            type_ == factorization_type::LDLT, work_.data(), marker_, stack_, next_);
+      }
+
+      // Solves A x = b in place with the last computed factor
+      void solve(dense_vector<Scalar, Storage> & b) const {
+        assert(b.dim() == n_);
+
+        for (size_t i = 0; i < n_; ++i) {
+          work_[i] = b(perm_.old_index(i));
+        }
+
+        details::cholesky_solve_inplace(n_, lp_, li_, lx_.data(), type_ == factorization_type::LDLT,
+            work_.data());
+
+        for (size_t i = 0; i < n_; ++i) {
+          b(perm_.old_index(i)) = work_[i];
+          work_[i] = Scalar();
+        }
+      }
+
+      size_t dim() const {
+        return n_;
+      }
+
+      factorization_type type() const {
+        return type_;
+      }
+
+      // Number of elements stored in L, including the diagonal and fill-in
+      size_t factor_size() const {
+        return li_.size();
+      }
+
+      permutation const & ordering() const {
+        return perm_;
+      }
+    private:
+      factorization_type type_;
+      size_t n_;
+      size_t nnz_;
+      permutation perm_;
+
+      // Lower triangle of P A P^T
+      std::vector<size_t> ia_;
+      std::vector<size_t> ja_;
+      // Position in a_ of every element of the analyzed matrix
+      std::vector<size_t> value_map_;
+
+      // Elimination tree and L by columns, see details::cholesky_numeric
+      std::vector<size_t> parent_;
+      std::vector<size_t> lp_;
+      std::vector<size_t> li_;
+      Storage lx_;
+
+      Storage a_;
+      // Dense row for factorize and permuted vector for solve, always left zero.
+      //   Makes concurrent calls on one object unsafe.
+      mutable std::vector<Scalar> work_;
+      std::vector<size_t> marker_;
+      std::vector<size_t> stack_;
+      std::vector<size_t> next_;
+  };
+
+  typedef sparse_cholesky<double, std::vector<double>> sparse_cholesky_real;
+  typedef sparse_cholesky<std::complex<double>, std::vector<std::complex<double>>> sparse_cholesky_complex;
+} } // namespace fe::la
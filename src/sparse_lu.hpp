@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <complex>
+
+#include "compressed_row_matrix.hpp"
+#include "dense_matrix.hpp"
+#include "dense_vector.hpp"
+#include "permutation.hpp"
+#include "threads.hpp"
+#include "details/sparse_lu_kernels.hpp"
+#include "details/level_schedule.hpp"
+
+namespace fe { namespace la {
+  /**
+   * LU decomposition (without pivoting) of a compressed_row_matrix that keeps
+   * its symbolic analysis, for sequences of matrices with one sparsity pattern
+   * (Newton iterations, time steps):
+   *
+   *   sparse_lu_real lu;
+   *   lu.analyze(a, approximate_minimum_degree(sparsity_pattern(a)));
+   *   for (...) {
+   *     lu.factorize(a);  // a has new values in the same pattern
+   *     lu.solve(b);
+   *   }
+   *
+   * analyze computes the fill pattern and allocates everything, factorize and
+   * solve only do arithmetic on the allocated arrays. With several threads solve
+   * runs the independent rows of every level of L and U in parallel.
+   */
+  template<class Scalar, class Storage>
+  class sparse_lu {
+    public:
+      typedef Scalar scalar_t;
+      typedef Storage storage_t;
+
+      sparse_lu()
+          : n_(0), nnz_(0), perm_(0) {
+      }
+
+      // Analyzes the pattern of matrix in its own ordering
+      void analyze(compressed_row_matrix<Scalar, Storage> const & matrix) {
+        analyze(matrix, permutation(matrix.dim1()));
+      }
+
+      // Analyzes the pattern of the reordered matrix P A P^T
+      void analyze(compressed_row_matrix<Scalar, Storage> const & matrix, permutation const & perm) {
+        assert(matrix.dim1() == matrix.dim2());
+        assert(perm.size() == matrix.dim1());
+
+        n_ = matrix.dim1();
+        nnz_ = matrix.data().size();
+        perm_ = perm;
+
+        auto const & ia = matrix.row_offsets();
+        auto const & ja = matrix.column_indices();
+
+        // Pattern of P A P^T and positions of elements of A in it
+        std::vector<size_t> perm_ia(n_ + 1, 0);
+        for (size_t i = 0; i < n_; ++i) {
+          perm_ia[perm.new_index(i) + 1] = ia[i + 1] - ia[i];
+        }
+        for (size_t i = 0; i < n_; ++i) {
+          perm_ia[i + 1] += perm_ia[i];
+        }
+
+        std::vector<size_t> perm_ja(nnz_);
+        std::vector<size_t> perm_pos(nnz_);
+        std::vector<std::pair<size_t, size_t>> row;
+        for (size_t i = 0; i < n_; ++i) {
+          row.clear();
+          for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+            row.emplace_back(perm.new_index(ja[p]), p);
+          }
+          std::sort(row.begin(), row.end());
+
+          size_t first = perm_ia[perm.new_index(i)];
+          for (size_t k = 0; k < row.size(); ++k) {
+            perm_ja[first + k] = row[k].first;
+            perm_pos[row[k].second] = first + k;
+          }
+        }
+
+        details::lu_symbolic(n_, perm_ia, perm_ja, lu_ia_, lu_ja_, lu_diag_);
+
+        std::vector<size_t> lu_pos;
+        details::lu_scatter_map(n_, perm_ia, perm_ja, lu_ia_, lu_ja_, lu_pos);
+
+        value_map_.resize(nnz_);
+        for (size_t p = 0; p < nnz_; ++p) {
+          value_map_[p] = lu_pos[perm_pos[p]];
+        }
+
+        details::lower_level_schedule(n_, lu_ia_, lu_ja_, lu_diag_, lower_levels_);
+        details::upper_level_schedule(n_, lu_ia_, lu_ja_, lu_diag_, upper_levels_);
+
+        lu_a_.assign(lu_ja_.size(), Scalar());
+        work_.assign(n_, Scalar());
+      }
+
+      // Computes the factors of a matrix with the analyzed pattern
+      void factorize(compressed_row_matrix<Scalar, Storage> const & matrix) {
+        assert(matrix.dim1() == n_ && matrix.dim2() == n_);
+
+        factorize(matrix.data());
+      }
+
+      // Computes the factors from values of the analyzed pattern, in its order
+      void factorize(Storage const & values) {
+        assert(values.size() == nnz_);
+
+        std::fill(lu_a_.begin(), lu_a_.end(), Scalar());
+        for (size_t p = 0; p < nnz_; ++p) {
+          lu_a_[value_map_[p]] = values[p];
+        }
+
+        details::lu_numeric(n_, lu_ia_, lu_ja_, lu_diag_, lu_a_.data(), work_.data());
+      }
+
+      // Solves A x = b in place with the last computed factors
+      void solve(dense_vector<Scalar, Storage> & b) const {
+        assert(b.dim() == n_);
+
+        for (size_t i = 0; i < n_; ++i) {
+          work_[i] = b(perm_.old_index(i));
+        }
+
+        // Both solves give exactly the same result
+        if (num_threads() > 1) {
+          details::lu_solve_levels(lu_ia_, lu_ja_, lu_diag_, lu_a_.data(), lower_levels_, upper_levels_,
+              work_.data());
+        } else {
+          details::lu_solve_inplace(n_, lu_ia_, lu_ja_, lu_diag_, lu_a_.data(), work_.data());
+        }
+
+        for (size_t i = 0; i < n_; ++i) {
+          b(perm_.old_index(i)) = work_[i];
+          work_[i] = Scalar();
+        }
+      }
+
+      // Solves A X = B in place for all columns of B together, see solve_lu_inplace
+      void solve(dense_matrix<Scalar, Storage> & b) const {
+        assert(b.dim1() == n_);
+
+        size_t k = b.dim2();
+        block_work_.resize(n_ * k);
+        for (size_t i = 0; i < n_; ++i) {
+          std::copy_n(b.data().begin() + perm_.old_index(i) * k, k, block_work_.begin() + i * k);
+        }
+
+        details::for_each_column_block(k, [&](size_t first, size_t last) {
+          details::lu_solve_block(n_, lu_ia_, lu_ja_, lu_diag_, lu_a_.data(), block_work_.data() + first, k,
+              last - first);
+        });
+
+        for (size_t i = 0; i < n_; ++i) {
+          std::copy_n(block_work_.begin() + i * k, k, b.data().begin() + perm_.old_index(i) * k);
+        }
+      }
+
+      size_t dim() const {
+        return n_;
+      }
+
+      // Number of elements stored in L + U, including fill-in
+      size_t factor_size() const {
+        return lu_ja_.size();
+      }
+
+      permutation const & ordering() const {
+        return perm_;
+      }
+
+      // Number of parallel steps of the forward and back substitution
+      size_t lower_levels() const {
+        return lower_levels_.levels();
+      }
+
+      size_t upper_levels() const {
+        return upper_levels_.levels();
+      }
+    private:
+      size_t n_;
+      size_t nnz_;
+      permutation perm_;
+
+      // Pattern of L + U, see details::lu_symbolic
+      std::vector<size_t> lu_ia_;
+      std::vector<size_t> lu_ja_;
+      std::vector<size_t> lu_diag_;
+      // Rows of L and U that can be solved in parallel
+      details::level_schedule lower_levels_;
+      details::level_schedule upper_levels_;
+      // Position in lu_a_ of every element of the analyzed matrix
+      std::vector<size_t> value_map_;
+
+      Storage lu_a_;
+      // Dense row for factorize and permuted vector for solve, always left zero.
+      //   Makes concurrent calls on one object unsafe.
+      mutable std::vector<Scalar> work_;
+      // Permuted right-hand sides of the block solve, grows to the largest block
+      mutable std::vector<Scalar> block_work_;
+  };
+
+  typedef sparse_lu<double, std::vector<double>> sparse_lu_real;
+  typedef sparse_lu<std::complex<double>, std::vector<std::complex<double>>> sparse_lu_complex;
+} } // namespace fe::la
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#include "details/nonnull_elements.hpp"
+
+namespace fe { namespace la {
+  /**
+   * Adjacency graph of a square matrix: vertices are rows, i and j are adjacent
+   * when a_ij or a_ji is non-null (the pattern of A + A^T without the diagonal).
+   * Reordering algorithms work on it instead of on the matrix.
+   */
+  class sparsity_pattern {
+    public:
+      // Pattern given by compressed row arrays: row i has columns ja[ia[i]] ... ja[ia[i + 1] - 1]
+      sparsity_pattern(size_t size, std::vector<size_t> const & ia, std::vector<size_t> const & ja)
+          : offsets_(size + 1, 0) {
+        assert(ia.size() == size + 1);
+
+        std::vector<size_t> rows;
+        std::vector<size_t> cols;
+        rows.reserve(ia[size]);
+        cols.reserve(ia[size]);
+        for (size_t i = 0; i < size; ++i) {
+          for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+            rows.push_back(i);
+            cols.push_back(ja[p]);
+          }
+        }
+
+        build(rows, cols);
+      }
+
+      // Collects the pattern of any matrix with non-null row iterators or of a dense_matrix
+      template<class Matrix>
+      explicit sparsity_pattern(Matrix const & matrix)
+          : offsets_(matrix.dim1() + 1, 0) {
+        assert(matrix.dim1() == matrix.dim2());
+
+        std::vector<size_t> rows;
+        std::vector<size_t> cols;
+        details::for_each_nonnull(matrix, [&](size_t i, size_t j, typename Matrix::scalar_t const &) {
+          rows.push_back(i);
+          cols.push_back(j);
+        });
+
+        build(rows, cols);
+      }
+
+      // Number of vertices
+      size_t size() const {
+        return offsets_.size() - 1;
+      }
+
+      size_t degree(size_t v) const {
+        assert(v < size());
+
+        return offsets_[v + 1] - offsets_[v];
+      }
+
+      // Neighbours of v, sorted
+      size_t const * adjacent_begin(size_t v) const {
+        assert(v < size());
+
+        return adjacent_.data() + offsets_[v];
+      }
+
+      size_t const * adjacent_end(size_t v) const {
+        assert(v < size());
+
+        return adjacent_.data() + offsets_[v + 1];
+      }
+
+      std::vector<size_t> const & offsets() const {
+        return offsets_;
+      }
+
+      std::vector<size_t> const & adjacent() const {
+        return adjacent_;
+      }
+    private:
+      // Symmetrizes the pattern given by (rows[k], cols[k]) pairs and drops the diagonal
+      void build(std::vector<size_t> const & rows, std::vector<size_t> const & cols) {
+        size_t n = size();
+
+        for (size_t k = 0; k < rows.size(); ++k) {
+          assert(rows[k] < n && cols[k] < n);
+
+          if (rows[k] != cols[k]) {
+            ++offsets_[rows[k] + 1];
+            ++offsets_[cols[k] + 1];
+          }
+        }
+        for (size_t v = 0; v < n; ++v) {
+          offsets_[v + 1] += offsets_[v];
+        }
+
+        adjacent_.resize(offsets_[n]);
+        {
+          std::vector<size_t> next(offsets_.begin(), offsets_.end() - 1);
+          for (size_t k = 0; k < rows.size(); ++k) {
+            if (rows[k] != cols[k]) {
+              adjacent_[next[rows[k]]++] = cols[k];
+              adjacent_[next[cols[k]]++] = rows[k];
+            }
+          }
+        }
+
+        // Sort neighbours and drop duplicates (a_ij and a_ji both give the edge twice)
+        size_t write = 0;
+        for (size_t v = 0; v < n; ++v) {
+          auto first = adjacent_.begin() + offsets_[v];
+          auto last = adjacent_.begin() + offsets_[v + 1];
+          std::sort(first, last);
+          last = std::unique(first, last);
+
+          offsets_[v] = write;
+          write = std::copy(first, last, adjacent_.begin() + write) - adjacent_.begin();
+        }
+        offsets_[n] = write;
+        adjacent_.resize(write);
+      }
+    private:
+      std::vector<size_t> offsets_;
+      std::vector<size_t> adjacent_;
+  };
+} } // namespace fe::la
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <complex>
+
+#include "dense_matrix.hpp"
+#include "dense_vector.hpp"
+#include "products.hpp"
+#include "details/sparse_element_proxy.hpp"
+
+namespace fe { namespace la {
+  // Forward declarations
+  template<class Scalar, class Storage>
+  class symmetric_compressed_row_matrix;
+
+  namespace details {
+    template<class Scalar, class Storage>
+    symmetric_compressed_row_matrix<Scalar, Storage> symcrmatrix_from_arrays(size_t dim,
+        std::vector<size_t> && ia, std::vector<size_t> && ja, Storage && a);
+  } // namespace details
+
+  /**
+   * Symmetric matrix in compressed row form storing only the lower triangle:
+   * row i keeps the non-null elements a_ij with j <= i, sorted by column.
+   * Element (i, j) above the diagonal is element (j, i), so assigning to it changes both.
+   *
+   * Takes half the memory of compressed_row_matrix; sparse_cholesky factors it.
+   */
+  template<class Scalar, class Storage>
+  class symmetric_compressed_row_matrix {
+    private:
+      typedef details::sparse_element_proxy<Scalar> proxy_t;
+    public:
+      typedef std::vector<size_t> index_storage_t;
+      typedef Scalar scalar_t;
+      typedef Storage storage_t;
+      typedef proxy_t reference_t;
+      typedef Scalar const_reference_t;
+
+      symmetric_compressed_row_matrix() = delete;
+      symmetric_compressed_row_matrix(symmetric_compressed_row_matrix const &) = default;
+      symmetric_compressed_row_matrix(symmetric_compressed_row_matrix &&) = default;
+      ~symmetric_compressed_row_matrix() = default;
+
+      symmetric_compressed_row_matrix & operator = (symmetric_compressed_row_matrix const &) = default;
+      symmetric_compressed_row_matrix & operator = (symmetric_compressed_row_matrix &&) = default;
+
+      size_t dim1() const {
+        return dim_;
+      }
+
+      size_t dim2() const {
+        return dim_;
+      }
+
+      storage_t & data() {
+        return a_;
+      }
+
+      storage_t const & data() const {
+        return a_;
+      }
+
+      // Elements of row i are data()[row_offsets()[i]] ... data()[row_offsets()[i + 1] - 1]
+      index_storage_t const & row_offsets() const {
+        return ia_;
+      }
+
+      // Column indices of elements in data(), sorted inside every row and not greater than the row
+      index_storage_t const & column_indices() const {
+        return ja_;
+      }
+
+      reference_t operator () (size_t i, size_t j) {
+        assert(i < dim1());
+        assert(j < dim2());
+
+        if (j > i) {
+          std::swap(i, j);
+        }
+
+        auto b = ja_.cbegin() + ia_[i];
+        auto e = ja_.cbegin() + ia_[i + 1];
+        auto pos = std::lower_bound(b, e, j);
+
+        if (pos == e || *pos != j) {
+          return proxy_t();
+        } else {
+          return proxy_t(&a_[ia_[i] + (pos - b)]);
+        }
+      }
+
+      const_reference_t operator () (size_t i, size_t j) const {
+        return (*const_cast<symmetric_compressed_row_matrix*>(this))(i, j);
+      }
+    private:
+      explicit symmetric_compressed_row_matrix(size_t dim)
+          : dim_(dim) {
+      }
+    private:
+      size_t dim_;
+
+      index_storage_t ia_;
+      index_storage_t ja_;
+
+      storage_t a_;
+    private:
+      friend symmetric_compressed_row_matrix
+          details::symcrmatrix_from_arrays<scalar_t, storage_t>(size_t,
+              index_storage_t &&, index_storage_t &&, storage_t &&);
+  };
+
+  typedef symmetric_compressed_row_matrix<double, std::vector<double>> symmetric_compressed_row_matrix_real;
+  typedef symmetric_compressed_row_matrix<std::complex<double>, std::vector<std::complex<double>>>
+      symmetric_compressed_row_matrix_complex;
+
+  namespace details {
+    // Takes over compressed row arrays of the lower triangle, columns of each row
+    //   must be sorted, unique and not greater than the row
+    template<class Scalar, class Storage>
+    symmetric_compressed_row_matrix<Scalar, Storage> symcrmatrix_from_arrays(size_t dim,
+        std::vector<size_t> && ia, std::vector<size_t> && ja, Storage && a) {
+      assert(ia.size() == dim + 1);
+      assert(ja.size() == ia[dim] && a.size() == ia[dim]);
+
+      symmetric_compressed_row_matrix<Scalar, Storage> res{dim};
+
+      res.ia_ = std::move(ia);
+      res.ja_ = std::move(ja);
+      res.a_ = std::move(a);
+
+      return res;
+    }
+
+    // y = alpha * A * x + beta * y, every element below the diagonal
+    //   contributes to two rows
+    template<class Scalar, class Storage>
+    void symcr_prod_into(symmetric_compressed_row_matrix<Scalar, Storage> const & matrix,
+        dense_vector<Scalar, Storage> const & vector,
+        dense_vector<Scalar, Storage> & res,
+        Scalar alpha,
+        Scalar beta) {
+      assert(matrix.dim2() == vector.dim());
+      assert(matrix.dim1() == res.dim());
+
+      size_t n = matrix.dim1();
+      auto const & ia = matrix.row_offsets();
+      auto const & ja = matrix.column_indices();
+      Scalar const * a = matrix.data().data();
+      Scalar const * x = vector.data().data();
+      Scalar * y = res.data().data();
+
+      scale_output(n, beta, y);
+
+      for (size_t i = 0; i < n; ++i) {
+        Scalar alpha_x_i = alpha * x[i];
+        Scalar sum = Scalar();
+        for (size_t p = ia[i]; p < ia[i + 1]; ++p) {
+          size_t j = ja[p];
+          sum += a[p] * x[j];
+          if (j != i) {
+            y[j] += a[p] * alpha_x_i;
+          }
+        }
+        y[i] += alpha * sum;
+      }
+    }
+
+    template<class Scalar, class Storage>
+    struct mat_colvec_prod_impl_f<symmetric_compressed_row_matrix, Scalar, Storage> {
+      void operator()(symmetric_compressed_row_matrix<Scalar, Storage> const & lhs
+          ,dense_vector<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        symcr_prod_into(lhs, rhs, res, alpha, beta);
+      }
+    };
+
+    // x^T A = (A x)^T for a symmetric matrix
+    template<class Scalar, class Storage>
+    struct mat_rowvec_prod_impl_f<symmetric_compressed_row_matrix, Scalar, Storage> {
+      void operator()(dense_vector<Scalar, Storage> const & lhs
+          ,symmetric_compressed_row_matrix<Scalar, Storage> const & rhs
+          ,dense_vector<Scalar, Storage> & res
+          ,Scalar alpha
+          ,Scalar beta) const {
+        symcr_prod_into(rhs, lhs, res, alpha, beta);
+      }
+    };
+  } // namespace details
+} } // namespace fe::la
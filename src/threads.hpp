@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+
+#include "details/thread_pool.hpp"
+
+// Parallel kernels run on a process-wide pool of threads.
+// By default the pool has one thread per hardware thread.
+// Results of parallel kernels depend only on the number of threads, so
+//   runs with the same thread count give exactly the same results.
+
+namespace fe { namespace la {
+  namespace details {
+    inline size_t & configured_thread_count() {
+      static size_t count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+      return count;
+    }
+
+    inline std::mutex & thread_pool_mutex() {
+      static std::mutex mutex;
+      return mutex;
+    }
+
+    inline thread_pool & global_thread_pool() {
+      static std::unique_ptr<thread_pool> pool;
+
+      std::lock_guard<std::mutex> lock(thread_pool_mutex());
+      if (!pool || pool->size() != configured_thread_count()) {
+        pool.reset();
+        pool.reset(new thread_pool(configured_thread_count()));
+      }
+      return *pool;
+    }
+
+    // Size of the chunks parallel_chunks splits [0, size) into, chunk k begins at k * chunk size.
+    //   It is not less than size if the work is done in one chunk, as it is
+    //   inside a parallel loop, where nested loops run serially
+    inline size_t parallel_chunk_size(size_t size, size_t min_chunk, size_t align) {
+      if (in_parallel_region()) {
+        return size;
+      }
+
+      size_t threads = configured_thread_count();
+      size_t chunks = std::min(threads, std::max<size_t>(size / std::max<size_t>(min_chunk, 1), 1));
+
+      if (chunks <= 1) {
+        return size;
+      }
+
+      size_t chunk_size = (size + chunks - 1) / chunks;
+      return (chunk_size + align - 1) / align * align;
+    }
+
+    // Splits [0, size) into at most num_threads() contiguous chunks of at least
+    // min_chunk elements and calls task(begin, end) for each of them in parallel.
+    // Chunk boundaries are multiples of align.
+    template<class Task>
+    void parallel_chunks(size_t size, size_t min_chunk, size_t align, Task const & task) {
+      size_t chunk_size = parallel_chunk_size(size, min_chunk, align);
+
+      if (chunk_size >= size) {
+        task(size_t(0), size);
+        return;
+      }
+
+      size_t chunks = (size + chunk_size - 1) / chunk_size;
+
+      global_thread_pool().run(chunks, [&](size_t chunk) {
+        size_t begin = chunk * chunk_size;
+        size_t end = std::min(size, begin + chunk_size);
+        task(begin, end);
+      });
+    }
+  } // namespace details
+
+  // Returns the number of threads used by parallel kernels
+  inline size_t num_threads() {
+    return details::configured_thread_count();
+  }
+
+  // Sets the number of threads used by parallel kernels, 1 makes all kernels serial.
+  // Must not be called while other threads run linear algebra kernels.
+  inline void set_num_threads(size_t count) {
+    details::configured_thread_count() = std::max<size_t>(count, 1);
+  }
+} } // namespace fe::la